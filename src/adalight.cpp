@@ -0,0 +1,76 @@
+#include "adalight.h"
+#include "pixel_copy.h"
+
+static const uint8_t magic[] = { 'A', 'd', 'a' };
+
+Adalight::Adalight(HardwareSerial& serial, Adafruit_NeoPixel& strip) :
+    serial(serial), strip(strip), headerLength(0), inPayload(false),
+    payloadLength(0), payloadRead(0), decoded(0),
+    lastFrame(0), frames(0), errors(0) {
+}
+
+void Adalight::begin(unsigned long baud) {
+    // The receive buffer has to be sized before the port is started
+    serial.setRxBufferSize(ADALIGHT_RX_BUFFER);
+    serial.begin(baud);
+    serial.print("Ada\n");
+}
+
+bool Adalight::poll() {
+    int available;
+    while ((available = serial.available()) > 0) {
+        if (!inPayload) {
+            readHeader();
+            continue;
+        }
+
+        uint32_t n = min((uint32_t)available, payloadLength - payloadRead);
+        uint32_t stripBytes = strip.numPixels() * 3;
+        if (payloadRead < stripBytes) {
+            // Bulk copy from the UART buffer into the pixels, then convert
+            // the whole pixels received so far to the strip's color order
+            n = min(n, stripBytes - payloadRead);
+            payloadRead += serial.readBytes(strip.getPixels() + payloadRead, n);
+            uint16_t complete = payloadRead / 3;
+            rgbToStrip(strip, decoded, complete - decoded);
+            decoded = complete;
+        }
+        else {
+            // Host sent more pixels than we have
+            uint8_t discard[64];
+            n = min(n, (uint32_t)sizeof(discard));
+            payloadRead += serial.readBytes(discard, n);
+        }
+
+        if (payloadRead >= payloadLength) {
+            inPayload = false;
+            lastFrame = millis();
+            frames++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scan for the magic word and a valid header, one byte at a time
+void Adalight::readHeader() {
+    while (headerLength < sizeof(header)) {
+        if (serial.available() <= 0) return;
+        uint8_t c = serial.read();
+        if (headerLength < sizeof(magic) && c != magic[headerLength]) {
+            headerLength = (c == magic[0]) ? 1 : 0;
+            continue;
+        }
+        header[headerLength++] = c;
+    }
+    headerLength = 0;
+
+    if ((header[3] ^ header[4] ^ 0x55) != header[5]) {
+        errors++;
+        return;
+    }
+    payloadLength = ((((uint32_t)header[3] << 8) | header[4]) + 1) * 3;
+    payloadRead = 0;
+    decoded = 0;
+    inPayload = true;
+}
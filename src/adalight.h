@@ -0,0 +1,50 @@
+#ifndef ADALIGHT_H
+#define ADALIGHT_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+
+#define ADALIGHT_BAUD       1000000 // 1 Mbaud, 2000000 also works over USB
+#define ADALIGHT_RX_BUFFER  2048    // UART receive buffer, holds ~10 ms at 2 Mbaud
+#define ADALIGHT_TIMEOUT_MS 2500    // Hand back to the theme after this long idle
+
+// Receiver for the Adalight serial protocol used by PC ambilight software:
+//   'A' 'd' 'a' countHi countLo checksum(countHi ^ countLo ^ 0x55)
+// followed by (count + 1) RGB triplets. Payload bytes are read in bulk
+// straight into the strip buffer and reordered in place, so the strip must
+// be a 3-byte (RGB-type) one.
+class Adalight {
+public:
+    Adalight(HardwareSerial& serial, Adafruit_NeoPixel& strip);
+
+    // Configure the port and announce ourselves to the host
+    void begin(unsigned long baud = ADALIGHT_BAUD);
+
+    // Read whatever has arrived; returns true when a whole frame is in the strip
+    bool poll();
+
+    // True while frames keep arriving
+    bool active() const { return frames > 0 && millis() - lastFrame < ADALIGHT_TIMEOUT_MS; }
+
+    uint32_t frameCount() const { return frames; }
+    uint32_t errorCount() const { return errors; }
+
+private:
+    void readHeader();
+
+    HardwareSerial&    serial;
+    Adafruit_NeoPixel& strip;
+
+    uint8_t  header[6];
+    uint8_t  headerLength;
+    bool     inPayload;
+    uint32_t payloadLength;     // Bytes in the current frame
+    uint32_t payloadRead;       // Bytes consumed so far
+    uint16_t decoded;           // Pixels already converted to strip order
+
+    unsigned long lastFrame;
+    uint32_t frames;
+    uint32_t errors;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#include "animation.h"
+#include <esp_timer.h>
+
+uint64_t animationMicros() {
+    return esp_timer_get_time();
+}
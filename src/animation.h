@@ -0,0 +1,40 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stdint.h>
+
+// Microseconds since boot. 64 bits, so unlike micros() it doesn't wrap
+// (every 71 minutes); millis() counts the same clock.
+uint64_t animationMicros();
+
+// Position of a repeating effect within its cycle, as a 0.32 fixed-point
+// fraction of a turn. It is worked out from the clock rather than added up
+// frame by frame, so a slow or skipped frame doesn't change the speed,
+// nothing drifts, and the same time always gives the same position (frames
+// can be drawn ahead, e.g. into the frame cache).
+class Phase {
+public:
+    // One turn every period us, at most 2^32 - 1
+    Phase(uint32_t period) : period(period ? period : 1) {}
+
+    uint32_t getPeriod() const { return period; }
+
+    // Fraction of a turn at time now
+    uint32_t at(uint64_t now) const {
+        return ((uint64_t)elapsed(now) << 32) / period;
+    }
+
+    // Which of steps equal steps of the turn time now falls in, exactly
+    // (at() * steps can round down a step)
+    uint32_t step(uint64_t now, uint32_t steps) const {
+        return (uint64_t)elapsed(now) * steps / period;
+    }
+
+private:
+    // Time into the current turn
+    uint32_t elapsed(uint64_t now) const { return now % period; }
+
+    uint32_t period;
+};
+
+#endif
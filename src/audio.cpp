@@ -0,0 +1,153 @@
+#include "audio.h"
+#include <string.h>
+
+// log2(v) in Q8, the fraction linear between powers of two (within 0.09)
+static int32_t log2q8(uint64_t v) {
+    if (!v) return 0;
+    int32_t bits = 63 - __builtin_clzll(v);
+    uint32_t fraction = bits >= 8 ? (uint32_t)(v >> (bits - 8)) : (uint32_t)(v << (8 - bits));
+    return (bits << 8) | (fraction & 0xFF);
+}
+
+// Level in 0-255 against a peak, AUDIO_RANGE wide. Peaks follow loud
+// passages up at once and fall back slowly, but not so far that quiet
+// noise fills the range.
+static uint8_t scaleLevel(int32_t value, int32_t& peak) {
+    peak -= AUDIO_DECAY;
+    if (peak < value) peak = value;
+    if (peak < AUDIO_FLOOR + AUDIO_RANGE / 2) peak = AUDIO_FLOOR + AUDIO_RANGE / 2;
+    int32_t v = (value - (peak - AUDIO_RANGE)) * 255 / AUDIO_RANGE;
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+AudioAnalyzer::AudioAnalyzer(uint32_t sampleRate) :
+    sampleRate(sampleRate), fft(AUDIO_FFT_SIZE), head(0), sinceHop(0),
+    filling(0), ready(1), pending(false), bassAverage(0), bassPrimed(false) {
+    memset(history, 0, sizeof(history));
+    memset(stamps, 0, sizeof(stamps));
+    for (uint8_t i = 0; i <= AUDIO_BANDS; i++) peaks[i] = AUDIO_FLOOR + AUDIO_RANGE / 2;
+    memset(&current, 0, sizeof(current));
+    memset(&counters, 0, sizeof(counters));
+}
+
+bool AudioAnalyzer::write(const int16_t* samples, size_t count, uint64_t now) {
+    bool handed = false;
+    for (size_t i = 0; i < count; i++) {
+        history[head] = samples[i];
+        head = (head + 1) % AUDIO_FFT_SIZE;
+        if (++sinceHop < AUDIO_HOP) continue;
+        sinceHop = 0;
+
+        // Oldest sample first; the window ends with sample i
+        uint16_t tail = AUDIO_FFT_SIZE - head;
+        memcpy(windows[filling], history + head, tail * sizeof(int16_t));
+        memcpy(windows[filling] + tail, history, head * sizeof(int16_t));
+        stamps[filling] = now - (uint64_t)(count - 1 - i) * 1000000 / sampleRate;
+        if (pending) {
+            counters.overruns++;
+            continue;
+        }
+        ready = filling;
+        __sync_synchronize();
+        pending = true;
+        filling ^= 1;
+        handed = true;
+    }
+    return handed;
+}
+
+bool AudioAnalyzer::analyze() {
+    if (!pending || !fft.size()) return false;
+    __sync_synchronize();
+    uint8_t index = ready;
+    fft.power(windows[index], power);
+    uint64_t stamp = stamps[index];
+    __sync_synchronize();
+    pending = false;    // The buffer is free for the capture side again
+
+    publish(stamp);
+    return true;
+}
+
+void AudioAnalyzer::publish(uint64_t now) {
+    // Octave bands: bin 1, 2-3, 4-7... up to bin n/2 - 1
+    uint64_t total = 0;
+    uint64_t bass = 0;
+    uint16_t bin = 1;
+    for (uint8_t band = 0; band < AUDIO_BANDS; band++) {
+        uint16_t end = band == AUDIO_BANDS - 1 ? AUDIO_FFT_SIZE / 2 : bin * 2;
+        uint64_t energy = 0;
+        for (; bin < end; bin++) energy += power[bin];
+        total += energy;
+        if (band < 2) bass += energy;
+        current.bands[band] = scaleLevel(log2q8(energy), peaks[band]);
+    }
+    current.level = scaleLevel(log2q8(total), peaks[AUDIO_BANDS]);
+
+    // A beat is the bass jumping above its recent average
+    int32_t bassLevel = log2q8(bass);
+    if (!bassPrimed) {
+        bassAverage = bassLevel;
+        bassPrimed = true;
+    }
+    current.beat = bassLevel > AUDIO_FLOOR &&
+                   bassLevel - bassAverage > AUDIO_BEAT_RISE &&
+                   (current.beats == 0 || now - current.beatUs >= AUDIO_BEAT_GAP_US);
+    if (current.beat) {
+        current.beats++;
+        current.beatUs = now;
+    }
+    bassAverage += (bassLevel - bassAverage) / 16;
+    current.windowUs = now;
+    counters.windows++;
+}
+
+bool WavReader::open(FILE* f) {
+    file = f;
+    left = 0;
+    uint8_t header[12];
+    if (fread(header, 1, 12, file) != 12 ||
+        memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) return false;
+
+    // Chunks up to "data", picking up the format on the way
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file) == 8) {
+        uint32_t size = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (uint32_t)chunk[7] << 24;
+        if (!memcmp(chunk, "data", 4)) {
+            left = size;
+            return channels && sampleRate;
+        }
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            uint8_t format[16];
+            if (fread(format, 1, 16, file) != 16) return false;
+            uint16_t tag = format[0] | format[1] << 8;
+            uint16_t bits = format[14] | format[15] << 8;
+            if (tag != 1 || bits != 16) return false;
+            channels = format[2] | format[3] << 8;
+            sampleRate = format[4] | format[5] << 8 | format[6] << 16 | (uint32_t)format[7] << 24;
+            size -= 16;
+        }
+        // Skip the rest, streams can't seek
+        for (uint32_t i = 0; i < size + (size & 1); i++) {
+            if (fgetc(file) == EOF) return false;
+        }
+    }
+    return false;
+}
+
+size_t WavReader::read(int16_t* out, size_t count) {
+    if (!file || !channels) return 0;
+    size_t n = 0;
+    uint8_t frame[2 * 8];
+    size_t frameBytes = 2 * channels;
+    if (frameBytes > sizeof(frame)) return 0;
+    while (n < count && left >= frameBytes && fread(frame, 1, frameBytes, file) == frameBytes) {
+        left -= frameBytes;
+        int32_t sum = 0;
+        for (uint16_t c = 0; c < channels; c++) {
+            sum += (int16_t)(frame[2 * c] | frame[2 * c + 1] << 8);
+        }
+        out[n++] = sum / channels;
+    }
+    return n;
+}
@@ -0,0 +1,107 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "fft.h"
+
+#define AUDIO_FFT_SIZE      512     // Samples per window, 23 ms at 22050 Hz
+#define AUDIO_HOP           256     // Samples between windows; they overlap by half
+#define AUDIO_BANDS         8       // Octaves from bin 1 up, 43 Hz to 11 kHz at 22050 Hz
+
+// Levels are log2 of band energy in Q8: 256 is 3 dB
+#define AUDIO_RANGE         (16 << 8)   // Shown as 0-255, 48 dB below the band's peak
+#define AUDIO_FLOOR         (6 << 8)    // Silence, about 54 dB below full scale
+#define AUDIO_DECAY         2           // Peak fall per window, about 2 dB/s
+#define AUDIO_BEAT_RISE     (3 << 7)    // Bass above its average for a beat, 4.5 dB
+#define AUDIO_BEAT_GAP_US   200000      // Beats at most this often
+
+// What the music is doing, as of the last window analyzed
+typedef struct AudioLevels {
+    uint8_t  bands[AUDIO_BANDS];    // Energy per octave, 0-255 against each band's peak
+    uint8_t  level;                 // All bands together
+    bool     beat;                  // A beat started in this window
+    uint32_t beats;                 // Beats so far
+    uint64_t beatUs;                // Animation time the last beat was captured
+    uint64_t windowUs;              // Animation time the window's last sample was captured
+} AudioLevels;
+
+// Analysis statistics, exported over REST
+typedef struct AudioStats {
+    uint32_t windows;       // Windows analyzed
+    uint32_t overruns;      // Windows dropped because the last one was still being analyzed
+    uint32_t analyzeUs;     // Time to analyze a window
+    uint32_t latencyUs;     // From the window's last sample to its levels being ready
+} AudioStats;
+
+// Spectrum, band levels and beats from a stream of mono samples.
+//
+// write() and analyze() may run in different tasks: samples go through a
+// ring into one of two window buffers, handed over to analyze() every
+// AUDIO_HOP samples while it works on the other. write() never waits; if
+// analyze() hasn't taken the last window yet the new one is dropped.
+class AudioAnalyzer {
+public:
+    AudioAnalyzer(uint32_t sampleRate);
+
+    uint32_t rate() const { return sampleRate; }
+
+    // Capture side: append samples, the last of them captured at now (us).
+    // True if a window was handed over.
+    bool write(const int16_t* samples, size_t count, uint64_t now);
+
+    // Analysis side: work through the window handed over, if any; true if
+    // levels() changed
+    bool analyze();
+
+    const AudioLevels& levels() const { return current; }
+    AudioStats& stats() { return counters; }
+
+private:
+    void publish(uint64_t now);
+
+    uint32_t sampleRate;
+    RealFft  fft;
+
+    int16_t  history[AUDIO_FFT_SIZE];   // Ring of the last window's samples
+    uint16_t head;
+    uint16_t sinceHop;
+
+    int16_t  windows[2][AUDIO_FFT_SIZE];
+    uint64_t stamps[2];
+    uint8_t  filling;                   // Written by the capture side only
+    volatile uint8_t ready;             // Handed over, analyzed next
+    volatile bool    pending;
+
+    uint32_t power[AUDIO_FFT_SIZE / 2 + 1];
+    int32_t  peaks[AUDIO_BANDS + 1];    // Per band, then overall, Q8 log2
+    int32_t  bassAverage;               // Q8 log2
+    bool     bassPrimed;
+
+    AudioLevels current;
+    AudioStats  counters;
+};
+
+// Samples from a 16-bit PCM WAV file or stream (e.g. stdin on a PC), mixed
+// down to mono
+class WavReader {
+public:
+    WavReader() : file(NULL), channels(0), sampleRate(0), left(0) {}
+
+    // Reads up to the start of the sample data; false if it isn't 16-bit PCM
+    bool open(FILE* file);
+
+    // Up to count samples into out; returns how many, 0 at the end
+    size_t read(int16_t* out, size_t count);
+
+    uint32_t rate() const { return sampleRate; }
+
+private:
+    FILE*    file;
+    uint16_t channels;
+    uint32_t sampleRate;
+    uint32_t left;          // Bytes of sample data still to read
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "audio_input.h"
+#include "animation.h"
+
+AudioInput::AudioInput(uint32_t sampleRate) :
+    analyzer(sampleRate), lock(xSemaphoreCreateMutex()), started(false),
+    captureTask(NULL), analysisTask(NULL), notifyTask(NULL) {
+    memset(&published, 0, sizeof(published));
+}
+
+bool AudioInput::begin(int bckPin, int wsPin, int dataPin, UBaseType_t priority, BaseType_t core) {
+    i2s_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = analyzer.rate();
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB);
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = AUDIO_DMA_BUFFERS;
+    config.dma_buf_len = AUDIO_DMA_SAMPLES;
+
+    i2s_pin_config_t pins;
+    pins.bck_io_num = bckPin;
+    pins.ws_io_num = wsPin;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = dataPin;
+
+    if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK
+        || i2s_set_pin(I2S_NUM_0, &pins) != ESP_OK) {
+        return false;
+    }
+
+    // Capture a step above analysis: it only runs for a moment as each DMA
+    // buffer fills, and windows are handed over without waiting on the FFT
+    if (xTaskCreatePinnedToCore(analysis, "audioFft", 3072, this, priority,
+                                &analysisTask, core) != pdPASS
+        || xTaskCreatePinnedToCore(capture, "audioIn", 2048, this, priority + 1,
+                                   &captureTask, core) != pdPASS) {
+        return false;
+    }
+    return true;
+}
+
+bool AudioInput::read(AudioLevels& levels) {
+    if (xSemaphoreTake(lock, 0) != pdTRUE) return false;
+    bool result = started;
+    if (started) levels = published;
+    xSemaphoreGive(lock);
+    return result;
+}
+
+void AudioInput::capture(void* arg) {
+    AudioInput* self = (AudioInput*)arg;
+    int32_t raw[AUDIO_DMA_SAMPLES];
+    int16_t samples[AUDIO_DMA_SAMPLES];
+    while (true) {
+        size_t bytes = 0;
+        i2s_read(I2S_NUM_0, raw, sizeof(raw), &bytes, portMAX_DELAY);
+        size_t count = bytes / sizeof(int32_t);
+        uint64_t now = animationMicros();
+
+        // The top 16 of the microphone's 24 bits
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = raw[i] >> 16;
+        }
+        if (self->analyzer.write(samples, count, now)) {
+            xTaskNotifyGive(self->analysisTask);
+        }
+    }
+}
+
+void AudioInput::analysis(void* arg) {
+    AudioInput* self = (AudioInput*)arg;
+    AudioStats& stats = self->analyzer.stats();
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint64_t start = animationMicros();
+        if (!self->analyzer.analyze()) continue;
+        const AudioLevels& levels = self->analyzer.levels();
+        uint64_t end = animationMicros();
+        stats.analyzeUs = end - start;
+        stats.latencyUs = end - levels.windowUs;
+
+        xSemaphoreTake(self->lock, portMAX_DELAY);
+        self->published = levels;
+        self->started = true;
+        xSemaphoreGive(self->lock);
+
+        if (levels.beat && self->notifyTask) {
+            xTaskNotifyGive(self->notifyTask);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include <freertos/semphr.h>
+#include "audio.h"
+
+#define AUDIO_DMA_SAMPLES   128     // Samples per DMA buffer, 6 ms at 22050 Hz
+#define AUDIO_DMA_BUFFERS   4
+
+// I2S microphone (INMP441 or similar: 24 bits in 32-bit slots, left
+// channel) analyzed in two tasks of its own: one reads samples from I2S
+// into the analyzer as the DMA fills, the other runs the FFT on each window
+// handed over. Lighting only ever copies the latest levels out, without
+// waiting, so a slow window can't hold up a frame.
+class AudioInput {
+public:
+    AudioInput(uint32_t sampleRate);
+
+    // Start I2S and the tasks on core, analysis at priority and capture one
+    // above
+    bool begin(int bckPin, int wsPin, int dataPin, UBaseType_t priority, BaseType_t core);
+
+    // Latest levels into levels; false (levels untouched) if they are being
+    // updated right now or nothing has been analyzed yet
+    bool read(AudioLevels& levels);
+
+    // Task to wake when a beat is heard, so it can be shown at once
+    void setNotifyTask(TaskHandle_t task) { notifyTask = task; }
+
+    AudioStats& stats() { return analyzer.stats(); }
+
+private:
+    static void capture(void* arg);
+    static void analysis(void* arg);
+
+    AudioAnalyzer     analyzer;
+    SemaphoreHandle_t lock;         // Guards published
+    AudioLevels       published;
+    bool              started;
+    TaskHandle_t      captureTask;
+    TaskHandle_t      analysisTask;
+    TaskHandle_t      notifyTask;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "chunk_timing.h"
+
+ChunkPlan chunkPlan(uint32_t numBytes, const ChunkConfig& config) {
+    ChunkPlan plan;
+    uint32_t byteNs = 8 * BIT_NS;
+    plan.chunkBytes = config.maxOffUs * 1000 / byteNs;
+    if (plan.chunkBytes == 0) plan.chunkBytes = 1;
+    plan.chunks = (numBytes + plan.chunkBytes - 1) / plan.chunkBytes;
+    plan.offUs = (plan.chunkBytes * byteNs + 999) / 1000;
+    plan.frameUs = (numBytes * byteNs + 999) / 1000;
+    plan.worstFrameUs = plan.frameUs + (plan.chunks ? plan.chunks - 1 : 0) * config.maxGapUs;
+    plan.maxLowNs = BIT_LOW_MAX_NS + config.maxGapUs * 1000;
+    plan.safe = plan.maxLowNs < config.latchUs * 1000u;
+    return plan;
+}
+
+int chunkReplay(const ChunkConfig& config, const uint32_t* gapsNs, size_t count, bool* latched) {
+    for (size_t i = 0; i < count; i++) {
+        if (gapsNs[i] > config.maxGapUs * 1000u) {
+            if (latched) *latched = BIT_LOW_MAX_NS + gapsNs[i] >= config.latchUs * 1000u;
+            return i;
+        }
+    }
+    if (latched) *latched = false;
+    return -1;
+}
@@ -0,0 +1,43 @@
+#ifndef CHUNK_TIMING_H
+#define CHUNK_TIMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Timing model for sending a frame in chunks with interrupt windows between
+// them. Between chunks the data line sits low, which a WS2812 reads as a
+// latch once it lasts latchUs. A window that ran longer than maxGapUs is
+// detected after the fact and the frame is sent again, so as long as
+// maxGapUs plus the longest bit low time stays under latchUs, no accepted
+// frame can have latched early.
+
+#define BIT_NS          1250    // One 800 KHz bit
+#define BIT_LOW_MAX_NS  850     // Longest low part of a bit (T0L)
+
+typedef struct ChunkConfig {
+    uint16_t maxOffUs;      // Longest stretch with interrupts off
+    uint16_t maxGapUs;      // Longest interrupt window accepted between chunks
+    uint16_t latchUs;       // Low time the strip treats as a latch
+} ChunkConfig;
+
+// WS2812B (pre-V5) latches after 50 us; leave plenty of margin
+static const ChunkConfig defaultChunks = { 40, 20, 50 };
+
+typedef struct ChunkPlan {
+    uint16_t chunkBytes;    // Bytes sent per interrupts-off stretch
+    uint32_t chunks;        // Chunks per frame
+    uint32_t offUs;         // Interrupts-off time per chunk
+    uint32_t frameUs;       // Frame time with no interrupt activity
+    uint32_t worstFrameUs;  // Frame time with every window used in full
+    uint32_t maxLowNs;      // Longest low time the strip can see mid-frame
+    bool     safe;          // maxLowNs is under the latch threshold
+} ChunkPlan;
+
+ChunkPlan chunkPlan(uint32_t numBytes, const ChunkConfig& config);
+
+// Replay measured gaps (in ns, one per chunk boundary) against a config.
+// Returns the index of the first gap that forces a resend, or -1 if the
+// frame goes through; latched is set if that gap was long enough to latch.
+int chunkReplay(const ChunkConfig& config, const uint32_t* gapsNs, size_t count, bool* latched);
+
+#endif
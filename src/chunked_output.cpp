@@ -0,0 +1,94 @@
+#include "chunked_output.h"
+#include <soc/gpio_reg.h>
+
+// Same timing as espShow() in the NeoPixel library
+#define CYCLES_800_T0H  (F_CPU / 2500000) // 0.4us
+#define CYCLES_800_T1H  (F_CPU / 1250000) // 0.8us
+#define CYCLES_800      (F_CPU /  800000) // 1.25us per bit
+#define CYCLES_PER_US   (F_CPU / 1000000)
+
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t getCycleCount(void) __attribute__((always_inline));
+static inline uint32_t getCycleCount(void) {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0,ccount":"=a" (ccount));
+    return ccount;
+}
+
+// Send count bytes, MSB first. Returns the cycle count at the end of the
+// last bit, from which the line is low.
+static uint32_t IRAM_ATTR sendChunk(volatile uint32_t* set, volatile uint32_t* clear,
+                                    uint32_t mask, const uint8_t* p, size_t count) {
+    uint32_t start = getCycleCount() - CYCLES_800, c, t;
+    const uint8_t* end = p + count;
+    for (; p < end; p++) {
+        uint8_t pix = *p;
+        for (uint8_t bit = 0x80; bit; bit >>= 1) {
+            t = (pix & bit) ? CYCLES_800_T1H : CYCLES_800_T0H;
+            while (((c = getCycleCount()) - start) < CYCLES_800);  // Wait for bit start
+            *set = mask;
+            start = c;
+            while ((getCycleCount() - start) < t);                // Wait high duration
+            *clear = mask;
+        }
+    }
+    while ((getCycleCount() - start) < CYCLES_800);                // Wait for last bit
+    return getCycleCount();
+}
+
+ChunkedOutput::ChunkedOutput(uint8_t pin, const ChunkConfig& config) :
+    pin(pin), config(config), endTime(0), resends(0), failures(0) {
+}
+
+bool ChunkedOutput::begin() {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    return chunkPlan(0, config).safe;
+}
+
+void ChunkedOutput::show(const uint8_t* pixels, size_t numBytes) {
+    if (!pixels || !numBytes) return;
+
+    volatile uint32_t* set   = (volatile uint32_t*)(pin < 32 ? GPIO_OUT_W1TS_REG : GPIO_OUT1_W1TS_REG);
+    volatile uint32_t* clear = (volatile uint32_t*)(pin < 32 ? GPIO_OUT_W1TC_REG : GPIO_OUT1_W1TC_REG);
+    uint32_t mask = 1UL << (pin & 31);
+    ChunkPlan plan = chunkPlan(numBytes, config);
+    uint32_t maxGapCycles = config.maxGapUs * CYCLES_PER_US;
+
+    // Latch: see Adafruit_NeoPixel::show()
+    while (!canShow());
+
+    // Interrupts may run between chunks, but no other task on this core
+    vTaskSuspendAll();
+    bool sent = false;
+    for (uint8_t attempt = 0; attempt <= CHUNK_RETRIES && !sent; attempt++) {
+        if (attempt > 0) {
+            resends++;
+            delayMicroseconds(config.latchUs);  // Start over from a clean latch
+        }
+        sent = true;
+        uint32_t lineLow = 0;
+        for (size_t done = 0; done < numBytes; done += plan.chunkBytes) {
+            size_t count = min((size_t)plan.chunkBytes, numBytes - done);
+            portENTER_CRITICAL(&mux);
+            if (done > 0 && getCycleCount() - lineLow > maxGapCycles) {
+                // The window overran; the strip may have latched part of the frame
+                portEXIT_CRITICAL(&mux);
+                sent = false;
+                break;
+            }
+            lineLow = sendChunk(set, clear, mask, pixels + done, count);
+            portEXIT_CRITICAL(&mux);
+        }
+    }
+    xTaskResumeAll();
+
+    if (!sent) failures++;
+    endTime = micros();
+}
+
+// Assumes a 3-byte (RGB-type) strip
+void ChunkedOutput::show(Adafruit_NeoPixel& strip) {
+    show(strip.getPixels(), strip.numPixels() * 3);
+}
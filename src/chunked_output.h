@@ -0,0 +1,40 @@
+#ifndef CHUNKED_OUTPUT_H
+#define CHUNKED_OUTPUT_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "chunk_timing.h"
+
+#define CHUNK_RETRIES   3       // Resends before a frame is given up
+
+// Bit-banged WS2812 output like espShow(), but sent in chunks: interrupts
+// are off for at most maxOffUs at a time, and pending interrupts get a
+// window between chunks while the line is held low. Windows that overrun
+// maxGapUs are caught and the frame is sent again (see chunk_timing.h).
+class ChunkedOutput {
+public:
+    ChunkedOutput(uint8_t pin, const ChunkConfig& config = defaultChunks);
+
+    bool begin();
+
+    void show(const uint8_t* pixels, size_t numBytes);
+    void show(Adafruit_NeoPixel& strip);
+
+    // The CPU clocks every bit itself, so nothing can overlap: same as show()
+    bool showAsync(const uint8_t* pixels, size_t numBytes) { show(pixels, numBytes); return true; }
+    bool showAsync(Adafruit_NeoPixel& strip) { show(strip); return true; }
+
+    bool canShow() const { return micros() - endTime >= config.latchUs; }
+
+    uint32_t resendCount() const { return resends; }
+    uint32_t failedCount() const { return failures; }
+
+private:
+    uint8_t     pin;
+    ChunkConfig config;
+    uint32_t    endTime;
+    uint32_t    resends;
+    uint32_t    failures;
+};
+
+#endif
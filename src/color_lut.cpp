@@ -0,0 +1,86 @@
+#include "color_lut.h"
+#include <math.h>
+
+// Byte positions of R, G, B and W, decoded the same way as
+// Adafruit_NeoPixel::updateType(); returns the bytes per pixel
+static uint8_t decodeType(neoPixelType type, uint8_t* offsets) {
+    offsets[0] = (type >> 4) & 3;
+    offsets[1] = (type >> 2) & 3;
+    offsets[2] = type & 3;
+    offsets[3] = (type >> 6) & 3;
+    return offsets[3] == offsets[0] ? 3 : 4;
+}
+
+ColorLut::ColorLut(neoPixelType type, float gamma) :
+    gamma(gamma), brightness(255), dirty(true) {
+    width = decodeType(type, offsets);
+    memset(balance, 255, sizeof(balance));
+    setSource(type);
+}
+
+void ColorLut::setSource(neoPixelType type) {
+    uint8_t from[4];
+    sourceWidth = decodeType(type, from);
+    memset(source, 0xFF, sizeof(source));
+    for (uint8_t c = 0; c < width; c++) {
+        if (c == 3 && sourceWidth == 3) continue;
+        source[offsets[c]] = from[c];
+    }
+}
+
+void ColorLut::setGamma(float g) {
+    if (g <= 0) return;
+    gamma = g;
+    dirty = true;
+}
+
+void ColorLut::setWhiteBalance(uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+    balance[offsets[0]] = r;
+    balance[offsets[1]] = g;
+    balance[offsets[2]] = b;
+    if (width == 4) balance[offsets[3]] = w;
+    dirty = true;
+}
+
+void ColorLut::setBrightness(uint8_t b) {
+    brightness = b;
+    dirty = true;
+}
+
+void ColorLut::rebuild() {
+    for (uint8_t position = 0; position < width; position++) {
+        // Full level for this channel: white balance times brightness, with
+        // 255 << 8 as the top so linear tables give back the input exactly
+        float top = 65280.0f * balance[position] / 255.0f * brightness / 255.0f;
+        for (int v = 0; v < 256; v++) {
+            tables[position][v] = (uint16_t)(powf(v / 255.0f, gamma) * top + 0.5f);
+        }
+    }
+    dirty = false;
+}
+
+void ColorLut::apply(const uint8_t* src, uint8_t* dst, uint16_t numPixels, uint16_t scale) {
+    if (dirty) rebuild();
+    for (uint16_t i = 0; i < numPixels; i++, src += sourceWidth) {
+        for (uint8_t k = 0; k < width; k++) {
+            uint32_t v = source[k] != 0xFF ? tables[k][src[source[k]]] : 0;
+            if (scale < 256) v = (v * scale) >> 8;
+            v = (v + 0x80) >> 8;
+            *dst++ = v > 255 ? 255 : v;
+        }
+    }
+}
+
+uint16_t ColorLut::apply16(const uint8_t* src, uint16_t* dst, uint16_t numPixels, uint16_t scale) {
+    if (dirty) rebuild();
+    uint16_t any = 0;
+    for (uint16_t i = 0; i < numPixels; i++, src += sourceWidth) {
+        for (uint8_t k = 0; k < width; k++) {
+            uint32_t v = source[k] != 0xFF ? tables[k][src[source[k]]] : 0;
+            if (scale < 256) v = (v * scale) >> 8;
+            *dst++ = v;
+            any |= v;
+        }
+    }
+    return any;
+}
@@ -0,0 +1,57 @@
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <Adafruit_NeoPixel.h>
+
+#define LUT_DEFAULT_GAMMA   2.6f    // Same curve as Adafruit_NeoPixel::gamma8()
+
+// Per-channel lookup tables from 8-bit strip values to 16-bit output levels,
+// folding gamma, white balance and brightness into one lookup. Tables are in
+// the output's byte order (one per byte position) and are rebuilt only when a
+// setting changes, on the next use.
+//
+// The source pixels may be in another color order than the output (e.g. the
+// logical strip is GRB and this output RGB); bytes are reordered in the same
+// pass. White is left off when the source has none.
+class ColorLut {
+public:
+    ColorLut(neoPixelType type = NEO_GRB, float gamma = LUT_DEFAULT_GAMMA);
+
+    // Color order of the pixels passed to apply(); the output's own by default
+    void setSource(neoPixelType type);
+
+    // 1.0 = linear
+    void setGamma(float g);
+    float getGamma() const { return gamma; }
+
+    // Level of each channel for full white, 255 = unchanged
+    void setWhiteBalance(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 255);
+
+    // 0-255, like Adafruit_NeoPixel::setBrightness()
+    void setBrightness(uint8_t b);
+    uint8_t getBrightness() const { return brightness; }
+
+    uint8_t bytesPerPixel() const { return width; }
+
+    // 8-bit output in one pass, further scaled by scale (1-256, 256 = as is)
+    void apply(const uint8_t* src, uint8_t* dst, uint16_t numPixels, uint16_t scale = 256);
+
+    // Same at 16 bits, for dithering. Returns the OR of all values written,
+    // so the caller can tell whether any has a fractional part.
+    uint16_t apply16(const uint8_t* src, uint16_t* dst, uint16_t numPixels, uint16_t scale = 256);
+
+private:
+    void rebuild();
+
+    float    gamma;
+    uint8_t  balance[4];        // Per byte position
+    uint8_t  brightness;
+    uint8_t  width;
+    uint8_t  offsets[4];        // R, G, B, W byte positions in the output
+    uint8_t  sourceWidth;
+    uint8_t  source[4];         // Source byte for each output byte, 0xFF = none
+    bool     dirty;
+    uint16_t tables[4][256];
+};
+
+#endif
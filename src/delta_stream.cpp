@@ -0,0 +1,218 @@
+#include "delta_stream.h"
+#include <string.h>
+
+#define FILL_MIN    4   // Identical pixels worth a FILL run instead of a literal
+#define GAP_MAX     1   // Unchanged pixels a literal may carry rather than split
+
+static inline uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static void putHeader(uint8_t* p, uint8_t type, uint16_t sequence, uint32_t timestamp) {
+    p[0] = DELTA_MAGIC;
+    p[1] = type;
+    put16(p + 2, sequence);
+    put32(p + 4, timestamp);
+}
+
+// Decoder ------------------------------------------------------------------
+
+DeltaDecoder::DeltaDecoder(uint8_t* frame, uint16_t numPixels) :
+    frame(frame), numPixels(numPixels), inSync(false),
+    lastSequence(0), lastTimestamp(0), lost(0) {
+}
+
+DeltaResult DeltaDecoder::decode(const uint8_t* packet, size_t len) {
+    if (len < DELTA_HEADER_SIZE || packet[0] != DELTA_MAGIC) return DELTA_INVALID;
+
+    uint8_t  type      = packet[1] & DELTA_TYPE_MASK;
+    uint16_t sequence  = get16(packet + 2);
+    uint32_t timestamp = get32(packet + 4);
+
+    if (type == DELTA_KEYFRAME) {
+        memset(frame, 0, numPixels * 3);
+        inSync = true;
+    }
+    else if (type == DELTA_FRAME) {
+        int16_t step = sequence - lastSequence;
+        if (inSync && step <= 0) return DELTA_STALE;
+        if (!inSync || step != 1) {
+            if (inSync) lost += step - 1;
+            inSync = false;
+            return DELTA_OUT_OF_SYNC;
+        }
+    }
+    else {
+        return DELTA_INVALID;
+    }
+
+    lastSequence = sequence;
+    lastTimestamp = timestamp;
+    if (!applyRuns(packet + DELTA_HEADER_SIZE, packet + len)) {
+        inSync = false;
+        return DELTA_INVALID;
+    }
+    return (packet[1] & DELTA_FLAG_END) ? DELTA_COMPLETE : DELTA_PARTIAL;
+}
+
+bool DeltaDecoder::applyRuns(const uint8_t* p, const uint8_t* end) {
+    while (p < end) {
+        if (end - p < DELTA_RUN_SIZE) return false;
+        uint8_t  op    = p[0];
+        uint16_t first = get16(p + 1);
+        uint16_t count = get16(p + 3);
+        p += DELTA_RUN_SIZE;
+        if ((uint32_t)first + count > numPixels) return false;
+
+        uint8_t* dst = frame + first * 3;
+        if (op == DELTA_LITERAL) {
+            size_t bytes = count * 3;
+            if ((size_t)(end - p) < bytes) return false;
+            memcpy(dst, p, bytes);
+            p += bytes;
+        }
+        else if (op == DELTA_FILL) {
+            if (end - p < 3) return false;
+            for (uint16_t i = 0; i < count; i++) {
+                dst[0] = p[0];
+                dst[1] = p[1];
+                dst[2] = p[2];
+                dst += 3;
+            }
+            p += 3;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Encoder ------------------------------------------------------------------
+
+// Packet being assembled by deltaEncode()
+typedef struct Packet {
+    uint8_t   data[DELTA_MAX_PACKET];
+    size_t    length;
+    uint8_t   type;
+    uint16_t& sequence;
+    uint32_t  timestamp;
+    DeltaEmit emit;
+    void*     context;
+    size_t    total;
+} Packet;
+
+static void flush(Packet& packet, bool last) {
+    putHeader(packet.data, packet.type | (last ? DELTA_FLAG_END : 0),
+              packet.sequence++, packet.timestamp);
+    packet.emit(packet.data, packet.length, packet.context);
+    packet.total += packet.length;
+    packet.length = DELTA_HEADER_SIZE;
+    packet.type = DELTA_FRAME; // Only the first packet of a keyframe clears
+}
+
+static void putRun(Packet& packet, uint8_t op, uint16_t first, uint16_t count) {
+    uint8_t* p = packet.data + packet.length;
+    p[0] = op;
+    put16(p + 1, first);
+    put16(p + 3, count);
+    packet.length += DELTA_RUN_SIZE;
+}
+
+static void addFill(Packet& packet, const uint8_t* color, uint16_t first, uint16_t count) {
+    if (packet.length + DELTA_RUN_SIZE + 3 > DELTA_MAX_PACKET) flush(packet, false);
+    putRun(packet, DELTA_FILL, first, count);
+    memcpy(packet.data + packet.length, color, 3);
+    packet.length += 3;
+}
+
+static void addLiteral(Packet& packet, const uint8_t* pixels, uint16_t first, uint16_t count) {
+    while (count > 0) {
+        if (packet.length + DELTA_RUN_SIZE + 3 > DELTA_MAX_PACKET) flush(packet, false);
+        uint16_t fits = (DELTA_MAX_PACKET - packet.length - DELTA_RUN_SIZE) / 3;
+        uint16_t n = count < fits ? count : fits;
+        putRun(packet, DELTA_LITERAL, first, n);
+        memcpy(packet.data + packet.length, pixels + first * 3, n * 3);
+        packet.length += n * 3;
+        first += n;
+        count -= n;
+    }
+}
+
+static inline bool samePixel(const uint8_t* a, const uint8_t* b) {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+// Length of the run of identical pixels starting at i
+static uint16_t sameRun(const uint8_t* next, uint16_t i, uint16_t numPixels) {
+    uint16_t j = i + 1;
+    while (j < numPixels && samePixel(next + j * 3, next + i * 3)) j++;
+    return j - i;
+}
+
+size_t deltaEncode(const uint8_t* prev, const uint8_t* next, uint16_t numPixels,
+                   bool keyframe, uint16_t& sequence, uint32_t timestamp,
+                   DeltaEmit emit, void* context) {
+    static const uint8_t black[3] = { 0, 0, 0 };
+    Packet packet = { {0}, DELTA_HEADER_SIZE,
+                      (uint8_t)(keyframe || !prev ? DELTA_KEYFRAME : DELTA_FRAME),
+                      sequence, timestamp, emit, context, 0 };
+    bool full = (packet.type == DELTA_KEYFRAME);
+
+    // A keyframe starts from black, a delta from the previous frame
+    #define CHANGED(k) !samePixel(next + (k) * 3, full ? black : prev + (k) * 3)
+
+    uint16_t i = 0;
+    while (i < numPixels) {
+        if (!CHANGED(i)) {
+            i++;
+            continue;
+        }
+
+        uint16_t run = sameRun(next, i, numPixels);
+        if (run >= FILL_MIN) {
+            addFill(packet, next + i * 3, i, run);
+            i += run;
+            continue;
+        }
+
+        // Grow a literal over changed pixels and short unchanged gaps,
+        // stopping where a solid span is better sent as a fill
+        uint16_t j = i + 1;
+        while (j < numPixels) {
+            if (CHANGED(j)) {
+                if (sameRun(next, j, numPixels) >= FILL_MIN) break;
+                j++;
+                continue;
+            }
+            uint16_t gap = 1;
+            while (j + gap < numPixels && gap <= GAP_MAX && !CHANGED(j + gap)) gap++;
+            if (gap > GAP_MAX || j + gap >= numPixels) break;
+            j += gap;
+        }
+        addLiteral(packet, next, i, j - i);
+        i = j;
+    }
+    #undef CHANGED
+
+    flush(packet, true);
+    return packet.total;
+}
+
+void deltaKeyframeRequest(uint8_t* out, uint16_t sequence) {
+    putHeader(out, DELTA_KEYFRAME_REQUEST, sequence, 0);
+}
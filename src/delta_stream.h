@@ -0,0 +1,82 @@
+#ifndef DELTA_STREAM_H
+#define DELTA_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Delta-encoded frame stream, sent as UDP packets.
+//
+// Every packet starts with an 8-byte little-endian header:
+//   magic (0xD7), type | flags, sequence (uint16), timestamp (uint32, sender ms)
+// followed by a list of runs, each with a 5-byte head:
+//   op, first pixel (uint16), pixel count (uint16)
+// A LITERAL run is followed by count RGB triplets, a FILL run by one.
+//
+// A KEYFRAME packet clears the frame before its runs are applied, a DELTA
+// packet patches the current frame. A frame may span several packets; the
+// last one carries DELTA_FLAG_END. Sequence numbers count packets, so any
+// gap means the frame is out of sync and deltas are ignored until the next
+// keyframe, which the receiver asks for with a KEYFRAME_REQUEST packet.
+
+#define DELTA_MAGIC         0xD7
+#define DELTA_HEADER_SIZE   8
+#define DELTA_RUN_SIZE      5
+#define DELTA_MAX_PACKET    1400    // Keep packets within one WiFi frame
+
+#define DELTA_TYPE_MASK     0x0F
+#define DELTA_FLAG_END      0x80    // Last packet of a frame
+
+enum DeltaType {
+    DELTA_KEYFRAME          = 0,
+    DELTA_FRAME             = 1,
+    DELTA_KEYFRAME_REQUEST  = 2,    // Receiver to sender
+};
+
+enum DeltaOp {
+    DELTA_LITERAL   = 0,
+    DELTA_FILL      = 1,
+};
+
+enum DeltaResult {
+    DELTA_PARTIAL,          // Applied, more packets to come for this frame
+    DELTA_COMPLETE,         // Applied, frame is ready to show
+    DELTA_OUT_OF_SYNC,      // Ignored, a keyframe is needed
+    DELTA_STALE,            // Ignored, duplicate or reordered packet
+    DELTA_INVALID,          // Not a stream packet, or malformed
+};
+
+// Applies packets to an RGB frame buffer in place
+class DeltaDecoder {
+public:
+    DeltaDecoder(uint8_t* frame, uint16_t numPixels);
+
+    DeltaResult decode(const uint8_t* packet, size_t len);
+
+    uint16_t sequence() const { return lastSequence; }
+    uint32_t timestamp() const { return lastTimestamp; }
+    bool     synced() const { return inSync; }
+    uint32_t lostCount() const { return lost; }
+
+private:
+    bool applyRuns(const uint8_t* p, const uint8_t* end);
+
+    uint8_t* frame;
+    uint16_t numPixels;
+    bool     inSync;
+    uint16_t lastSequence;
+    uint32_t lastTimestamp;
+    uint32_t lost;
+};
+
+// Sender side: encode next against prev (NULL or keyframe for a full frame)
+// into as many packets as needed. Each packet is handed to emit(); returns
+// the total number of bytes produced. The sequence number is advanced per packet.
+typedef void (*DeltaEmit)(const uint8_t* packet, size_t len, void* context);
+size_t deltaEncode(const uint8_t* prev, const uint8_t* next, uint16_t numPixels,
+                   bool keyframe, uint16_t& sequence, uint32_t timestamp,
+                   DeltaEmit emit, void* context);
+
+// Build a keyframe request header into out (DELTA_HEADER_SIZE bytes)
+void deltaKeyframeRequest(uint8_t* out, uint16_t sequence);
+
+#endif
@@ -0,0 +1,75 @@
+#include "dither.h"
+#include <stdlib.h>
+#include <string.h>
+
+TemporalDither::TemporalDither(uint16_t numPixels, uint8_t bytesPerPixel) :
+    numBytes((size_t)numPixels * bytesPerPixel), bytesPerPixel(bytesPerPixel),
+    owned(true), fractional(false) {
+    frame = (uint16_t*)calloc(numBytes, sizeof(uint16_t));
+    error = (uint8_t*)malloc(numBytes);
+    if (!frame || !error) {
+        free(frame);
+        free(error);
+        frame = NULL;
+        error = NULL;
+        numBytes = 0;
+        return;
+    }
+    seed();
+}
+
+TemporalDither::TemporalDither(uint16_t* values, uint8_t* errors, uint16_t numPixels,
+                               uint8_t bytesPerPixel) :
+    numBytes((size_t)numPixels * bytesPerPixel), frame(values), error(errors),
+    bytesPerPixel(bytesPerPixel), owned(false), fractional(false) {
+    if (!frame || !error) {
+        frame = NULL;
+        error = NULL;
+        numBytes = 0;
+        return;
+    }
+    memset(frame, 0, numBytes * sizeof(uint16_t));
+    seed();
+}
+
+void TemporalDither::seed() {
+    // Start every channel at a different phase, so pixels holding the same
+    // value don't all step up on the same frame and flicker together
+    for (size_t i = 0; i < numBytes; i++) {
+        error[i] = (uint8_t)(i * 151);
+    }
+}
+
+TemporalDither::~TemporalDither() {
+    if (!owned) return;
+    free(frame);
+    free(error);
+}
+
+void TemporalDither::load(const uint8_t* pixels, ColorLut& lut, uint16_t scale) {
+    if (!frame || lut.bytesPerPixel() != bytesPerPixel) return;
+    uint16_t low = lut.apply16(pixels, frame, numBytes / bytesPerPixel, scale);
+    fractional = (low & 0xFF) != 0;
+}
+
+void TemporalDither::update() {
+    uint16_t low = 0;
+    for (size_t i = 0; i < numBytes; i++) {
+        low |= frame[i];
+    }
+    fractional = (low & 0xFF) != 0;
+}
+
+void TemporalDither::render(uint8_t* out) {
+    for (size_t i = 0; i < numBytes; i++) {
+        uint32_t v = (uint32_t)frame[i] + error[i];
+        if (v > 0xFFFF) {
+            out[i] = 255;       // Nothing brighter to carry the error into
+            error[i] = 0;
+        }
+        else {
+            out[i] = v >> 8;
+            error[i] = (uint8_t)v;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "color_lut.h"
+
+// Frame held at 16 bits per channel and cut down to 8 bits each time it is
+// sent. The part lost to rounding is carried over to the same channel of the
+// next frame (temporal error diffusion), so over a few frames every channel
+// averages out to its 16-bit value. At low brightness that turns ~50 steps
+// into smooth fades, as long as frames keep going out fast.
+//
+// Values are in the strip's own byte order; the dither does not care which
+// byte is which color.
+class TemporalDither {
+public:
+    TemporalDither(uint16_t numPixels, uint8_t bytesPerPixel = 3);
+
+    // On memory owned by the caller: numBytes values and numBytes error bytes
+    TemporalDither(uint16_t* values, uint8_t* errors, uint16_t numPixels,
+                   uint8_t bytesPerPixel = 3);
+    ~TemporalDither();
+
+    bool valid() const { return frame != NULL; }
+
+    // Fill the frame from 8-bit pixels through the color tables, further
+    // scaled by scale (1-256, 256 = as is)
+    void load(const uint8_t* pixels, ColorLut& lut, uint16_t scale = 256);
+
+    // Direct 16-bit access; call update() after writing
+    uint16_t* values() { return frame; }
+    void update();
+
+    // Write the next 8-bit frame to out (numBytes bytes)
+    void render(uint8_t* out);
+
+    // True if rendered frames differ from one another, i.e. the output
+    // needs refreshing even when nothing else changes
+    bool dithering() const { return fractional; }
+
+    size_t size() const { return numBytes; }
+
+private:
+    size_t    numBytes;
+    uint16_t* frame;
+    uint8_t*  error;        // Carried rounding error per channel
+    uint8_t   bytesPerPixel;
+    bool      owned;        // Memory is ours to free
+    bool      fractional;   // Some value is not a whole 8-bit level
+
+    void seed();
+};
+
+#endif
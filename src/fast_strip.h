@@ -0,0 +1,159 @@
+#ifndef FAST_STRIP_H
+#define FAST_STRIP_H
+
+#include <Adafruit_NeoPixel.h>
+
+// Adafruit_NeoPixel with the color order fixed at compile time. The byte
+// offsets and pixel width come from the NEO_* type, so the pixel setters
+// below are straight-line stores instead of re-checking RGB vs RGBW and
+// loading offsets on every call.
+//
+// The strip also keeps the sum of all its channel values, the basis of the
+// current estimate (see power.h), updated by each write instead of by
+// rescanning the frame.
+//
+// It still is an Adafruit_NeoPixel: code holding an Adafruit_NeoPixel&
+// (Adalight, uploads) keeps working through the runtime-typed methods, which
+// give the same results but can't keep the sum: call invalidateLevel() after
+// writing through them.
+template <neoPixelType TYPE>
+class FastStrip : public Adafruit_NeoPixel {
+public:
+    enum {
+        R_OFFSET = (TYPE >> 4) & 3,
+        G_OFFSET = (TYPE >> 2) & 3,
+        B_OFFSET = TYPE & 3,
+        W_OFFSET = (TYPE >> 6) & 3,
+        HAS_WHITE = W_OFFSET != R_OFFSET,
+        BYTES_PER_PIXEL = HAS_WHITE ? 4 : 3,
+    };
+
+    FastStrip(uint16_t n, uint16_t pin) :
+        Adafruit_NeoPixel(n, pin, TYPE), levelSum(0), levelValid(true), adopted(false) {}
+
+    // Adopted memory is not ours to free
+    ~FastStrip() { if (adopted) pixels = NULL; }
+
+    inline void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+        put(n, r, g, b, 0, false);
+    }
+
+    inline void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+        put(n, r, g, b, w, true);
+    }
+
+    inline void setPixelColor(uint16_t n, uint32_t c) {
+        put(n, c >> 16, c >> 8, c, c >> 24, true);
+    }
+
+    inline uint32_t getPixelColor(uint16_t n) const {
+        if (n >= numLEDs) return 0;
+        const uint8_t* p = &pixels[n * BYTES_PER_PIXEL];
+        uint8_t b = brightness;
+        uint32_t c = ((uint32_t)unscale(p[R_OFFSET], b) << 16) |
+                     ((uint32_t)unscale(p[G_OFFSET], b) <<  8) |
+                      (uint32_t)unscale(p[B_OFFSET], b);
+        if (HAS_WHITE) c |= (uint32_t)unscale(p[W_OFFSET], b) << 24;
+        return c;
+    }
+
+    // Same bounds as Adafruit_NeoPixel::fill(); the color is scaled once
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0) {
+        if (first >= numLEDs) return;
+        uint16_t end = (count == 0 || first + count > numLEDs) ? numLEDs : first + count;
+
+        uint8_t pixel[BYTES_PER_PIXEL];
+        pixel[R_OFFSET] = scale(c >> 16, brightness);
+        pixel[G_OFFSET] = scale(c >> 8, brightness);
+        pixel[B_OFFSET] = scale(c, brightness);
+        if (HAS_WHITE) pixel[W_OFFSET] = scale(c >> 24, brightness);
+
+        uint32_t after = sum(pixel);
+        uint8_t* p = &pixels[first * BYTES_PER_PIXEL];
+        for (uint16_t i = first; i < end; i++, p += BYTES_PER_PIXEL) {
+            levelSum += after - sum(p);
+            p[0] = pixel[0];
+            p[1] = pixel[1];
+            p[2] = pixel[2];
+            if (HAS_WHITE) p[3] = pixel[3];
+        }
+    }
+
+    void clear() {
+        Adafruit_NeoPixel::clear();
+        levelSum = 0;
+        levelValid = true;
+    }
+
+    // Rescales every stored pixel
+    void setBrightness(uint8_t b) {
+        Adafruit_NeoPixel::setBrightness(b);
+        levelValid = false;
+    }
+
+    // Sum of every channel value stored
+    uint32_t level() {
+        if (!levelValid) {
+            levelSum = 0;
+            for (uint16_t i = 0; i < numLEDs; i++) {
+                levelSum += sum(&pixels[i * BYTES_PER_PIXEL]);
+            }
+            levelValid = true;
+        }
+        return levelSum;
+    }
+
+    // Pixels were written behind the strip's back; recount on the next level()
+    void invalidateLevel() { levelValid = false; }
+
+    // Show n pixels held in memory owned by the caller (e.g. a Topology
+    // arena) instead of the strip's own buffer
+    void adopt(uint8_t* memory, uint16_t n) {
+        free(pixels);
+        pixels = memory;
+        numLEDs = n;
+        numBytes = n * BYTES_PER_PIXEL;
+        levelValid = false;
+        adopted = true;
+    }
+
+private:
+    // The type is fixed; changing it would invalidate the offsets above
+    using Adafruit_NeoPixel::updateType;
+
+    // Would free adopted memory
+    using Adafruit_NeoPixel::updateLength;
+
+    // Brightness is premultiplied into stored pixels, see setBrightness().
+    // It is passed in: stores through the uint8_t buffer may alias any member,
+    // so a member read after one is a reload.
+    static inline uint8_t scale(uint8_t v, uint8_t brightness) {
+        return brightness ? (v * brightness) >> 8 : v;
+    }
+    static inline uint8_t unscale(uint8_t v, uint8_t brightness) {
+        return brightness ? ((uint32_t)v << 8) / brightness : v;
+    }
+    static inline uint32_t sum(const uint8_t* p) {
+        return HAS_WHITE ? p[0] + p[1] + p[2] + p[3] : p[0] + p[1] + p[2];
+    }
+
+    // Scale, update the level, then store, so nothing is reloaded between stores
+    inline void put(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w, bool white) {
+        if (n >= numLEDs) return;
+        uint8_t* p = &pixels[n * BYTES_PER_PIXEL];
+        uint8_t br = brightness;
+        uint8_t sr = scale(r, br), sg = scale(g, br), sb = scale(b, br);
+        uint8_t sw = HAS_WHITE && white ? scale(w, br) : 0;
+        levelSum += (uint32_t)sr + sg + sb + sw - sum(p);
+        p[R_OFFSET] = sr;
+        p[G_OFFSET] = sg;
+        p[B_OFFSET] = sb;
+        if (HAS_WHITE) p[W_OFFSET] = sw;
+    }
+
+    uint32_t levelSum;
+    bool     levelValid;
+    bool     adopted;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "fft.h"
+#include <math.h>
+#include <stdlib.h>
+
+RealFft::RealFft(uint16_t size) :
+    n(0), bits(0), cosines(NULL), sines(NULL), window(NULL), re(NULL), im(NULL) {
+    if (size < FFT_MIN_SIZE || size > FFT_MAX_SIZE || (size & (size - 1))) return;
+
+    // One allocation for the tables and the work arrays
+    uint16_t half = size / 2;
+    int16_t* memory = (int16_t*)malloc((half * 4 + size) * sizeof(int16_t));
+    if (!memory) return;
+    cosines = memory;
+    sines = cosines + half;
+    re = sines + half;
+    im = re + half;
+    window = im + half;
+
+    n = size;
+    while ((1 << bits) < half) bits++;
+    for (uint16_t k = 0; k < half; k++) {
+        cosines[k] = lroundf(cosf(2 * M_PI * k / n) * 32767);
+        sines[k] = lroundf(sinf(2 * M_PI * k / n) * 32767);
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        window[i] = lroundf((0.5f - 0.5f * cosf(2 * M_PI * i / (n - 1))) * 32767);
+    }
+}
+
+RealFft::~RealFft() {
+    free(cosines);
+}
+
+// In-place radix-2 decimation in time over re/im, n/2 points
+void RealFft::transform() {
+    uint16_t m = n / 2;
+
+    // Bit-reversed order
+    for (uint16_t i = 0; i < m; i++) {
+        uint16_t j = 0;
+        for (uint8_t b = 0; b < bits; b++) j |= ((i >> b) & 1) << (bits - 1 - b);
+        if (j > i) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        uint16_t half = len / 2;
+        uint16_t step = n / len;    // Twiddles of this stage are W_n^(j * step)
+        for (uint16_t i = 0; i < m; i += len) {
+            for (uint16_t j = 0; j < half; j++) {
+                int32_t c = cosines[j * step];
+                int32_t s = sines[j * step];
+                int16_t* ar = &re[i + j];
+                int16_t* ai = &im[i + j];
+                int16_t* br = &re[i + j + half];
+                int16_t* bi = &im[i + j + half];
+                // b * (c - i s)
+                int32_t tr = ((*br * c) >> 15) + ((*bi * s) >> 15);
+                int32_t ti = ((*bi * c) >> 15) - ((*br * s) >> 15);
+                *br = (*ar - tr) >> 1;
+                *bi = (*ai - ti) >> 1;
+                *ar = (*ar + tr) >> 1;
+                *ai = (*ai + ti) >> 1;
+            }
+        }
+    }
+}
+
+void RealFft::power(const int16_t* samples, uint32_t* out) {
+    if (!n) return;
+    uint16_t m = n / 2;
+
+    // Even samples as real parts, odd as imaginary; halved so the packed
+    // magnitude stays within 16 bits
+    for (uint16_t i = 0; i < m; i++) {
+        re[i] = ((int32_t)samples[2 * i] * window[2 * i]) >> 16;
+        im[i] = ((int32_t)samples[2 * i + 1] * window[2 * i + 1]) >> 16;
+    }
+    transform();
+
+    // Split the packed spectrum: X[k] = E[k] + W_n^k O[k]
+    int32_t dc = re[0] + im[0];
+    int32_t nyquist = re[0] - im[0];
+    out[0] = (uint32_t)((dc >> 1) * (dc >> 1));
+    out[m] = (uint32_t)((nyquist >> 1) * (nyquist >> 1));
+    for (uint16_t k = 1; k < m; k++) {
+        int32_t er = (re[k] + re[m - k]) >> 1;
+        int32_t ei = (im[k] - im[m - k]) >> 1;
+        int32_t dr = (re[k] - re[m - k]) >> 1;
+        int32_t di = (im[k] + im[m - k]) >> 1;
+        // O = -i D
+        int32_t orr = di;
+        int32_t oi = -dr;
+        int32_t c = cosines[k];
+        int32_t s = sines[k];
+        int32_t xr = (er + ((orr * c) >> 15) + ((oi * s) >> 15)) >> 1;
+        int32_t xi = (ei + ((oi * c) >> 15) - ((orr * s) >> 15)) >> 1;
+        out[k] = (uint32_t)(xr * xr) + (uint32_t)(xi * xi);
+    }
+}
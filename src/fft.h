@@ -0,0 +1,39 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+#define FFT_MIN_SIZE    16
+#define FFT_MAX_SIZE    1024
+
+// Fixed-point FFT of n real samples, for spectrum analysis: the samples are
+// Hann windowed and packed as n/2 complex values, transformed in Q15 with a
+// halving at every stage so nothing overflows, and unpacked into the n/2 + 1
+// bins of the real spectrum. The tables are made once, at construction.
+class RealFft {
+public:
+    // n a power of two from FFT_MIN_SIZE to FFT_MAX_SIZE; size() is 0 if not,
+    // or out of memory
+    RealFft(uint16_t n);
+    ~RealFft();
+
+    uint16_t size() const { return n; }
+
+    // Squared magnitude of bins 0 to n/2 of samples into power (n/2 + 1
+    // values). Scaled by 1/n^2 and then some: only meant for comparing bins
+    // and windows with each other.
+    void power(const int16_t* samples, uint32_t* power);
+
+private:
+    void transform();
+
+    uint16_t n;
+    uint8_t  bits;      // log2(n / 2)
+    int16_t* cosines;   // cos and sin of 2 pi k / n, k < n/2, Q15
+    int16_t* sines;
+    int16_t* window;    // Hann, Q15
+    int16_t* re;        // Work, n/2 each
+    int16_t* im;
+};
+
+#endif
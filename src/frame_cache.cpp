@@ -0,0 +1,22 @@
+#include "frame_cache.h"
+
+FrameCache::FrameCache(size_t budget) :
+    buffer(NULL), budget(budget), used(0), state(EMPTY), cacheKey(0),
+    length(0), period(0), recorded(0) {
+}
+
+FrameCache::~FrameCache() {
+    free(buffer);
+}
+
+void FrameCache::begin(uint32_t key, uint16_t numPixels, uint16_t frames) {
+    // The buffer is only taken once some theme needs it
+    if (!buffer) buffer = (uint8_t*)malloc(budget);
+    cacheKey = key;
+    length = numPixels;
+    period = frames;
+    used = 0;
+    recorded = 0;
+    start[0] = 0;
+    state = (buffer && numPixels && frames && frames <= FRAME_CACHE_FRAMES) ? RECORDING : FAILED;
+}
@@ -0,0 +1,133 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define FRAME_CACHE_BYTES   16384   // Default budget
+#define FRAME_CACHE_FRAMES  64      // Longest cycle kept
+
+// One cycle of a periodic theme, recorded once and then replayed frame by
+// frame instead of drawing the theme again. Every frame is stored as runs
+// (count, R, G, B; 5 bytes each) or raw (3 bytes per pixel), whichever is
+// smaller, in one buffer of a fixed budget. A cycle that doesn't fit is not
+// kept, and the theme is simply drawn as before.
+//
+// The cache holds one theme, identified by a key chosen by the caller;
+// anything else that changes its frames must call invalidate().
+class FrameCache {
+public:
+    FrameCache(size_t budget = FRAME_CACHE_BYTES);
+    ~FrameCache();
+
+    void invalidate() { state = EMPTY; }
+
+    // True once begin() was called for key and numPixels, whether the cycle
+    // fit or not
+    bool holds(uint32_t key, uint16_t numPixels) const {
+        return state != EMPTY && key == cacheKey && numPixels == length;
+    }
+
+    // True if the cycle is recorded in full and can be replayed
+    bool complete() const { return state == COMPLETE; }
+
+    // Start recording a cycle of period frames
+    void begin(uint32_t key, uint16_t numPixels, uint16_t period);
+
+    // Record the next frame of the cycle from a Layer, IndexedFrame or strip.
+    // False if it doesn't fit, and the cycle is dropped.
+    template <class Canvas>
+    bool record(const Canvas& canvas) {
+        if (state != RECORDING) return false;
+
+        // Size both ways first
+        uint16_t runs = 1;
+        uint32_t last = canvas.getPixelColor(0) & 0xFFFFFF;
+        for (uint16_t i = 1; i < length; i++) {
+            uint32_t c = canvas.getPixelColor(i) & 0xFFFFFF;
+            if (c != last) runs++;
+            last = c;
+        }
+        bool rle = runs * 5u < length * 3u;
+        size_t size = rle ? runs * 5u : length * 3u;
+        if (!buffer || used + size > budget) {
+            state = FAILED;
+            return false;
+        }
+
+        uint8_t* p = buffer + used;
+        if (rle) {
+            uint16_t first = 0;
+            for (uint16_t i = 1; i <= length; i++) {
+                uint32_t c = canvas.getPixelColor(first) & 0xFFFFFF;
+                if (i < length && (canvas.getPixelColor(i) & 0xFFFFFF) == c) continue;
+                p = put(p, i - first, c);
+                first = i;
+            }
+        }
+        else {
+            for (uint16_t i = 0; i < length; i++) {
+                uint32_t c = canvas.getPixelColor(i);
+                *p++ = c >> 16;
+                *p++ = c >> 8;
+                *p++ = c;
+            }
+        }
+        runLength[recorded] = rle;
+        start[recorded++] = used;
+        used += size;
+        start[recorded] = used;
+        if (recorded == period) state = COMPLETE;
+        return true;
+    }
+
+    // Draw frame index, counted from the start of the cycle and wrapping
+    template <class Canvas>
+    void replay(uint32_t index, Canvas& canvas) const {
+        if (state != COMPLETE) return;
+        index %= period;
+        const uint8_t* p = buffer + start[index];
+        const uint8_t* end = buffer + start[index + 1];
+        if (runLength[index]) {
+            for (uint16_t first = 0; p < end; p += 5) {
+                uint16_t count = p[0] | (p[1] << 8);
+                canvas.fill(((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 8) | p[4], first, count);
+                first += count;
+            }
+        }
+        else {
+            for (uint16_t i = 0; p < end; i++, p += 3) {
+                canvas.setPixelColor(i, ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]);
+            }
+        }
+    }
+
+    size_t bytes() const { return used; }
+    uint16_t frames() const { return recorded; }
+
+private:
+    enum { EMPTY, RECORDING, COMPLETE, FAILED };
+
+    static uint8_t* put(uint8_t* p, uint16_t count, uint32_t c) {
+        p[0] = count;
+        p[1] = count >> 8;
+        p[2] = c >> 16;
+        p[3] = c >> 8;
+        p[4] = c;
+        return p + 5;
+    }
+
+    uint8_t* buffer;
+    size_t   budget;
+    size_t   used;
+    uint8_t  state;
+    uint32_t cacheKey;
+    uint16_t length;
+    uint16_t period;
+    uint16_t recorded;
+    uint32_t start[FRAME_CACHE_FRAMES + 1];     // Offsets into buffer; budgets may pass 64 KB
+    bool     runLength[FRAME_CACHE_FRAMES];
+};
+
+#endif
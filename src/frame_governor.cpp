@@ -0,0 +1,71 @@
+#include "frame_governor.h"
+#include <string.h>
+
+FrameGovernor::FrameGovernor(uint16_t maxFps, uint8_t load) :
+    minUs(1000000 / maxFps), maxUs(1000000 / GOVERNOR_FPS_MIN), load(load),
+    lastDue(0), render8(0), send8(0), level(0), lastChange(0),
+    yieldUntil(0) {
+    if (maxUs < minUs) maxUs = minUs;
+    frameUs = minUs;
+    memset(&counters, 0, sizeof(counters));
+    counters.fps = maxFps;
+}
+
+bool FrameGovernor::due(uint64_t now, uint32_t stepUs) {
+    if (stepUs == 0) return false;
+    uint32_t every = stepUs > frameUs ? stepUs : frameUs;
+    uint64_t late = now - lastDue;
+    if (late < every) return false;
+
+    // Carry on from now rather than catching up on frames already missed
+    if (lastDue) counters.skipped += late / every - 1;
+    lastDue = now;
+    return true;
+}
+
+void FrameGovernor::frameDone(uint32_t renderUs, uint32_t sendUs, uint64_t now) {
+    // The first frame seeds the means
+    if (counters.frames++ == 0) {
+        render8 = renderUs << 3;
+        send8 = sendUs << 3;
+    }
+    render8 += renderUs - (render8 >> 3);
+    send8 += sendUs - (send8 >> 3);
+    counters.renderUs = render8 >> 3;
+    counters.sendUs = send8 >> 3;
+
+    uint32_t share = yielding(now / 1000) ? load / 2 : load;
+    uint32_t cost = (render8 + send8) >> 3;
+    uint32_t budget = (uint64_t)frameUs * share / 100;
+    if (renderUs + sendUs > budget) counters.overruns++;
+
+    // Back off at once, speed up gently
+    uint32_t needed = (uint64_t)cost * 100 / share;
+    if (needed > frameUs) {
+        frameUs = needed > maxUs ? maxUs : needed;
+    }
+    else if (cost < budget * 7 / 8 && frameUs > minUs) {
+        frameUs -= frameUs / 16 + 1;
+        if (frameUs < minUs) frameUs = minUs;
+    }
+
+    // At the slowest rate, lower the detail; raise it once there is room,
+    // holding each change long enough for the means to follow
+    if (now - lastChange >= GOVERNOR_HOLD_MS * 1000ULL) {
+        if (needed > maxUs && level < GOVERNOR_DETAIL_MAX) {
+            level++;
+            lastChange = now;
+        }
+        else if (level > 0 && frameUs == minUs && cost < budget / 3) {
+            level--;
+            lastChange = now;
+        }
+    }
+    counters.fps = 1000000 / frameUs;
+    counters.detail = level;
+}
+
+void FrameGovernor::yield(uint32_t nowMs) {
+    yieldUntil = nowMs + GOVERNOR_YIELD_MS;
+    counters.yields++;
+}
@@ -0,0 +1,99 @@
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <stdint.h>
+
+#define GOVERNOR_FPS_MAX    50      // Frame rate cap
+#define GOVERNOR_FPS_MIN    15      // Below this, detail drops instead
+#define GOVERNOR_LOAD       50      // % of each frame the lighting task may take
+#define GOVERNOR_YIELD_MS   250     // How long a request for CPU lasts
+#define GOVERNOR_DETAIL_MAX 2       // Coarsest detail, pixels drawn in 1 << n groups
+#define GOVERNOR_HOLD_MS    1000    // Least time between detail changes
+
+// What the governor decided, exported over REST
+typedef struct GovernorStats {
+    uint32_t fps;           // Frame rate aimed for
+    uint32_t renderUs;      // Mean time to draw a frame
+    uint32_t sendUs;        // Mean time to composite, encode and hand it out
+    uint32_t frames;        // Frames drawn
+    uint32_t skipped;       // Frames not drawn because the one before ran long
+    uint32_t overruns;      // Frames that took more than their budget
+    uint32_t detail;        // 0 full, n draws effects in groups of 1 << n pixels
+    uint32_t yields;        // Times the network asked for CPU
+} GovernorStats;
+
+// Picks the highest frame rate the theme can sustain, up to a cap. Every
+// frame drawn reports how long drawing and sending took; the governor keeps
+// their mean within GOVERNOR_LOAD percent of the frame interval, backing off
+// at once when a frame overruns and speeding up by 1/16 at a time while
+// there is room. At the lowest frame rate it lowers effect detail instead.
+// While the network task has asked for CPU, the budget is halved.
+//
+// Times are us on the animation clock (see animation.h).
+class FrameGovernor {
+public:
+    FrameGovernor(uint16_t maxFps = GOVERNOR_FPS_MAX, uint8_t load = GOVERNOR_LOAD);
+
+    // True if a frame of a theme that changes every stepUs (0 if it holds
+    // still) is due at now. Frames come no faster than the governor allows;
+    // frames that were due and missed since the last one count as skipped.
+    bool due(uint64_t now, uint32_t stepUs);
+
+    // Interval between frames, us
+    uint32_t interval() const { return frameUs; }
+
+    // A frame was drawn in renderUs and sent in sendUs, ending at now
+    void frameDone(uint32_t renderUs, uint32_t sendUs, uint64_t now);
+
+    // Called from the network task when it has work: for GOVERNOR_YIELD_MS
+    // the lighting task takes a smaller share
+    void yield(uint32_t nowMs);
+    bool yielding(uint32_t nowMs) const { return (int32_t)(yieldUntil - nowMs) > 0; }
+
+    // Effects are drawn in groups of 1 << detail() pixels
+    uint8_t detail() const { return level; }
+
+    GovernorStats& stats() { return counters; }
+
+private:
+    uint32_t minUs;             // Interval at the cap
+    uint32_t maxUs;             // Interval at GOVERNOR_FPS_MIN
+    uint8_t  load;
+    uint32_t frameUs;
+    uint64_t lastDue;
+    uint32_t render8;           // Mean times, fixed point * 8
+    uint32_t send8;
+    uint8_t  level;
+    uint64_t lastChange;        // Time detail last changed
+    volatile uint32_t yieldUntil;   // ms, written by the network task
+    GovernorStats counters;
+};
+
+// A canvas seen by an effect at lower detail: each of its pixels covers
+// 1 << shift pixels of canvas (a Layer, IndexedFrame or strip), so the
+// effect computes fewer of them
+template <class Canvas>
+class CoarseCanvas {
+public:
+    CoarseCanvas(Canvas& canvas, uint8_t shift) : canvas(canvas), shift(shift) {}
+
+    uint16_t numPixels() const {
+        return (canvas.numPixels() + (1 << shift) - 1) >> shift;
+    }
+    void setPixelColor(uint16_t n, uint32_t c) {
+        canvas.fill(c, n << shift, 1 << shift);
+    }
+    uint32_t getPixelColor(uint16_t n) const {
+        return canvas.getPixelColor(n << shift);
+    }
+    // Same bounds as Adafruit_NeoPixel::fill()
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0) {
+        canvas.fill(c, first << shift, count << shift);
+    }
+
+private:
+    Canvas& canvas;
+    uint8_t shift;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef GAMES_H
+#define GAMES_H
+
+// Game ids, shared by the REST API, the lighting themes and the
+// per-game emulator output mappings
+typedef enum games {
+    pacman      = 20,
+    digdug      = 21,
+    mario       = 22,
+    dk          = 23,
+    dkjr        = 24,
+    bubblebobble= 25,
+    snowbros    = 26,
+    frogger     = 27,
+    mspacman    = 28
+} games;
+
+#endif
@@ -0,0 +1,81 @@
+#include "http_request.h"
+
+// Wait for the next byte; -1 on timeout
+static int readByte(WiFiClient& client) {
+    unsigned long start = millis();
+    while (!client.available()) {
+        if (!client.connected() || millis() - start > HTTP_TIMEOUT_MS) return -1;
+        delay(1);
+    }
+    return client.read();
+}
+
+size_t readRequestLine(WiFiClient& client, char* buffer, size_t size) {
+    size_t length = 0;
+    while (length < size) {
+        int c = readByte(client);
+        if (c < 0) break;
+        buffer[length++] = c;
+        if (c == '\n') break;
+    }
+    return length;
+}
+
+int readHeaderLine(WiFiClient& client, char* buffer, size_t size) {
+    size_t length = 0;
+    while (true) {
+        int c = readByte(client);
+        if (c < 0) return -1;
+        if (c == '\n') break;
+        if (c != '\r' && length < size - 1) buffer[length++] = c;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+bool requestIs(const char* requestLine, size_t length, const char* methodPath) {
+    size_t pathLength = strlen(methodPath);
+    return length > pathLength && strncmp(requestLine, methodPath, pathLength) == 0
+        && strchr("? \r\n", requestLine[pathLength]);
+}
+
+void respondJson(WiFiClient& client, int status, const char* body) {
+    const char* reason = status == 200 ? "OK" : status == 400 ? "Bad Request"
+                       : status == 411 ? "Length Required" : status == 413 ? "Payload Too Large"
+                       : "Service Unavailable";
+    char head[160];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 %d %s\r\nAccess-Control-Allow-Origin: *\r\n"
+             "Content-Type: application/json\r\nConnection: close\r\n\r\n",
+             status, reason);
+    client.print(head);
+    client.print(body);
+    client.print("\r\n");
+    client.stop();
+}
+
+// Find "name=" as a whole parameter in the query part of a request line
+static const char* findParam(const char* requestLine, const char* name) {
+    const char* query = strchr(requestLine, '?');
+    size_t nameLength = strlen(name);
+    while (query) {
+        query++;
+        if (strncmp(query, name, nameLength) == 0 && query[nameLength] == '=') {
+            return query + nameLength + 1;
+        }
+        query = strpbrk(query, "& \r\n");
+        if (query && *query != '&') return NULL;
+    }
+    return NULL;
+}
+
+long queryInt(const char* requestLine, const char* name, long fallback) {
+    const char* value = findParam(requestLine, name);
+    return (value && isdigit(*value)) ? atol(value) : fallback;
+}
+
+bool queryIs(const char* requestLine, const char* name, const char* value) {
+    const char* found = findParam(requestLine, name);
+    size_t length = strlen(value);
+    return found && strncmp(found, value, length) == 0 && strchr("& \r\n", found[length]);
+}
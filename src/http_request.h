@@ -0,0 +1,46 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTP_TIMEOUT_MS 2000    // Give up on a client silent for this long
+
+// Read raw bytes up to and including the first '\n', or until size bytes.
+// Returns the number of bytes read (0 on timeout), not nul-terminated.
+size_t readRequestLine(WiFiClient& client, char* buffer, size_t size);
+
+// Read one header line without its line ending, nul-terminated and
+// truncated to size. Returns its length, or -1 on timeout.
+int readHeaderLine(WiFiClient& client, char* buffer, size_t size);
+
+// True if a request line is for "METHOD /path", with or without a query
+bool requestIs(const char* requestLine, size_t length, const char* methodPath);
+
+// Answer with a JSON body and close the connection
+void respondJson(WiFiClient& client, int status, const char* body);
+
+// Integer query parameter from a request line, or fallback if absent
+long queryInt(const char* requestLine, const char* name, long fallback);
+
+// True if a query parameter has the given value
+bool queryIs(const char* requestLine, const char* name, const char* value);
+
+// Stream that hands out bytes already read off a client before the client's
+// own, so a request can be inspected and then given to aREST untouched
+class ReplayStream {
+public:
+    ReplayStream(const char* prefix, size_t length, WiFiClient& client) :
+        prefix(prefix), length(length), position(0), client(client) {}
+
+    int available() { return (length - position) + client.available(); }
+    int read() { return position < length ? prefix[position++] : client.read(); }
+
+private:
+    const char* prefix;
+    size_t      length;
+    size_t      position;
+    WiFiClient& client;
+};
+
+#endif
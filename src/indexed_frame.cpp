@@ -0,0 +1,154 @@
+#include "indexed_frame.h"
+#include <string.h>
+
+#define NO_COLOR    0xFFFFFFFF      // Empties the indexOf() cache, no color matches it
+
+IndexedFrame::IndexedFrame(uint16_t paletteSize) : pixels(NULL), length(0) {
+    size = paletteSize < 2 ? 2 : paletteSize > INDEXED_MAX_COLORS ? INDEXED_MAX_COLORS : paletteSize;
+    memset(palette, 0, sizeof(palette));
+    memset(counts, 0, sizeof(counts));
+    used = 1;
+    reserved = 0;
+    lastColor = 0;
+    lastIndex = 0;
+}
+
+void IndexedFrame::adopt(uint8_t* memory, uint16_t numPixels) {
+    pixels = memory;
+    length = memory ? numPixels : 0;
+    clear();
+}
+
+void IndexedFrame::clear() {
+    if (pixels) memset(pixels, 0, length);
+    memset(palette, 0, sizeof(palette));
+    memset(counts, 0, sizeof(counts));
+    counts[0] = length;
+    used = 1;
+    reserved = 0;
+    lastColor = 0;
+    lastIndex = 0;
+}
+
+void IndexedFrame::setPaletteColor(uint8_t index, uint32_t c) {
+    if (index >= size) return;
+    palette[index] = c & 0xFFFFFF;
+    if (index >= used) used = index + 1;
+    lastColor = NO_COLOR;
+}
+
+void IndexedFrame::rotatePalette(uint8_t first, uint16_t count) {
+    if (count < 2 || first + count > size) return;
+    uint32_t last = palette[first + count - 1];
+    memmove(&palette[first + 1], &palette[first], (count - 1) * sizeof(uint32_t));
+    palette[first] = last;
+    if (first + count > used) used = first + count;
+    lastColor = NO_COLOR;
+}
+
+void IndexedFrame::reserve(uint16_t count) {
+    reserved = count < size ? count : size - 1;
+    if (reserved > used) used = reserved;
+    lastColor = NO_COLOR;
+}
+
+uint8_t IndexedFrame::indexOf(uint32_t c) {
+    c &= 0xFFFFFF;
+    if (c == lastColor) return lastIndex;
+
+    uint16_t spare = size;
+    for (uint16_t i = reserved; i < used; i++) {
+        if (palette[i] == c) {
+            lastColor = c;
+            lastIndex = i;
+            return i;
+        }
+        if (spare == size && counts[i] == 0) spare = i;
+    }
+    if (spare == size && used < size) spare = used++;
+
+    if (spare < size) {
+        palette[spare] = c;
+        lastColor = c;
+        lastIndex = spare;
+        return spare;
+    }
+
+    // Full: nearest entry by the sum of channel differences
+    uint16_t best = reserved;
+    uint32_t bestDistance = UINT32_MAX;
+    for (uint16_t i = reserved; i < size; i++) {
+        uint32_t d = 0;
+        for (uint8_t shift = 0; shift < 24; shift += 8) {
+            int32_t diff = (int32_t)((c >> shift) & 0xFF) - (int32_t)((palette[i] >> shift) & 0xFF);
+            d += diff < 0 ? -diff : diff;
+        }
+        if (d < bestDistance) {
+            bestDistance = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void IndexedFrame::fillIndex(uint8_t index, uint16_t first, uint16_t count) {
+    if (first >= length || index >= size) return;
+    uint16_t end = (count == 0 || first + count > length) ? length : first + count;
+    for (uint16_t i = first; i < end; i++) {
+        counts[pixels[i]]--;
+        pixels[i] = index;
+    }
+    counts[index] += end - first;
+    if (index >= used) used = index + 1;
+}
+
+uint32_t IndexedFrame::level() const {
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < used; i++) {
+        uint32_t c = palette[i];
+        total += counts[i] * (((c >> 16) & 0xFF) + ((c >> 8) & 0xFF) + (c & 0xFF));
+    }
+    return total;
+}
+
+uint32_t IndexedFrame::level(uint16_t first, uint16_t count) const {
+    if (first + count > length) return 0;
+    uint16_t sums[INDEXED_MAX_COLORS];
+    for (uint16_t i = 0; i < used; i++) {
+        uint32_t c = palette[i];
+        sums[i] = ((c >> 16) & 0xFF) + ((c >> 8) & 0xFF) + (c & 0xFF);
+    }
+    uint32_t total = 0;
+    for (uint16_t i = first; i < first + count; i++) total += sums[pixels[i]];
+    return total;
+}
+
+void IndexedFrame::encode(ColorLut& lut, uint8_t* out, uint16_t first, uint16_t count, uint16_t scale) {
+    if (first + count > length) return;
+
+    // Palette in GRB, the lut's source order, then corrected into the
+    // output's order; only the entries in use
+    uint8_t grb[INDEXED_MAX_COLORS * 3];
+    uint8_t native[INDEXED_MAX_COLORS * 4];
+    for (uint16_t i = 0; i < used; i++) {
+        grb[i * 3]     = palette[i] >> 8;
+        grb[i * 3 + 1] = palette[i] >> 16;
+        grb[i * 3 + 2] = palette[i];
+    }
+    lut.apply(grb, native, used, scale);
+
+    const uint8_t* p = pixels + first;
+    if (lut.bytesPerPixel() == 4) {
+        for (uint16_t i = 0; i < count; i++, out += 4) {
+            memcpy(out, &native[p[i] * 4], 4);
+        }
+    }
+    else {
+        for (uint16_t i = 0; i < count; i++, out += 3) {
+            const uint8_t* c = &native[p[i] * 3];
+            out[0] = c[0];
+            out[1] = c[1];
+            out[2] = c[2];
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef INDEXED_FRAME_H
+#define INDEXED_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "color_lut.h"
+
+#define INDEXED_MAX_COLORS  256
+
+// Logical strip at one byte per pixel: every pixel is an index into a
+// palette of up to 256 colors. The palette is corrected and put in each
+// strip's color order once per frame, and pixels are expanded from it while
+// the frame is encoded, so a frame of N pixels costs N bytes instead of 3N.
+// Recoloring a theme or cycling colors along the strip only touches the
+// palette.
+//
+// Effects can draw by color, as on a Layer: colors are given palette entries
+// as they come, reusing entries no pixel shows any more. Once the palette is
+// full, new colors get the nearest entry.
+class IndexedFrame {
+public:
+    // paletteSize entries, 2-256
+    IndexedFrame(uint16_t paletteSize = 16);
+
+    // Use numPixels bytes owned by the caller (e.g. a Topology arena)
+    void adopt(uint8_t* memory, uint16_t numPixels);
+
+    uint16_t numPixels() const { return length; }
+    uint8_t* indices() { return pixels; }
+
+    // Palette -------------------------------------------------------------
+
+    uint16_t paletteSize() const { return size; }
+    void setPaletteColor(uint8_t index, uint32_t c);
+    uint32_t getPaletteColor(uint8_t index) const { return palette[index]; }
+
+    // Move count entries from first up by one place (the last one wraps
+    // around to first), for color cycling effects
+    void rotatePalette(uint8_t first, uint16_t count);
+
+    // Keep entries 0 to count - 1 for drawing by index, e.g. to cycle them:
+    // indexOf() neither matches nor hands them out. clear() frees them.
+    void reserve(uint16_t count);
+    uint16_t reservedEntries() const { return reserved; }
+
+    // Entry for color c, added if there is room (see above)
+    uint8_t indexOf(uint32_t c);
+
+    // Drawing -------------------------------------------------------------
+
+    inline void setPixelIndex(uint16_t n, uint8_t index) {
+        if (n >= length || index >= size) return;
+        counts[pixels[n]]--;
+        counts[index]++;
+        pixels[n] = index;
+        if (index >= used) used = index + 1;
+    }
+    inline uint8_t getPixelIndex(uint16_t n) const { return n < length ? pixels[n] : 0; }
+
+    // Same bounds as Adafruit_NeoPixel::fill()
+    void fillIndex(uint8_t index, uint16_t first = 0, uint16_t count = 0);
+
+    void setPixelColor(uint16_t n, uint32_t c) { setPixelIndex(n, indexOf(c)); }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+        setPixelIndex(n, indexOf(((uint32_t)r << 16) | ((uint32_t)g << 8) | b));
+    }
+    uint32_t getPixelColor(uint16_t n) const { return palette[getPixelIndex(n)]; }
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0) { fillIndex(indexOf(c), first, count); }
+
+    // All pixels to entry 0, black, and every other entry free
+    void clear();
+
+    // Sum of every channel value shown (see FastStrip::level()), from the
+    // number of pixels on each entry
+    uint32_t level() const;
+
+    // The same for pixels first to first + count only, pixel by pixel
+    uint32_t level(uint16_t first, uint16_t count) const;
+
+    // Encoding ------------------------------------------------------------
+
+    // Pixels first to first + count through lut (GRB source) into out, in
+    // the lut's color order, scaled by scale (1-256)
+    void encode(ColorLut& lut, uint8_t* out, uint16_t first, uint16_t count, uint16_t scale = 256);
+
+private:
+    uint8_t* pixels;
+    uint16_t length;
+    uint16_t size;
+    uint16_t used;                          // Entries handed out by indexOf()
+    uint16_t reserved;                      // Entries indexOf() leaves alone
+    uint32_t lastColor;                     // indexOf() cache
+    uint8_t  lastIndex;
+    uint32_t palette[INDEXED_MAX_COLORS];   // 0x00RRGGBB
+    uint16_t counts[INDEXED_MAX_COLORS];    // Pixels on each entry
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "jitter_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+JitterBuffer::JitterBuffer(uint16_t numPixels, uint8_t slots) :
+    numPixels(numPixels), frameBytes((size_t)numPixels * 3), slots(slots),
+    delay(JITTER_DELAY_MS), interpolate(false) {
+    // Ring, held frame and output frame share one allocation
+    frames = (uint8_t*)calloc(slots + 2, frameBytes);
+    stamps = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    if (!frames || !stamps) {
+        free(frames);
+        free(stamps);
+        frames = NULL;
+        stamps = NULL;
+        this->numPixels = 0;
+        frameBytes = 0;
+        this->slots = 0;
+    }
+    held = frames + (size_t)slots * frameBytes;
+    out = held + frameBytes;
+    memset(&counters, 0, sizeof(counters));
+    jitter16 = playoutJitter16 = 0;
+    reset();
+}
+
+void JitterBuffer::reset() {
+    head = count = 0;
+    haveOffset = false;
+    havePlayed = false;
+    underrun = false;
+    interval = 0;
+}
+
+void JitterBuffer::push(const uint8_t* frame, uint32_t timestamp, uint32_t now) {
+    if (!slots) return;
+
+    // A sender that jumped back in time has restarted; start over
+    if (havePlayed && (int32_t)(timestamp - lastPlayed) < -JITTER_WINDOW_MS) {
+        reset();
+    }
+
+    int32_t transit = now - timestamp;
+    if (!haveOffset) {
+        haveOffset = true;
+        offset = windowMin = transit;
+        windowStart = now;
+        lastTransit = transit;
+    }
+
+    // Interarrival jitter, J += (|D| - J) / 16 as in RFC 3550
+    int32_t d = transit - lastTransit;
+    if (d < 0) d = -d;
+    jitter16 += d - (jitter16 >> 4);
+    counters.jitter = jitter16 >> 4;
+    lastTransit = transit;
+
+    // Track the fastest transit; follow clock drift by re-basing each window
+    if ((int32_t)(transit - windowMin) < 0) windowMin = transit;
+    if ((int32_t)(transit - offset) < 0) offset = transit;
+    if (now - windowStart >= JITTER_WINDOW_MS) {
+        offset = windowMin;
+        windowMin = transit;
+        windowStart = now;
+    }
+
+    // Too late to be shown, or older than what is already queued or shown
+    uint32_t newest = count ? stamps[(head + count - 1) % slots] : lastPlayed;
+    bool behind = (count || havePlayed) && (int32_t)(timestamp - newest) <= 0;
+    if (behind || (int32_t)(now - due(timestamp)) > 0) {
+        counters.late++;
+        return;
+    }
+
+    if (count || havePlayed) interval = timestamp - newest;
+
+    if (count == slots) {
+        head = (head + 1) % slots;
+        count--;
+        counters.overflow++;
+    }
+    uint8_t index = (head + count) % slots;
+    memcpy(slot(index), frame, frameBytes);
+    stamps[index] = timestamp;
+    count++;
+}
+
+bool JitterBuffer::play(uint32_t now) {
+    if (!slots) return false;
+    bool taken = false;
+
+    // Skip frames whose successor is already due as well
+    while (count > 1 && (int32_t)(now - due(stamps[(head + 1) % slots])) >= 0) {
+        head = (head + 1) % slots;
+        count--;
+        counters.late++;
+    }
+
+    if (count > 0 && (int32_t)(now - due(stamps[head])) >= 0) {
+        uint32_t error = now - due(stamps[head]);
+        playoutJitter16 += error - (playoutJitter16 >> 4);
+        counters.playoutJitter = playoutJitter16 >> 4;
+
+        memcpy(held, slot(head), frameBytes);
+        lastPlayed = stamps[head];
+        havePlayed = true;
+        underrun = false;
+        head = (head + 1) % slots;
+        count--;
+        counters.played++;
+        taken = true;
+    }
+
+    if (!havePlayed) return false;
+
+    if (count == 0) {
+        // The next frame is overdue and nothing is queued: hold the last one
+        if (!underrun && (int32_t)(now - due(lastPlayed) - interval) > 0) {
+            underrun = true;
+            counters.underruns++;
+        }
+        if (taken) memcpy(out, held, frameBytes);
+        return taken;
+    }
+
+    if (!interpolate) {
+        if (taken) memcpy(out, held, frameBytes);
+        return taken;
+    }
+
+    // Blend from the held frame towards the next one as its slot approaches
+    uint32_t from = due(lastPlayed);
+    uint32_t span = due(stamps[head]) - from;
+    uint32_t weight = span ? ((now - from) << 8) / span : 256;
+    if (weight > 256) weight = 256;
+    const uint8_t* a = held;
+    const uint8_t* b = slot(head);
+    for (size_t i = 0; i < frameBytes; i++) {
+        out[i] = a[i] + (((b[i] - a[i]) * (int32_t)weight) >> 8);
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JITTER_SLOTS        8       // Frames held at most
+#define JITTER_DELAY_MS     60      // Default playout delay
+#define JITTER_WINDOW_MS    10000   // Clock offset is re-estimated this often
+
+// Play-out statistics, exported over REST
+typedef struct JitterStats {
+    uint32_t played;        // Frames shown
+    uint32_t late;          // Frames dropped because their slot had passed
+    uint32_t overflow;      // Frames dropped because the ring was full
+    uint32_t underruns;     // Times the ring ran dry and the last frame was held
+    uint32_t jitter;        // Arrival jitter, RFC 3550 style, in ms
+    uint32_t playoutJitter; // Mean error between scheduled and actual play-out, in ms
+} JitterStats;
+
+// Ring of timestamped RGB frames played out against the local clock.
+// A frame stamped t by the sender is shown at local time t + offset + delay,
+// where offset is the smallest transit time seen in the current window.
+class JitterBuffer {
+public:
+    JitterBuffer(uint16_t numPixels, uint8_t slots = JITTER_SLOTS);
+
+    void setDelay(uint32_t ms) { delay = ms; }
+    uint32_t getDelay() const { return delay; }
+
+    // Blend between queued frames instead of holding each until the next
+    void setInterpolate(bool enable) { interpolate = enable; }
+
+    // Queue a frame stamped with the sender's clock, received at local time now
+    void push(const uint8_t* frame, uint32_t timestamp, uint32_t now);
+
+    // Bring the output frame up to date for local time now; true if it changed
+    bool play(uint32_t now);
+
+    const uint8_t* output() const { return out; }
+    JitterStats& stats() { return counters; }
+
+    // Forget queued frames and the clock estimate, e.g. after the stream stops
+    void reset();
+
+private:
+    uint8_t* slot(uint8_t index) const { return frames + (size_t)index * frameBytes; }
+    uint32_t due(uint32_t timestamp) const { return timestamp + offset + delay; }
+
+    uint16_t  numPixels;
+    size_t    frameBytes;
+    uint8_t   slots;
+    uint8_t*  frames;           // slots * frameBytes, one allocation
+    uint32_t* stamps;
+    uint8_t   head;
+    uint8_t   count;
+    uint8_t*  out;              // Frame currently shown
+    uint8_t*  held;             // Last frame taken from the ring, for interpolation
+
+    uint32_t  delay;
+    bool      interpolate;
+    bool      haveOffset;
+    uint32_t  offset;           // Local minus sender clock
+    uint32_t  windowStart;
+    uint32_t  windowMin;
+    int32_t   lastTransit;
+    uint32_t  jitter16;         // Jitter estimates, fixed point * 16
+    uint32_t  playoutJitter16;
+
+    bool      havePlayed;
+    uint32_t  lastPlayed;       // Sender timestamp of the last frame taken
+    uint32_t  interval;         // Sender time between the last two frames
+    bool      underrun;
+
+    JitterStats counters;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "layers.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Channels are handled in two groups, red and blue (MASK_RB) and green
+// (MASK_G), so every lane has 8 bits of headroom for products and carries.
+#define MASK_RB  0x00FF00FFUL
+#define MASK_G   0x0000FF00UL
+
+// dst to src by a (0-256)
+static inline uint32_t mix(uint32_t dst, uint32_t src, uint32_t a) {
+    uint32_t b = 256 - a;
+    uint32_t rb = ((src & MASK_RB) * a + (dst & MASK_RB) * b) >> 8;
+    uint32_t g  = ((src & MASK_G)  * a + (dst & MASK_G)  * b) >> 8;
+    return (rb & MASK_RB) | (g & MASK_G);
+}
+
+// Per channel sum, saturating: the carry out of each lane is turned into a
+// full lane mask and ORed back in
+static inline uint32_t addSaturate(uint32_t dst, uint32_t src) {
+    uint32_t rb = (dst & MASK_RB) + (src & MASK_RB);
+    uint32_t g  = (dst & MASK_G)  + (src & MASK_G);
+    uint32_t rbCarry = rb & 0x01000100UL;
+    uint32_t gCarry  = g  & 0x00010000UL;
+    rb |= rbCarry - (rbCarry >> 8);
+    g  |= gCarry  - (gCarry >> 8);
+    return (rb & MASK_RB) | (g & MASK_G);
+}
+
+// Per channel maximum: a guard bit above each lane survives the subtraction
+// where dst >= src, and is spread into a select mask
+static inline uint32_t maxChannels(uint32_t dst, uint32_t src) {
+    uint32_t rbKeep = ((((dst & MASK_RB) | 0x01000100UL) - (src & MASK_RB)) & 0x01000100UL) >> 8;
+    uint32_t gKeep  = ((((dst & MASK_G)  | 0x00010000UL) - (src & MASK_G))  & 0x00010000UL) >> 8;
+    uint32_t keep = (rbKeep * 0xFF) | (gKeep * 0xFF);
+    return ((dst & keep) | (src & ~keep)) & (MASK_RB | MASK_G);
+}
+
+// Per channel product, 255 * x = x. Lanes need different multipliers, so
+// this one goes channel by channel.
+static inline uint32_t multiply(uint32_t dst, uint32_t src) {
+    uint32_t r = (((dst >> 16) & 0xFF) * (((src >> 16) & 0xFF) + 1)) >> 8;
+    uint32_t g = (((dst >>  8) & 0xFF) * (((src >>  8) & 0xFF) + 1)) >> 8;
+    uint32_t b = (( dst        & 0xFF) * (( src        & 0xFF) + 1)) >> 8;
+    return (r << 16) | (g << 8) | b;
+}
+
+void Layer::fill(uint32_t c, uint16_t first, uint16_t count) {
+    if (first >= length) return;
+    uint16_t end = (count == 0 || first + count > length) ? length : first + count;
+    for (uint16_t i = first; i < end; i++) {
+        words[i] = c;
+    }
+}
+
+LayerStack::~LayerStack() {
+    free(memory);
+}
+
+bool LayerStack::begin(uint16_t numPixels, uint8_t count) {
+    if (count == 0 || count > LAYERS_MAX) return false;
+    free(memory);
+    memory = (uint32_t*)calloc((size_t)(count + 1) * numPixels, sizeof(uint32_t));
+    if (!memory) {
+        layerCount = 0;
+        length = 0;
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        layers[i] = Layer();
+        layers[i].words = memory + (size_t)i * numPixels;
+        layers[i].length = numPixels;
+    }
+    out = memory + (size_t)count * numPixels;
+    layerCount = count;
+    length = numPixels;
+    return true;
+}
+
+const uint32_t* LayerStack::composite(uint8_t count) {
+    memset(out, 0, length * sizeof(uint32_t));
+
+    for (uint8_t l = 0; l < layerCount && l < count; l++) {
+        const Layer& layer = layers[l];
+        if (!layer.visible || layer.opacity == 0) continue;
+        const uint32_t* src = layer.words;
+        uint32_t a = layer.opacity + (layer.opacity >> 7);   // 0-256
+
+        // The mode is chosen once per layer, so each loop is a tight kernel
+        switch (layer.mode) {
+        case BLEND_REPLACE:
+            if (a == 256) {
+                for (uint16_t i = 0; i < length; i++) out[i] = src[i] & (MASK_RB | MASK_G);
+            }
+            else {
+                for (uint16_t i = 0; i < length; i++) out[i] = mix(out[i], src[i], a);
+            }
+            break;
+        case BLEND_ALPHA:
+            for (uint16_t i = 0; i < length; i++) {
+                uint32_t alpha = src[i] >> 24;
+                out[i] = mix(out[i], src[i], ((alpha + (alpha >> 7)) * a) >> 8);
+            }
+            break;
+        case BLEND_ADD:
+            if (a == 256) {
+                for (uint16_t i = 0; i < length; i++) out[i] = addSaturate(out[i], src[i]);
+            }
+            else {
+                // Dim the layer, then add it
+                for (uint16_t i = 0; i < length; i++) out[i] = addSaturate(out[i], mix(0, src[i], a));
+            }
+            break;
+        case BLEND_MAX:
+            for (uint16_t i = 0; i < length; i++) {
+                uint32_t m = maxChannels(out[i], src[i]);
+                out[i] = a == 256 ? m : mix(out[i], m, a);
+            }
+            break;
+        case BLEND_MULTIPLY:
+            for (uint16_t i = 0; i < length; i++) {
+                uint32_t m = multiply(out[i], src[i]);
+                out[i] = a == 256 ? m : mix(out[i], m, a);
+            }
+            break;
+        }
+    }
+    return out;
+}
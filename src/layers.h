@@ -0,0 +1,99 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LAYERS_MAX  8
+
+// How a layer combines with what is below it
+enum BlendMode {
+    BLEND_REPLACE,      // Layer pixels cover the ones below
+    BLEND_ADD,          // Channels added, saturating at 255
+    BLEND_ALPHA,        // Layer pixels cover the ones below by their own alpha (top byte)
+    BLEND_MAX,          // Brighter of the two, per channel
+    BLEND_MULTIPLY,     // Channels multiplied, as a mask
+};
+
+// One framebuffer of the stack. Pixels are packed 0xAARRGGBB words, the same
+// as Adafruit_NeoPixel::Color() with the top byte as alpha, which only
+// BLEND_ALPHA looks at. Effects draw on a layer as they would on the strip.
+class Layer {
+public:
+    Layer() : words(NULL), length(0), mode(BLEND_REPLACE), opacity(255), visible(true) {}
+
+    uint16_t numPixels() const { return length; }
+    uint32_t* pixels() { return words; }
+
+    inline void setPixelColor(uint16_t n, uint32_t c) {
+        if (n < length) words[n] = c;
+    }
+    inline void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+        if (n < length) words[n] = ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+    inline uint32_t getPixelColor(uint16_t n) const {
+        return n < length ? words[n] : 0;
+    }
+
+    // Same bounds as Adafruit_NeoPixel::fill()
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+    void clear() { fill(0); }
+
+    void setMode(BlendMode m) { mode = m; }
+    BlendMode getMode() const { return mode; }
+
+    // 0 hides the layer, 255 blends it in fully
+    void setOpacity(uint8_t o) { opacity = o; }
+    uint8_t getOpacity() const { return opacity; }
+
+    void setVisible(bool v) { visible = v; }
+    bool isVisible() const { return visible; }
+
+private:
+    friend class LayerStack;
+
+    uint32_t* words;
+    uint16_t  length;
+    BlendMode mode;
+    uint8_t   opacity;
+    bool      visible;
+};
+
+// Layers composited bottom (0) to top once per frame, over black. All
+// framebuffers and the output share one allocation. The blend kernels work
+// on whole packed words, two channels per multiply, instead of byte by byte.
+class LayerStack {
+public:
+    LayerStack() : memory(NULL), out(NULL), layerCount(0), length(0) {}
+    ~LayerStack();
+
+    // Allocate count layers of numPixels, cleared, in REPLACE mode
+    bool begin(uint16_t numPixels, uint8_t count);
+
+    uint8_t count() const { return layerCount; }
+    uint16_t numPixels() const { return length; }
+    Layer& layer(uint8_t i) { return layers[i]; }
+    Layer& operator[](uint8_t i) { return layers[i]; }
+
+    // Blend every visible layer, or only the bottom count, into the output;
+    // returns it (numPixels 0x00RRGGBB words)
+    const uint32_t* composite(uint8_t count = LAYERS_MAX);
+
+    // Composite and write the result to a strip
+    template <class Strip>
+    void render(Strip& strip) {
+        const uint32_t* p = composite();
+        for (uint16_t i = 0; i < length; i++) {
+            strip.setPixelColor(i, p[i]);
+        }
+    }
+
+private:
+    uint32_t* memory;
+    uint32_t* out;
+    uint8_t   layerCount;
+    uint16_t  length;
+    Layer     layers[LAYERS_MAX];
+};
+
+#endif
@@ -1,10 +1,34 @@
 // Import required libraries
 #include <WiFi.h>
 #include <ctype.h>
+#define AREST_NUMBER_VARIABLES  20
+#define AREST_NUMBER_FUNCTIONS  20
 #include <aREST.h>
 #include <FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <Preferences.h>
 #include <Adafruit_NeoPixel.h>  // Light control
+#include "fast_strip.h"         // Strip with the color order fixed at compile time
+#include "games.h"
+#include "mame_output.h"        // Emulator lamp outputs
+#include "adalight.h"           // USB frame streaming
+#include "udp_stream.h"         // WiFi frame streaming
+#include "http_request.h"
+#include "pixel_upload.h"       // Binary pixel uploads
+#include "pattern_upload.h"     // Effects uploaded as bytecode
+#include "rmt_output.h"         // WS2812 output through the RMT peripheral
+#include "parallel_output.h"    // Several strips in one pass
+#include "chunked_output.h"     // Bit-banged output with interrupt windows
+#include "topology.h"           // Strips, pins and color correction
+#include "power.h"              // Supply current limit
+#include "layers.h"             // Effects and lamps composited per frame
+#include "transition.h"         // Timed changes between themes
+#include "frame_cache.h"        // Cycles of repeating themes, replayed
+#include "segments.h"           // Named zones with themes of their own
+#include "animation.h"          // Effect timing from a microsecond clock
+#include "frame_governor.h"     // Frame rate and detail the CPU can keep up
+#include "noise.h"              // Fixed-point gradient noise
+#include "audio_input.h"        // Microphone spectrum and beats
 
 // Create aREST instance
 aREST rest = aREST();
@@ -15,9 +39,122 @@ aREST rest = aREST();
 #define ssid        "ddriggs-pixel"
 #define password    "passworD1"
 
-// Lighting string info
-#define LED_PIN     13
-#define LED_COUNT   30
+// MAME network output server (the cabinet PC)
+#define MAME_HOST   "192.168.1.10"
+#define MAME_PORT   8000
+
+// Lighting strings: "pin:length[:order][@offset]", comma separated (see
+// topology.h). Effects see them as one logical strip. This is the default;
+// /setTopology stores another one, used from the next start.
+#define LED_TOPOLOGY    "13:30:GRB"
+
+// Named zones of the logical strip, "name=pixels;..." with pixels and
+// "first-last" runs comma separated (see segments.h), e.g.
+// "marquee=0-19;side=20-23;panel=24-29". Each can be given a theme of its
+// own with /setSegment; the rest shows the main theme. /setSegments stores
+// another definition.
+#define LED_SEGMENTS    ""
+
+// Pixels received from WiFi streams, from the start of the logical strip
+#define STREAM_PIXELS   300
+
+// Blend streamed frames towards the next one queued instead of holding
+// each until its slot; /setStreamInterpolate changes it at run time
+#define STREAM_INTERPOLATE  0
+
+// Output: each strip on its own RMT channel, all strips as lanes sent in one
+// parallel pass, or the first strip bit-banged in chunks with interrupts let
+// through in between
+#define OUTPUT_RMT      0
+#define OUTPUT_PARALLEL 1
+#define OUTPUT_CHUNKED  2
+#define LED_OUTPUT      OUTPUT_RMT
+
+// Brightness (max 255), gamma and white balance (channel levels for full
+// white) are applied together through the color tables as frames are sent.
+// With LED_DITHER the result is kept at 16 bits and dithered over successive
+// frames, instead of being cut to 8 bits where low levels band.
+#define LED_BRIGHTNESS  255
+#define LED_GAMMA       2.6f
+#define LED_WHITE_R     255
+#define LED_WHITE_G     255
+#define LED_WHITE_B     255
+#define LED_DITHER      1
+
+// Supply budget for the strip. Frames estimated above it are dimmed just
+// enough to fit; 400 mA is what full white drew under the old brightness cap
+#define LED_BUDGET_MA   400
+
+// Layers, bottom to top: the theme being left during a transition, the
+// theme (effects, streams and uploads) and the MAME lamps over it
+#define LAYER_OUTGOING  0
+#define LAYER_THEME     1
+#define LAYER_LAMPS     2
+#define LAYER_COUNT     3
+
+// Change between themes: TRANSITION_CUT, _CROSSFADE, _WIPE or _DISSOLVE,
+// over LED_TRANSITION_MS whatever the strip length
+#define LED_TRANSITION      TRANSITION_CROSSFADE
+#define LED_TRANSITION_MS   800
+#define THEME_FRAME_MS      20      // Frame time while a transition runs
+
+// Moving themes run at the highest frame rate up to LED_FPS_MAX whose frames
+// take at most LED_FRAME_LOAD percent of the frame time to draw and send
+#define LED_FPS_MAX         GOVERNOR_FPS_MAX
+#define LED_FRAME_LOAD      GOVERNOR_LOAD
+
+// For large installations: keep the logical strip as one palette index per
+// pixel (LED_PALETTE colors) instead of RGB, without layers. Themes cut
+// over instead of blending, and streams and uploads, being RGB, are not shown.
+#define LED_INDEXED     0
+#define LED_PALETTE     16
+
+// Memory for one cycle of a repeating theme (the Christmas crawl, or a
+// pattern uploaded with ?period=), replayed instead of drawn; 0 turns it off
+#define LED_FRAME_CACHE FRAME_CACHE_BYTES
+
+// Sound from an I2S microphone (INMP441 or similar) for the audio theme.
+// Sampled and analyzed by tasks of their own on the network core.
+#define LED_AUDIO       0
+#define AUDIO_RATE      22050
+#define AUDIO_BCK_PIN   26
+#define AUDIO_WS_PIN    25
+#define AUDIO_DATA_PIN  33
+
+// State for pixels uploaded over the API
+#define STATE_CUSTOM 5
+
+// State for the pattern uploaded over the API
+#define STATE_PATTERN 6
+
+// Moving themes
+#define STATE_RAINBOW 7
+#define STATE_CHASE   8
+#define STATE_LAVA    9
+#define STATE_PLASMA  10
+#define STATE_FIRE    11
+#define STATE_AUDIO   12
+
+// Effect cycles in us. Effects work out where they are from the animation
+// clock, so their speed doesn't depend on the frame rate.
+#define CRAWL_PERIOD_US     6000000 // Christmas crawl, 12 steps of 500 ms
+#define RAINBOW_PERIOD_US   2560000 // Hue around the wheel
+#define CHASE_PERIOD_US     150000  // Marquee lights, a pixel every 50 ms
+#define CHASE_HUE_PERIOD_US 4500000
+
+// Noise effects: pixels per noise cell along the strip, and us for the
+// pattern to move on by a cell
+#define LAVA_PIXELS         16
+#define LAVA_CELL_US        5000000
+#define PLASMA_PIXELS       24
+#define PLASMA_CELL_US      3000000
+#define FIRE_PIXELS         6
+#define FIRE_RISE_US        400000  // Flames moving up the strip
+#define FIRE_CELL_US        1000000 // Flames changing shape
+#define NOISE_CHUNK         64      // Noise values worked out per call
+
+// Audio theme: the strip flashes paler for this long on a beat
+#define AUDIO_FLASH_US      150000
 
 // Create an instance of the server
 WiFiServer server(80);
@@ -33,16 +170,45 @@ void lighting(void* pvParameter);
 // Declare functions to be exposed to the API
 int setLedState(String command);
 int getLedState(String command);
+int writeLedState(int state);
+int setStreamDelay(String command);
+int setStreamInterpolate(String command);
+int setGamma(String command);
+int setTopology(String command);
+int setTransition(String command);
+int setSegments(String command);
+int setSegment(String command);
+int parseLedState(String name);
 
 // Color change functions
-void doAnimation(int frameTime);
-void colorWipe(uint32_t color, int wait);
-void colorWipeAlt(uint32_t color1, uint32_t color2, uint8_t groupSize, int wait);
+template <class Canvas> void drawTheme(int state, Canvas& layer, uint64_t now, PatternState* vm = NULL);
+uint32_t themeStep(int state);
+uint16_t themePeriod(int state);
+bool themeSmooth(int state);
+template <class Canvas> void drawThemeFrame(int state, Canvas& layer, uint64_t now);
+void changeTheme(int from, int to, uint64_t now);
+void renderThemes(int state, uint64_t now, bool force = false);
+bool renderSegments(uint64_t now, bool all);
+void endTransition();
+void beginTopology();
+bool beginOutputs();
+void sendFrames(bool refresh);
+void showStrip();
+void composeStrip();
+void captureStrip();
+void refreshStrip();
+void beginUpload();
+void showUpload();
+void showPattern();
 void colorSet(uint32_t color);
-void colorSetAlt(uint32_t color1, uint32_t color2, uint8_t groupSize, uint8_t offset);
-void theaterChase(uint32_t color, int wait);
-void rainbow(int wait);
-void theaterChaseRainbow(int wait);
+template <class Canvas> void drawAlt(Canvas& layer, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset);
+template <class Canvas> void drawRainbow(Canvas& layer, uint16_t firstHue);
+template <class Canvas> void drawChase(Canvas& layer, uint8_t offset, uint16_t firstHue);
+template <class Canvas> void drawLava(Canvas& layer, uint64_t now);
+template <class Canvas> void drawPlasma(Canvas& layer, uint64_t now);
+template <class Canvas> void drawFire(Canvas& layer, uint64_t now);
+template <class Canvas> void drawAudio(Canvas& layer, uint64_t now);
+uint32_t rampColor(const uint32_t* ramp, uint8_t stops, uint8_t value);
 
 // Global state variable
 uint8_t ledState = 0;
@@ -50,30 +216,137 @@ uint8_t ledState = 0;
 // Semaphore for ^
 SemaphoreHandle_t sem = xSemaphoreCreateMutex();
 
-// LED Object
-Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
-
-typedef enum games {
-    pacman      = 20,
-    digdug      = 21,
-    mario       = 22,
-    dk          = 23,
-    dkjr        = 24,
-    bubblebobble= 25,
-    snowbros    = 26,
-    frogger     = 27,
-    mspacman    = 28
-} games;
+// Semaphore for the strip, held by the lighting task while it renders
+SemaphoreHandle_t stripSem = xSemaphoreCreateMutex();
+
+// Physical strips and all their pixel memory, set up from the stored topology
+Topology topology;
+Preferences preferences;
+bool restartPending = false;
+
+// LED Object: the logical strip, sized by the topology
+FastStrip<NEO_GRB + NEO_KHZ800> strip(0, 0);
+
+// Effects draw on the theme layer, composited into the strip per frame
+LayerStack layers;
+Layer& theme = layers[LAYER_THEME];
+
+#if LED_INDEXED
+// Themes draw straight on the palette-indexed logical strip
+IndexedFrame indexed(LED_PALETTE);
+typedef IndexedFrame ThemeCanvas;
+ThemeCanvas& canvas = indexed;
+#else
+typedef Layer ThemeCanvas;
+ThemeCanvas& canvas = theme;
+#endif
+
+// Zones of the strip with themes of their own, and the pattern VM state of
+// each, so segments showing the pattern don't share its registers
+SegmentMap segments;
+PatternState segmentPatterns[SEGMENTS_MAX];
+
+// Change from the last theme to the current one, and the state of the
+// outgoing theme, or -1 if it is held as it was
+Transition transition(LED_TRANSITION, LED_TRANSITION_MS);
+int outgoingState = -1;
+
+// The current theme's cycle, if it repeats
+FrameCache frameCache(LED_FRAME_CACHE);
+
+// Frame rate and effect detail, from how long frames take
+FrameGovernor governor(LED_FPS_MAX, LED_FRAME_LOAD);
+
+// Where each moving effect is in its cycle
+Phase crawlPhase(CRAWL_PERIOD_US);
+Phase rainbowPhase(RAINBOW_PERIOD_US);
+Phase chasePhase(CHASE_PERIOD_US);
+Phase chaseHuePhase(CHASE_HUE_PERIOD_US);
+
+// Spectrum and beats from the microphone, as of the last frame
+#if LED_AUDIO
+AudioInput audio(AUDIO_RATE);
+#endif
+AudioLevels audioLevels;
+
+// Current estimate for the strips' supply
+PowerBudget power(0, LED_BUDGET_MA);
+
+#if LED_OUTPUT == OUTPUT_PARALLEL
+// Every strip is a lane; RGB-type strips only
+ParallelOutput output;
+#elif LED_OUTPUT == OUTPUT_CHUNKED
+// First strip only. Interrupts off for at most 40 us at a time, windows of up to 20 us
+ChunkedOutput* output = NULL;
+#else
+// One channel per strip; frames go out without tying up the CPU
+RmtOutput* outputs[TOPOLOGY_MAX_STRIPS];
+#endif
+
+// Lamp outputs exported by MAME
+MameOutput mame(MAME_HOST, MAME_PORT, mameGames, mameGameCount);
+
+// Frames streamed from the PC over the USB serial port
+Adalight adalight(Serial, strip);
+
+// Delta-encoded frames streamed over WiFi
+UdpStream udpStream(STREAM_PIXELS);
+
+// POST /pixels
+PixelUpload pixelUpload(theme, stripSem, beginUpload, showUpload);
+
+// POST /pattern, and whether the theme needs drawing again for a new one
+Pattern pattern;
+PatternUpload patternUpload(pattern, stripSem, showPattern);
+bool themeDirty = false;
 
 void setup()
 {
-    // Start Serial
-    Serial.begin(9600);
+    // Start Serial, fast enough to stream frames over
+    adalight.begin(ADALIGHT_BAUD);
     Serial.println("\nStarted initialization process");
 
     // Function to be exposed
     rest.function("getLedState",getLedState);
     rest.function("setLedState",setLedState);
+    rest.function("setStreamDelay",setStreamDelay);
+    rest.function("setStreamInterpolate",setStreamInterpolate);
+    rest.function("setGamma",setGamma);
+    rest.function("setTopology",setTopology);
+    rest.function("setTransition",setTransition);
+    rest.function("setSegments",setSegments);
+    rest.function("setSegment",setSegment);
+
+    // Stream play-out metrics
+    JitterStats& streamStats = udpStream.playout().stats();
+    rest.variable("streamPlayed",&streamStats.played);
+    rest.variable("streamLate",&streamStats.late);
+    rest.variable("streamUnderruns",&streamStats.underruns);
+    rest.variable("streamJitter",&streamStats.jitter);
+    rest.variable("streamPlayoutJitter",&streamStats.playoutJitter);
+
+    // Supply current
+    rest.variable("powerMa",&power.lastMa);
+    rest.variable("powerLimited",&power.limitedFrames);
+
+    // What the frame governor decided
+    GovernorStats& frameStats = governor.stats();
+    rest.variable("frameRate",&frameStats.fps);
+    rest.variable("frameRenderUs",&frameStats.renderUs);
+    rest.variable("frameSendUs",&frameStats.sendUs);
+    rest.variable("frameSkipped",&frameStats.skipped);
+    rest.variable("frameOverruns",&frameStats.overruns);
+    rest.variable("frameDetail",&frameStats.detail);
+    rest.variable("networkYields",&frameStats.yields);
+
+#if LED_AUDIO
+    // Sound analysis
+    AudioStats& audioStats = audio.stats();
+    rest.variable("audioWindows",&audioStats.windows);
+    rest.variable("audioOverruns",&audioStats.overruns);
+    rest.variable("audioAnalyzeUs",&audioStats.analyzeUs);
+    rest.variable("audioLatencyUs",&audioStats.latencyUs);
+#endif
 
     // Give name & ID to the device (ID should be 6 characters long)
     rest.set_id("1");
@@ -90,15 +363,18 @@ void setup()
 
     // Start the server
     server.begin();
+    udpStream.begin(STREAM_PORT);
+    udpStream.playout().setInterpolate(STREAM_INTERPOLATE);
 
     // initialize lighting
-    strip.begin();
-    portDISABLE_INTERRUPTS(); 
-    strip.show();
-    portENABLE_INTERRUPTS();
-    strip.setBrightness(50);   // Max Brightness == 255
+    beginTopology();
+    if (!beginOutputs()) {
+        Serial.println("LED output failed to start");
+    }
+    composeStrip();
 
-    Serial.println("LED Strip initialized");
+    Serial.printf("LED Strip initialized: %u strips, %u pixels, %u bytes\n",
+                  topology.count(), topology.numPixels(), topology.arenaBytes());
 
     // Print the IP address
     Serial.print("Server started at ");
@@ -122,6 +398,17 @@ void setup()
         2,              // Priority of the task
         &taskNetwork,   // Task handle.
         0);             // Core where the task should run
+
+    // Lamp changes wake the lighting task immediately
+    mame.setNotifyTask(taskLighting);
+
+#if LED_AUDIO
+    // Below the network task; beats wake the lighting task like lamps do
+    if (!audio.begin(AUDIO_BCK_PIN, AUDIO_WS_PIN, AUDIO_DATA_PIN, 1, 0)) {
+        Serial.println("Audio input failed to start");
+    }
+    audio.setNotifyTask(taskLighting);
+#endif
     
     Serial.println("Tasks Created");
 }
@@ -134,24 +421,93 @@ void network(void* pvParameter) {
 
     while (true) {
         delay(1);
+
+        // Handle MAME output messages, switching theme when a game starts
+        mame.poll();
+        int gameId;
+        if (mame.takeGameChange(gameId)) {
+            if (gameId >= 0) writeLedState(gameId);
+#if LED_INDEXED
+            // The lamps are painted over the theme, so the last game's
+            // stay until it is drawn again
+            xSemaphoreTake(stripSem, portMAX_DELAY);
+            themeDirty = true;
+            xSemaphoreGive(stripSem);
+#endif
+        }
+
         // Handle REST calls
         WiFiClient client = server.available();
         if (!client) {
             continue;
         }
+        governor.yield(millis());   // Leave the strip free while we answer
         while(!client.available()){
             delay(1);
         }
-        rest.handle(client);
+
+        // Pixel and pattern uploads are handled by us, everything else goes to aREST
+        char requestLine[128];
+        size_t length = readRequestLine(client, requestLine, sizeof(requestLine) - 1);
+        requestLine[length] = '\0';
+        if (PixelUpload::matches(requestLine, length)) {
+            pixelUpload.handle(client, requestLine);
+            continue;
+        }
+        if (PatternUpload::matches(requestLine, length)) {
+            patternUpload.handle(client, requestLine);
+            continue;
+        }
+        ReplayStream request(requestLine, length, client);
+        rest.handle_proto(request, true, 0, true);
+        rest.sendBuffer(client, 0, 0);
+        client.stop();
+        rest.reset_status();
+
+        // A new topology takes effect from a clean start
+        if (restartPending) {
+            delay(100);
+            ESP.restart();
+        }
     }
 }
 
 void lighting(void* pvParameter) {
     Serial.printf("Started lighting tasks on core %i\n", xPortGetCoreID());
-    int frameTime = 1000;
-    uint8_t lastState = -1;
+    int lastState = -1;
+#if LED_AUDIO
+    uint32_t beatsShown = 0;
+#endif
     while (true) {
-        doAnimation(frameTime);
+        xSemaphoreTake(stripSem, portMAX_DELAY);
+
+        // Frames streamed over USB or WiFi take over from the theme while they last
+        if (adalight.poll()) {
+            strip.invalidateLevel();
+            captureStrip();
+            composeStrip();
+        }
+        if (udpStream.poll()) {
+            udpStream.copyTo(strip);
+            strip.invalidateLevel();
+            captureStrip();
+            composeStrip();
+        }
+
+        // Show lamp changes right away; indexed, after a game change, once
+        // the theme has been drawn over the last game's below
+        bool lampsChanged = mame.apply(layers[LAYER_LAMPS], 0xFF000000);
+        if (lampsChanged && !(LED_INDEXED && themeDirty && lastState != STATE_CUSTOM)) {
+            composeStrip();
+        }
+
+        if (adalight.active() || udpStream.active()) {
+            lastState = -1; // Redraw the theme once streaming stops
+            refreshStrip();
+            xSemaphoreGive(stripSem);
+            ulTaskNotifyTake(pdTRUE, 1);
+            continue;
+        }
 
         int temp = -1;
         if( xSemaphoreTake( sem, ( TickType_t ) 100 ) == pdTRUE ) {
@@ -159,52 +515,39 @@ void lighting(void* pvParameter) {
             xSemaphoreGive(sem);
         }
 
-        if (temp != lastState) {
+        // Themes change through a transition, run frame by frame below
+        uint64_t now = animationMicros();
+        if (temp >= 0 && (temp != lastState || themeDirty)) {
+            themeDirty = false;
+            changeTheme(lastState, temp, now);
             lastState = temp;
-            switch (temp) {
-                case 0:
-                    colorWipe(strip.Color(  0,   0,   0), 50); // black
-                    break;
-                case 1:
-                    colorWipe(strip.Color(255,   0,   0), 50); // Red
-                    break;
-                case 2:
-                    colorWipe(strip.Color(  0, 255,   0), 50); // Green
-                    break;
-                case 3:
-                    colorWipe(strip.Color(  0,   0, 255), 50); // Blue
-                    break;
-                case 4: //Christmas
-                    colorWipeAlt(strip.Color(255, 0, 0), strip.Color(0, 255, 0), 6, 50); // red/green crawl
-                    frameTime = 500;
-                    break;
-                case games::bubblebobble:
-                    colorWipeAlt(strip.Color(0, 0, 255), strip.Color(0, 255, 0), LED_COUNT/2, 50); // blue/green
-                    break;
-                case games::mario:
-                    colorWipeAlt(strip.Color(255, 0, 0), strip.Color(0, 255, 0), LED_COUNT/2, 50); // Red/green
-                    break;
-                case games::digdug:
-                    colorWipeAlt(strip.Color(0, 0, 255), strip.Color(255, 165, 0), 6, 50); // Blue/orange crawl
-                    break;
-                case games::mspacman:
-                case games::pacman:
-                    colorWipe(strip.Color(255, 255,   0), 50); // Yellow
-                    break;
-                case games::dkjr: // Donkey kong junior
-                    colorWipe(strip.Color(34, 139,  34), 50); // forest green
-                    break;
-                default:
-                    colorWipe(strip.Color(255, 255,   255), 50); // white
-                    break;
-            }
         }
-        delay(1);
+
+        // A beat is shown straight away instead of at the next frame
+        bool beat = false;
+#if LED_AUDIO
+        if (lastState == STATE_AUDIO && audio.read(audioLevels) && audioLevels.beats != beatsShown) {
+            beatsShown = audioLevels.beats;
+            beat = true;
+        }
+#endif
+        renderThemes(lastState, now, beat);
+
+        // Sleep for a tick, or until a lamp changes. Dithering gives way
+        // while the network is busy
+        if (!governor.yielding(millis())) refreshStrip();
+        xSemaphoreGive(stripSem);
+        ulTaskNotifyTake(pdTRUE, 1);
     }
 }
 
 // Custom function accessible by the API
 int setLedState(String gameId) {
+    return writeLedState(parseLedState(gameId));
+}
+
+// State for a game or theme name, or a state number
+int parseLedState(String gameId) {
     int stateTemp;
     if (gameId.equalsIgnoreCase("pacman")) stateTemp = games::pacman;
     else if (gameId.equalsIgnoreCase("digdug")) stateTemp = games::digdug;
@@ -214,11 +557,23 @@ int setLedState(String gameId) {
     else if (gameId.equalsIgnoreCase("dkjr")) stateTemp = games::dkjr;
     else if (gameId.equalsIgnoreCase("donkeykongjr")) stateTemp = games::dkjr;
     else if (gameId.equalsIgnoreCase("christmas")) stateTemp = 4;
+    else if (gameId.equalsIgnoreCase("pattern")) stateTemp = STATE_PATTERN;
+    else if (gameId.equalsIgnoreCase("rainbow")) stateTemp = STATE_RAINBOW;
+    else if (gameId.equalsIgnoreCase("chase")) stateTemp = STATE_CHASE;
+    else if (gameId.equalsIgnoreCase("lava")) stateTemp = STATE_LAVA;
+    else if (gameId.equalsIgnoreCase("plasma")) stateTemp = STATE_PLASMA;
+    else if (gameId.equalsIgnoreCase("fire")) stateTemp = STATE_FIRE;
+#if LED_AUDIO
+    else if (gameId.equalsIgnoreCase("audio")) stateTemp = STATE_AUDIO;
+#endif
     else stateTemp = gameId.toInt();
+    return stateTemp;
+}
 
-    // Set the global variable atomically
+// Set the global state variable atomically
+int writeLedState(int state) {
     if( xSemaphoreTake( sem, ( TickType_t ) 100 ) == pdTRUE ) {
-        ledState = stateTemp;
+        ledState = state;
         xSemaphoreGive(sem);
         return 0;
     }
@@ -235,165 +590,712 @@ int getLedState(String command) {
     return temp;
 }
 
-void doAnimation(int frametime) {
-    static unsigned long lastFrame = 0;
-    static uint8_t frame = 0;
-    
-    if (millis() - lastFrame < frametime) return;
-    lastFrame = millis();
+// Custom function accessible by the API
+// Sets the gamma of every strip, e.g. "2.2", or of one, e.g. "1:2.2";
+// 1 turns gamma correction off
+int setGamma(String command) {
+    int first = 0;
+    int last = topology.count() - 1;
+    int colon = command.indexOf(':');
+    if (colon >= 0) {
+        first = last = command.substring(0, colon).toInt();
+        command = command.substring(colon + 1);
+    }
+    float gamma = command.toFloat();
+    if (gamma < 0.5f || gamma > 4.0f || first < 0 || last >= topology.count()) return -1;
 
-    int temp = -1;
-    if( xSemaphoreTake( sem, ( TickType_t ) 100 ) == pdTRUE ) {
-        temp = ledState;
-        xSemaphoreGive(sem);
+    if (xSemaphoreTake(stripSem, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) return -1;
+    for (int i = first; i <= last; i++) {
+        topology.lut(i).setGamma(gamma);
     }
+    showStrip();
+    xSemaphoreGive(stripSem);
+    return 0;
+}
+
+// Custom function accessible by the API
+// Stores a new topology (see LED_TOPOLOGY) and restarts to apply it.
+// Returns the number of strips, or -1 if the topology is invalid.
+int setTopology(String command) {
+    StripConfig strips[TOPOLOGY_MAX_STRIPS];
+    uint8_t count = parseTopology(command.c_str(), strips, TOPOLOGY_MAX_STRIPS);
+    if (count == 0) return -1;
+    preferences.begin("lighting", false);
+    preferences.putString("topology", command);
+    preferences.end();
+    restartPending = true;
+    return count;
+}
+
+// Custom function accessible by the API
+// Sets the stream play-out delay in ms
+int setStreamDelay(String command) {
+    int ms = command.toInt();
+    if (ms < 0 || ms > 1000) return -1;
+    udpStream.playout().setDelay(ms);
+    return 0;
+}
 
-    switch (temp) {
-        case 4:
-            if (frame > 11) frame = 0;
-            colorSetAlt(strip.Color(255, 0, 0), strip.Color(0, 255, 0), 6, frame);
-            frame += 1;
+// Custom function accessible by the API
+// 1 blends streamed frames into each other, 0 holds each until the next
+int setStreamInterpolate(String command) {
+    int enable = command.toInt();
+    if (enable < 0 || enable > 1) return -1;
+    udpStream.playout().setInterpolate(enable);
+    return 0;
+}
+
+// Draw the theme for state into layer, as it looks at time now (us on the
+// animation clock). vm is the pattern's state, NULL for the main theme's.
+template <class Canvas>
+void drawTheme(int state, Canvas& layer, uint64_t now, PatternState* vm) {
+    switch (state) {
+        case 0:
+            layer.fill(strip.Color(  0,   0,   0)); // black
+            break;
+        case 1:
+            layer.fill(strip.Color(255,   0,   0)); // Red
+            break;
+        case 2:
+            layer.fill(strip.Color(  0, 255,   0)); // Green
+            break;
+        case 3:
+            layer.fill(strip.Color(  0,   0, 255)); // Blue
+            break;
+        case 4: //Christmas
+            drawAlt(layer, strip.Color(255, 0, 0), strip.Color(0, 255, 0), 6, crawlPhase.step(now, 12)); // red/green crawl
+            break;
+        case games::bubblebobble:
+            drawAlt(layer, strip.Color(0, 0, 255), strip.Color(0, 255, 0), layer.numPixels()/2, 0); // blue/green
+            break;
+        case games::mario:
+            drawAlt(layer, strip.Color(255, 0, 0), strip.Color(0, 255, 0), layer.numPixels()/2, 0); // Red/green
+            break;
+        case games::digdug:
+            drawAlt(layer, strip.Color(0, 0, 255), strip.Color(255, 165, 0), 6, 0); // Blue/orange
+            break;
+        case games::mspacman:
+        case games::pacman:
+            layer.fill(strip.Color(255, 255,   0)); // Yellow
+            break;
+        case games::dkjr: // Donkey kong junior
+            layer.fill(strip.Color(34, 139,  34)); // forest green
+            break;
+        case STATE_PATTERN: // Uploaded over the API
+            if (vm) pattern.render(layer, now / 1000, *vm);
+            else pattern.render(layer, now / 1000);
+            break;
+        case STATE_RAINBOW:
+            drawRainbow(layer, rainbowPhase.at(now) >> 16);
+            break;
+        case STATE_CHASE: // Rainbow marquee
+            drawChase(layer, chasePhase.step(now, 3), chaseHuePhase.at(now) >> 16);
+            break;
+        case STATE_LAVA:
+            drawLava(layer, now);
+            break;
+        case STATE_PLASMA:
+            drawPlasma(layer, now);
+            break;
+        case STATE_FIRE:
+            drawFire(layer, now);
+            break;
+        case STATE_AUDIO:
+            drawAudio(layer, now);
             break;
         default:
+            layer.fill(strip.Color(255, 255,   255)); // white
             break;
     }
 }
 
+// Time between changes of an animated theme in ms, 0 if it holds still
+uint32_t themeStep(int state) {
+    if (state == 4) return CRAWL_PERIOD_US / 12000;
+    if (state == STATE_PATTERN && pattern.animated()) return THEME_FRAME_MS;
+    if (state >= STATE_RAINBOW && state <= STATE_AUDIO) return THEME_FRAME_MS;
+    return 0;
+}
 
-// Some functions of our own for creating animated effects -----------------
+// Steps of themeStep() after which an animated theme repeats, 0 if unknown
+uint16_t themePeriod(int state) {
+    if (state == 4) return 12;
+    if (state == STATE_PATTERN && pattern.animated()) return pattern.getPeriod();
+    return 0;
+}
+
+// True if the theme changes gradually along the strip, so drawing it at
+// lower detail (see CoarseCanvas) only loses sharpness
+bool themeSmooth(int state) {
+    return state == STATE_RAINBOW || state == STATE_LAVA || state == STATE_PLASMA || state == STATE_FIRE;
+}
+
+#if LED_INDEXED
+// The Christmas crawl by palette cycling: its pixels are laid out once on
+// entries of their own, one per place in the pattern, and each step after
+// only rotates those entries. Laid out again whenever the frame is drawn in
+// full (a new theme, game or segments force a redraw).
+bool crawlLaidOut = false;
+uint32_t crawlOffset = 0;
 
-// Fill strip pixels one after another with a color. Strip is NOT cleared
-// first; anything there will be covered pixel by pixel.
-// Args: Color, delay between pixels
-void colorWipe(uint32_t color, int wait) {
-    for(int i=0; i<strip.numPixels(); i++) { // For each pixel in strip...
-        strip.setPixelColor(i, color);         //  Set pixel's color (in RAM)
-        strip.show();
-        delay(wait);                           //  Pause for a moment
+void drawCrawl(IndexedFrame& frame, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset) {
+    uint16_t entries = 2 * groupSize;
+    if (entries >= frame.paletteSize()) {
+        drawAlt(frame, color1, color2, groupSize, offset);
+        return;
+    }
+    if (!crawlLaidOut) {
+        // Entry entries - 1 - k shows place k of the pattern, as in drawAlt()
+        frame.clear();
+        frame.reserve(entries);
+        for (uint16_t k = 0; k < entries; k++) {
+            frame.setPaletteColor(entries - 1 - k, (k + offset) % entries < groupSize ? color1 : color2);
+        }
+        for (uint16_t i = 0; i < frame.numPixels(); i++) {
+            frame.setPixelIndex(i, entries - 1 - i % entries);
+        }
+        crawlLaidOut = true;
     }
+    else {
+        // A step moves every place one pixel along, every entry one up
+        for (uint32_t k = (offset - crawlOffset) % entries; k > 0; k--) {
+            frame.rotatePalette(0, entries);
+        }
+    }
+    crawlOffset = offset;
 }
+#endif
 
-// Same as colorWipe, but alternating between 2 colors
-void colorWipeAlt(uint32_t color1, uint32_t color2, uint8_t groupSize, int wait) {
-    uint8_t currentGroupSize = 0;
-    bool colorSelected = false;
-    for(int i=0; i<strip.numPixels(); i++) { // For each pixel in strip...
-        if (currentGroupSize >= groupSize) {
-            colorSelected = !colorSelected;
-            currentGroupSize = 0;
+// drawTheme(), replaying the theme's cycle from the frame cache if it
+// repeats. The cycle is recorded the first time the theme is drawn, frame k
+// as it looks at k steps; the next theme or pattern takes the cache over.
+template <class Canvas>
+void drawThemeFrame(int state, Canvas& layer, uint64_t now) {
+#if LED_INDEXED
+    // The crawl only moves the palette; anything else has all of it
+    if (state == 4) {
+        drawCrawl(layer, strip.Color(255, 0, 0), strip.Color(0, 255, 0), 6, crawlPhase.step(now, 12));
+        return;
+    }
+    layer.reserve(0);
+    crawlLaidOut = false;
+#endif
+    uint32_t step = themeStep(state) * 1000;
+    uint16_t period = themePeriod(state);
+    if (LED_FRAME_CACHE && step && period) {
+        if (!frameCache.holds(state, layer.numPixels())) {
+            frameCache.begin(state, layer.numPixels(), period);
+            for (uint16_t k = 0; k < period; k++) {
+                drawTheme(state, layer, (uint64_t)k * step);
+                if (!frameCache.record(layer)) break;
+            }
         }
-        if (colorSelected) {
-            strip.setPixelColor(i, color2);
+        if (frameCache.complete()) {
+            frameCache.replay(now / step, layer);
+            return;
         }
-        else {
-            strip.setPixelColor(i, color1);
+    }
+
+    // Fewer pixels for the effect to work out when frames run long. Only
+    // smooth effects look the same that way; groups and every-third-pixel
+    // patterns would come out wider.
+    if (governor.detail() && themeSmooth(state)) {
+        CoarseCanvas<Canvas> coarse(layer, governor.detail());
+        drawTheme(state, coarse, now);
+        return;
+    }
+    drawTheme(state, layer, now);
+}
+
+// Start moving from what is on show to the theme for state to. What is on
+// show becomes the outgoing frame, so a change in the middle of a
+// transition carries on from where it was instead of jumping.
+void changeTheme(int from, int to, uint64_t now) {
+    Layer& outgoing = layers[LAYER_OUTGOING];
+
+    // Uploaded pixels are in the theme layer already
+    if (to == STATE_CUSTOM) {
+        endTransition();
+        return;
+    }
+
+#if LED_INDEXED
+    // An indexed frame can't hold two themes blended
+    renderThemes(to, now, true);
+    return;
+#endif
+
+    memcpy(outgoing.pixels(), layers.composite(LAYER_THEME + 1),
+           outgoing.numPixels() * sizeof(uint32_t));
+    outgoing.setVisible(true);
+
+    // A single theme keeps moving as it fades out, a mix of two or a
+    // replaced pattern is held
+    outgoingState = (transition.active() || from == STATE_CUSTOM || from == to) ? -1 : from;
+    transition.start(now / 1000);
+    renderThemes(to, now, true);
+}
+
+// Show the theme layer on its own, e.g. when a stream takes over
+void endTransition() {
+    transition.cancel();
+    transition.apply(theme, millis());
+    layers[LAYER_OUTGOING].setVisible(false);
+}
+
+// Redraw moving themes, step the transition and show the result, at the
+// theme's own pace or every THEME_FRAME_MS during a transition
+void renderThemes(int state, uint64_t now, bool force) {
+    if (state < 0 || state == STATE_CUSTOM) return;
+
+    // A segment given back to the main theme needs it drawn again
+    for (uint8_t i = 0; i < segments.count(); i++) {
+        if (segments[i].dirty && segments[i].state < 0) {
+            segments[i].dirty = false;
+            force = true;
         }
-        currentGroupSize += 1;
-        strip.show();
-        delay(wait);                           //  Pause for a moment
     }
+
+    uint32_t step = transition.active() ? THEME_FRAME_MS : themeStep(state);
+    bool due = governor.due(now, step * 1000) || force;
+#if LED_INDEXED
+    if (force) crawlLaidOut = false;
+#endif
+    bool drawMain = force || (due && themeStep(state));
+    if (due) {
+        if (transition.active() && themeStep(outgoingState)) {
+            drawTheme(outgoingState, layers[LAYER_OUTGOING], now);
+        }
+        if (drawMain) {
+            drawThemeFrame(state, canvas, now);
+        }
+    }
+
+    // Nothing moved: the frame on show is still right
+    if (!renderSegments(now, drawMain) && !due) return;
+
+    transition.apply(theme, now / 1000);
+    if (!transition.active()) {
+        layers[LAYER_OUTGOING].setVisible(false);
+    }
+    uint64_t drawn = animationMicros();
+    composeStrip();
+    uint64_t sent = animationMicros();
+    governor.frameDone(drawn - now, sent - drawn, sent);
+}
+
+// Draw the segments with themes of their own that are due, or all of them
+// once the main theme has been drawn over them; true if any was drawn
+bool renderSegments(uint64_t now, bool all) {
+    bool drawn = false;
+    for (uint8_t i = 0; i < segments.count(); i++) {
+        Segment& segment = segments[i];
+        if (segment.state < 0) continue;
+        uint32_t step = segment.frameMs ? segment.frameMs : themeStep(segment.state);
+        uint64_t stepUs = max((uint64_t)step * 1000, (uint64_t)governor.interval());
+        if (!all && !segment.dirty && (step == 0 || now - segment.lastFrame < stepUs)) continue;
+        segment.lastFrame = now;
+        segment.dirty = false;
+
+        SegmentCanvas<ThemeCanvas> view(canvas, segments, segment);
+        drawTheme(segment.state, view, now, &segmentPatterns[i]);
+        drawn = true;
+    }
+    return drawn;
+}
+
+// Custom function accessible by the API
+// Sets how themes change, e.g. "wipe", or "dissolve:1500" with the time in ms
+int setTransition(String command) {
+    TransitionType type;
+    int colon = command.indexOf(':');
+    String name = colon >= 0 ? command.substring(0, colon) : command;
+    if (!parseTransition(name.c_str(), type)) return -1;
+    int ms = colon >= 0 ? command.substring(colon + 1).toInt() : transition.getDuration();
+    if (ms < 0 || ms > TRANSITION_MAX_MS) return -1;
+
+    if (xSemaphoreTake(stripSem, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) return -1;
+    transition.setType(type);
+    transition.setDuration(ms);
+    xSemaphoreGive(stripSem);
+    return 0;
+}
+
+// Custom function accessible by the API
+// Stores new segments (see LED_SEGMENTS) and shows them straight away.
+// Returns the number of segments, or -1 if the definition is invalid.
+int setSegments(String command) {
+    if (xSemaphoreTake(stripSem, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) return -1;
+    bool valid = segments.parse(command.c_str(), canvas.numPixels());
+    if (valid) {
+        memset(segmentPatterns, 0, sizeof(segmentPatterns));
+        themeDirty = true;
+    }
+    xSemaphoreGive(stripSem);
+    if (!valid) return -1;
+
+    preferences.begin("lighting", false);
+    preferences.putString("segments", command);
+    preferences.end();
+    return segments.count();
+}
+
+// Custom function accessible by the API
+// Gives a segment a theme, as for /setLedState, and optionally a brightness
+// and frame time in ms: "name:state[:level[:ms]]", e.g. "marquee:christmas"
+// or "panel:pattern:128:50". State -1 shows the main theme again.
+int setSegment(String command) {
+    int colon = command.indexOf(':');
+    if (colon < 0) return -1;
+    String name = command.substring(0, colon);
+    command = command.substring(colon + 1);
+
+    colon = command.indexOf(':');
+    int state = parseLedState(colon >= 0 ? command.substring(0, colon) : command);
+    int level = 255;
+    int ms = 0;
+    if (colon >= 0) {
+        command = command.substring(colon + 1);
+        colon = command.indexOf(':');
+        level = (colon >= 0 ? command.substring(0, colon) : command).toInt();
+        if (colon >= 0) ms = command.substring(colon + 1).toInt();
+    }
+    if (state < -1 || state == STATE_CUSTOM || level < 0 || level > 255 || ms < 0 || ms > 60000) return -1;
+
+    if (xSemaphoreTake(stripSem, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) return -1;
+    Segment* segment = segments.find(name.c_str(), name.length());
+    if (segment) {
+        if (state == STATE_PATTERN && segment->state != STATE_PATTERN) {
+            memset(&segmentPatterns[segment - &segments[0]], 0, sizeof(PatternState));
+        }
+        segment->state = state;
+        segment->level = level;
+        segment->frameMs = ms;
+        segment->dirty = true;
+    }
+    xSemaphoreGive(stripSem);
+    return segment ? 0 : -1;
+}
+
+// Some functions of our own for creating animated effects -----------------
+
+// Set up the strips from the stored topology, or the default one
+void beginTopology() {
+    preferences.begin("lighting", true);
+    String text = preferences.getString("topology", LED_TOPOLOGY);
+    preferences.end();
+
+    StripConfig strips[TOPOLOGY_MAX_STRIPS];
+    uint8_t count = parseTopology(text.c_str(), strips, TOPOLOGY_MAX_STRIPS);
+    bool transmit = LED_OUTPUT == OUTPUT_RMT;
+#if LED_INDEXED
+    IndexedFrame* frame = &indexed;
+#else
+    IndexedFrame* frame = NULL;
+#endif
+    if (!count || !topology.begin(strips, count, LED_DITHER, transmit, frame)) {
+        Serial.println("Topology invalid or too large, using the default");
+        count = parseTopology(LED_TOPOLOGY, strips, TOPOLOGY_MAX_STRIPS);
+        topology.begin(strips, count, LED_DITHER, transmit, frame);
+    }
+
+    for (uint8_t i = 0; i < topology.count(); i++) {
+        ColorLut& lut = topology.lut(i);
+        lut.setGamma(LED_GAMMA);
+        lut.setBrightness(LED_BRIGHTNESS);
+        lut.setWhiteBalance(LED_WHITE_R, LED_WHITE_G, LED_WHITE_B);
+    }
+#if !LED_INDEXED
+    strip.adopt(topology.logical(), topology.numPixels());
+    if (!layers.begin(topology.numPixels(), LAYER_COUNT)) {
+        Serial.println("Not enough memory for the layers");
+    }
+    layers[LAYER_LAMPS].setMode(BLEND_ALPHA);
+#endif
+    power.setNumPixels(topology.physicalPixels());
+
+    preferences.begin("lighting", true);
+    String zones = preferences.getString("segments", LED_SEGMENTS);
+    preferences.end();
+    if (!segments.parse(zones.c_str(), topology.numPixels())) {
+        Serial.println("Segments invalid for this topology, using the default");
+        segments.parse(LED_SEGMENTS, topology.numPixels());
+    }
+}
+
+bool beginOutputs() {
+#if LED_OUTPUT == OUTPUT_PARALLEL
+    uint16_t first = 0;
+    for (uint8_t i = 0; i < topology.count(); i++) {
+        const StripConfig& config = topology.config(i);
+        if (topology.frameBytes(i) != config.length * 3u
+            || !output.addLane(config.pin, first, config.length)) {
+            return false;
+        }
+        first += config.length;
+    }
+    return output.begin();
+#elif LED_OUTPUT == OUTPUT_CHUNKED
+    if (!topology.count()) return false;
+    output = new ChunkedOutput(topology.config(0).pin, defaultChunks);
+    return output->begin();
+#else
+    bool ok = true;
+    for (uint8_t i = 0; i < topology.count(); i++) {
+        outputs[i] = new RmtOutput(topology.config(i).pin, (rmt_channel_t)i);
+        outputs[i]->setBuffers(topology.transmitBuffer(i), topology.frameBytes(i));
+        ok = outputs[i]->begin() && ok;
+    }
+    return ok;
+#endif
+}
+
+// Send every strip's frame, or with refresh only the next dithered frame of
+// strips that need it and whose output is free
+void sendFrames(bool refresh) {
+#if LED_OUTPUT == OUTPUT_RMT
+    for (uint8_t i = 0; i < topology.count(); i++) {
+        if (refresh && !(outputs[i]->canShow() && topology.refresh(i))) continue;
+        outputs[i]->showAsync(topology.frame(i), topology.frameBytes(i));
+    }
+#else
+    if (refresh) {
+  #if LED_OUTPUT == OUTPUT_CHUNKED
+        if (!output || !output->canShow() || !topology.refresh(0)) return;
+  #else
+        if (!output.canShow()) return;
+        bool any = false;
+        for (uint8_t i = 0; i < topology.count(); i++) {
+            any = topology.refresh(i) || any;
+        }
+        if (!any) return;
+  #endif
+    }
+  #if LED_OUTPUT == OUTPUT_CHUNKED
+    if (output) output->showAsync(topology.frame(0), topology.frameBytes(0));
+  #else
+    output.showAsync(topology.allFrames(), topology.allFrameBytes());
+  #endif
+#endif
+}
+
+// Push the strip out. Colors are corrected for each strip on the way out, and frames over the
+// supply budget scaled down in the same pass. Returns as soon as the frames
+// are handed to the outputs, so the next one is rendered while they go out.
+void showStrip() {
+    // Brightness is in the color tables, the power limit scales what is left.
+    // The estimate goes by the uncorrected strip, so it errs on the safe side,
+    // and counts mirrored pixels once for every strip showing them.
+#if LED_INDEXED
+    uint32_t level = topology.level(indexed.level());
+#else
+    uint32_t level = topology.level(strip.level());
+#endif
+    uint16_t brightness = LED_BRIGHTNESS + 1;
+    uint16_t scale = ((uint32_t)power.limit(level, brightness) << 8) / brightness;
+    for (uint8_t i = 0; i < topology.count(); i++) {
+        topology.encode(i, scale);
+    }
+    sendFrames(false);
+}
+
+// Send the next dithered frame of an unchanged strip, if the output is free.
+// Called every pass of the lighting loop, so the dither averages out.
+void refreshStrip() {
+#if LED_DITHER
+    sendFrames(true);
+#endif
+}
+
+// Composite the layers into the strip and show it
+void composeStrip() {
+#if LED_INDEXED
+    mame.apply(indexed);    // No lamp layer, paint them over the theme
+#else
+    layers.render(strip);
+#endif
+    showStrip();
+}
+
+// Take pixels written straight to the strip (streams, uploads) into the
+// theme layer, so the lamps stay over them
+void captureStrip() {
+    endTransition();
+    for (uint16_t i = 0; i < theme.numPixels(); i++) {
+        theme.setPixelColor(i, strip.getPixelColor(i));
+    }
+}
+
+// Switch to a pattern uploaded over the API, or redraw it if already on
+void showPattern() {
+    writeLedState(STATE_PATTERN);
+    frameCache.invalidate();
+    themeDirty = true;
+}
+
+// Pixels uploaded over the API go straight into the theme layer; stop
+// drawing the theme over them
+void beginUpload() {
+    writeLedState(STATE_CUSTOM);
+    endTransition();
+}
+
+// Show pixels uploaded over the API and keep them up
+void showUpload() {
+    composeStrip();
 }
 
 // Seets the entire strand to the given color
 // Args: Color
 void colorSet(uint32_t color) {
-    for(int i=0; i<strip.numPixels(); i++) {
-        strip.setPixelColor(i, color);
+    for(int i=0; i<theme.numPixels(); i++) {
+        theme.setPixelColor(i, color);
     }
-    portDISABLE_INTERRUPTS(); 
-    strip.show();
-    portENABLE_INTERRUPTS();
+    composeStrip();
 }
 
-// sets strip to anternating between color1 and color2 in groups on groupSize, rotate-shifted to the right by offset
-void colorSetAlt(uint32_t color1, uint32_t color2, uint8_t groupSize, uint8_t offset) {
-    uint8_t currentGroupSize = (offset % (2*groupSize));
+// sets layer to anternating between color1 and color2 in groups on groupSize, rotate-shifted to the right by offset
+template <class Canvas>
+void drawAlt(Canvas& layer, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset) {
+    if (groupSize == 0) groupSize = 1;
+    uint16_t currentGroupSize = (offset % (2*groupSize));
     bool colorSelected = false;
     if (currentGroupSize >= groupSize) {
         colorSelected = !colorSelected;
         currentGroupSize -= groupSize;
     }
-    for(int i=0; i<strip.numPixels(); i++) { // For each pixel in strip...
+    for(int i=0; i<layer.numPixels(); i++) { // For each pixel in strip...
         if (currentGroupSize >= groupSize) {
             colorSelected = !colorSelected;
             currentGroupSize = 0;
         }
         if (colorSelected) {
-            strip.setPixelColor(i, color2);
+            layer.setPixelColor(i, color2);
         }
         else {
-            strip.setPixelColor(i, color1);
+            layer.setPixelColor(i, color1);
         }
         currentGroupSize += 1;
     }
-    strip.show();
 }
 
-// Theater-marquee-style chasing lights. Pass in a color (32-bit value,
-// a la strip.Color(r,g,b) as mentioned above), and a delay time (in ms)
-// between frames.
-void theaterChase(uint32_t color, int wait) {
-    for(int a=0; a<10; a++) {  // Repeat 10 times...
-        for(int b=0; b<3; b++) { //  'b' counts from 0 to 2...
-            strip.clear();         //   Set all pixels in RAM to 0 (off)
-            // 'c' counts up from 'b' to end of strip in steps of 3...
-            for(int c=b; c < strip.numPixels(); c += 3) {
-                strip.setPixelColor(c, color); // Set pixel 'c' to value 'color'
-            }
-            portDISABLE_INTERRUPTS(); 
-            strip.show();
-            portENABLE_INTERRUPTS();
-            delay(wait);  // Pause for a moment
+// Rainbow along the whole strip, the first pixel at firstHue; one full turn
+// of the color wheel over the strip's length
+template <class Canvas>
+void drawRainbow(Canvas& layer, uint16_t firstHue) {
+    for(int i=0; i<layer.numPixels(); i++) { // For each pixel in strip...
+        uint16_t pixelHue = firstHue + (i * 65536L / layer.numPixels());
+        // Gamma is applied to every frame on its way out (see showStrip())
+        layer.setPixelColor(i, strip.ColorHSV(pixelHue));
+    }
+}
+
+// Rainbow theater marquee: every third pixel lit, starting at offset (0 to
+// 2), each in the rainbow color of its place along the strip
+template <class Canvas>
+void drawChase(Canvas& layer, uint8_t offset, uint16_t firstHue) {
+    layer.fill(0);
+    // 'c' counts up from 'offset' to end of strip in increments of 3...
+    for(int c=offset; c<layer.numPixels(); c += 3) {
+        uint16_t hue = firstHue + c * 65536L / layer.numPixels();
+        layer.setPixelColor(c, strip.ColorHSV(hue));
+    }
+}
+
+// Noise coordinate (16.16, one cell per unit) that moves on a cell every
+// cellUs of the animation clock
+static uint32_t noiseTime(uint64_t now, uint32_t cellUs) {
+    return (now % ((uint64_t)cellUs << 16)) * 65536 / cellUs;
+}
+
+// Color for value (0-255) along a ramp of evenly spaced color stops
+uint32_t rampColor(const uint32_t* ramp, uint8_t stops, uint8_t value) {
+    uint16_t position = value * (stops - 1);
+    uint8_t i = position >> 8;
+    if (i >= stops - 1) return ramp[stops - 1];
+    uint8_t t = position;
+    uint32_t a = ramp[i], b = ramp[i + 1];
+    uint32_t c = 0;
+    for (uint8_t shift = 0; shift < 24; shift += 8) {
+        int16_t from = (a >> shift) & 0xFF, to = (b >> shift) & 0xFF;
+        c |= (uint32_t)(uint8_t)(from + (((to - from) * t) >> 8)) << shift;
+    }
+    return c;
+}
+
+static const uint32_t lavaRamp[] = { 0x000000, 0x500000, 0xC01000, 0xFF5000, 0xFFB020 };
+static const uint32_t fireRamp[] = { 0x000000, 0x600000, 0xFF2000, 0xFF9000, 0xFFFF80 };
+
+// Slow blobs of molten color
+template <class Canvas>
+void drawLava(Canvas& layer, uint64_t now) {
+    int16_t row[NOISE_CHUNK];
+    uint32_t t = noiseTime(now, LAVA_CELL_US);
+    uint32_t dx = 65536 / LAVA_PIXELS;
+    for (uint16_t first = 0; first < layer.numPixels(); first += NOISE_CHUNK) {
+        uint16_t count = min(NOISE_CHUNK, layer.numPixels() - first);
+        noiseRow2(row, count, first * dx, dx, t);
+        for (uint16_t i = 0; i < count; i++) {
+            // Doubled contrast, noise rarely strays far from the middle
+            int16_t v = (row[i] >> 7) + 128;
+            layer.setPixelColor(first + i, rampColor(lavaRamp, 5, v < 0 ? 0 : v > 255 ? 255 : v));
         }
     }
 }
 
-// Rainbow cycle along whole strip. Pass delay time (in ms) between frames.
-void rainbow(int wait) {
-    // Hue of first pixel runs 5 complete loops through the color wheel.
-    // Color wheel has a range of 65536 but it's OK if we roll over, so
-    // just count from 0 to 5*65536. Adding 256 to firstPixelHue each time
-    // means we'll make 5*65536/256 = 1280 passes through this outer loop:
-    for(long firstPixelHue = 0; firstPixelHue < 5*65536; firstPixelHue += 256) {
-        for(int i=0; i<strip.numPixels(); i++) { // For each pixel in strip...
-            // Offset pixel hue by an amount to make one full revolution of the
-            // color wheel (range of 65536) along the length of the strip
-            // (strip.numPixels() steps):
-            int pixelHue = firstPixelHue + (i * 65536L / strip.numPixels());
-            // strip.ColorHSV() can take 1 or 3 arguments: a hue (0 to 65535) or
-            // optionally add saturation and value (brightness) (each 0 to 255).
-            // Here we're using just the single-argument hue variant. The result
-            // is passed through strip.gamma32() to provide 'truer' colors
-            // before assigning to each pixel:
-            strip.setPixelColor(i, strip.gamma32(strip.ColorHSV(pixelHue)));
+// Hues flowing along the strip, from two layers of noise at different scales
+template <class Canvas>
+void drawPlasma(Canvas& layer, uint64_t now) {
+    int16_t coarse[NOISE_CHUNK], fine[NOISE_CHUNK];
+    uint32_t t = noiseTime(now, PLASMA_CELL_US);
+    uint32_t dx = 65536 / PLASMA_PIXELS;
+    for (uint16_t first = 0; first < layer.numPixels(); first += NOISE_CHUNK) {
+        uint16_t count = min(NOISE_CHUNK, layer.numPixels() - first);
+        noiseRow3(coarse, count, first * dx, dx, t, t >> 1);
+        noiseRow2(fine, count, first * dx * 3, dx * 3, t * 2);
+        for (uint16_t i = 0; i < count; i++) {
+            layer.setPixelColor(first + i, strip.ColorHSV((coarse[i] + (fine[i] >> 1)) * 2));
         }
-        portDISABLE_INTERRUPTS(); 
-        strip.show();
-        portENABLE_INTERRUPTS();
-        delay(wait);  // Pause for a moment
-    }
-}
-
-// Rainbow-enhanced theater marquee. Pass delay time (in ms) between frames.
-void theaterChaseRainbow(int wait) {
-    int firstPixelHue = 0;     // First pixel starts at red (hue 0)
-    for(int a=0; a<30; a++) {  // Repeat 30 times...
-        for(int b=0; b<3; b++) { //  'b' counts from 0 to 2...
-            strip.clear();         //   Set all pixels in RAM to 0 (off)
-            // 'c' counts up from 'b' to end of strip in increments of 3...
-            for(int c=b; c<strip.numPixels(); c += 3) {
-                // hue of pixel 'c' is offset by an amount to make one full
-                // revolution of the color wheel (range 65536) along the length
-                // of the strip (strip.numPixels() steps):
-                int      hue   = firstPixelHue + c * 65536L / strip.numPixels();
-                uint32_t color = strip.gamma32(strip.ColorHSV(hue)); // hue -> RGB
-                strip.setPixelColor(c, color); // Set pixel 'c' to value 'color'
-            }
-            portDISABLE_INTERRUPTS(); 
-            strip.show();                // Update strip with new contents
-            portENABLE_INTERRUPTS();
-            delay(wait);                 // Pause for a moment
-            firstPixelHue += 65536 / 90; // One cycle of color wheel over 90 frames
+    }
+}
+
+// Flames rising from the first pixel, cooling towards the end of the strip
+template <class Canvas>
+void drawFire(Canvas& layer, uint64_t now) {
+    int16_t row[NOISE_CHUNK];
+    uint32_t rise = noiseTime(now, FIRE_RISE_US);
+    uint32_t t = noiseTime(now, FIRE_CELL_US);
+    uint32_t dx = 65536 / FIRE_PIXELS;
+    uint16_t n = layer.numPixels();
+    for (uint16_t first = 0; first < n; first += NOISE_CHUNK) {
+        uint16_t count = min(NOISE_CHUNK, n - first);
+        noiseRow2(row, count, first * dx - rise, dx, t);
+        for (uint16_t i = 0; i < count; i++) {
+            int32_t heat = noise8(row[i]) + 96 - (int32_t)(first + i) * 320 / n;
+            heat = heat < 0 ? 0 : heat > 255 ? 255 : heat;
+            layer.setPixelColor(first + i, rampColor(fireRamp, 5, heat));
         }
     }
 }
+
+// Octave bands along the strip, bass first in red up to treble in violet,
+// each pixel between the two bands either side of it. The strip flashes
+// paler on a beat.
+template <class Canvas>
+void drawAudio(Canvas& layer, uint64_t now) {
+#if LED_AUDIO
+    audio.read(audioLevels);
+#endif
+    int64_t age = now - audioLevels.beatUs;
+    if (age < 0) age = 0;
+    uint8_t flash = audioLevels.beats && age < AUDIO_FLASH_US ? 255 - age * 255 / AUDIO_FLASH_US : 0;
+    uint16_t n = layer.numPixels();
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t position = (uint32_t)i * ((AUDIO_BANDS - 1) << 8) / (n > 1 ? n - 1 : 1);
+        uint8_t band = position >> 8;
+        uint8_t next = band < AUDIO_BANDS - 1 ? band + 1 : band;
+        int16_t from = audioLevels.bands[band], to = audioLevels.bands[next];
+        uint8_t value = from + (((to - from) * (int16_t)(position & 0xFF)) >> 8);
+        layer.setPixelColor(i, strip.ColorHSV(position * 27, 255 - flash / 2, max(value, flash)));
+    }
+}
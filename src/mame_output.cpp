@@ -0,0 +1,164 @@
+#include "mame_output.h"
+#include "games.h"
+
+// Per-game output tables ---------------------------------------------------
+
+// Control panel pixels at the end of the strip
+#define PANEL_P1    24
+#define PANEL_P2    27
+
+// Start button lamps, shared by most of the cabinet's games
+static const OutputMapping startLamps[] = {
+    { "led0", PANEL_P1, 3, 0xFFFFFF, 0x000000 },   // Player 1 start
+    { "led1", PANEL_P2, 3, 0xFFFFFF, 0x000000 },   // Player 2 start
+};
+
+static const OutputMapping pacmanLamps[] = {
+    { "led0", PANEL_P1, 3, 0xFFFF00, 0x000000 },   // Player 1 start, yellow
+    { "led1", PANEL_P2, 3, 0xFFFF00, 0x000000 },   // Player 2 start, yellow
+};
+
+static const OutputMapping digdugLamps[] = {
+    { "led0", PANEL_P1, 3, 0x0000FF, 0x000000 },   // Player 1 start, blue
+    { "led1", PANEL_P2, 3, 0xFFA500, 0x000000 },   // Player 2 start, orange
+};
+
+#define MAPPINGS(m) m, sizeof(m) / sizeof(m[0])
+
+const GameOutputs mameGames[] = {
+    { games::pacman,       "pacman",   MAPPINGS(pacmanLamps) },
+    { games::mspacman,     "mspacman", MAPPINGS(pacmanLamps) },
+    { games::digdug,       "digdug",   MAPPINGS(digdugLamps) },
+    { games::mario,        "mario",    MAPPINGS(startLamps) },
+    { games::dk,           "dkong",    MAPPINGS(startLamps) },
+    { games::dkjr,         "dkongjr",  MAPPINGS(startLamps) },
+    { games::bubblebobble, "bublbobl", MAPPINGS(startLamps) },
+    { games::snowbros,     "snowbros", MAPPINGS(startLamps) },
+    { games::frogger,      "frogger",  MAPPINGS(startLamps) },
+};
+const uint8_t mameGameCount = sizeof(mameGames) / sizeof(mameGames[0]);
+
+// MameOutput ---------------------------------------------------------------
+
+MameOutput::MameOutput(const char* host, uint16_t port,
+                       const GameOutputs* games, uint8_t gameCount) :
+    host(host), port(port), lastAttempt(-MAME_RETRY_MS),  // First attempt at once
+    games(games), gameCount(gameCount), current(NULL), lineLength(0),
+    lock(xSemaphoreCreateMutex()), changed(false), gameChanged(false),
+    gameId(-1), notifyTask(NULL) {
+    memset(values, 0, sizeof(values));
+}
+
+void MameOutput::poll() {
+    if (!client.connected()) {
+        if (millis() - lastAttempt < MAME_RETRY_MS) return;
+        lastAttempt = millis();
+        lineLength = 0;
+        if (!client.connect(host, port)) return;
+        client.setNoDelay(true);
+    }
+
+    // Read in chunks; one output message is only a few bytes
+    char buffer[64];
+    int available;
+    while ((available = client.available()) > 0) {
+        int n = client.read((uint8_t*)buffer, min(available, (int)sizeof(buffer)));
+        if (n <= 0) break;
+        feed(buffer, n);
+    }
+}
+
+void MameOutput::feed(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        feed(data[i]);
+    }
+}
+
+void MameOutput::feed(char c) {
+    if (c == '\r' || c == '\n') {
+        if (lineLength > 0) {
+            line[lineLength] = '\0';
+            handleLine(line);
+        }
+        lineLength = 0;
+    }
+    else if (lineLength < sizeof(line) - 1) {
+        line[lineLength++] = c;
+    }
+    // Overlong lines are truncated and will simply not match any output
+}
+
+// Lines look like "name = value"
+void MameOutput::handleLine(char* line) {
+    char* separator = strstr(line, " = ");
+    if (!separator) return;
+    *separator = '\0';
+    const char* name = line;
+    const char* value = separator + 3;
+
+    if (strcmp(name, "mame_start") == 0) {
+        const GameOutputs* game = NULL;
+        for (uint8_t i = 0; i < gameCount; i++) {
+            if (strcmp(games[i].rom, value) == 0) {
+                game = &games[i];
+                break;
+            }
+        }
+        selectGame(game);
+    }
+    else if (strcmp(name, "mame_stop") == 0) {
+        selectGame(NULL);
+    }
+    else {
+        setValue(name, atoi(value));
+    }
+}
+
+void MameOutput::selectGame(const GameOutputs* game) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    current = game;
+    memset(values, 0, sizeof(values));
+    gameId = game ? game->game : -1;
+    gameChanged = true;
+    changed = true;
+    xSemaphoreGive(lock);
+}
+
+void MameOutput::setValue(const char* name, int value) {
+    if (!current) return;
+    uint8_t on = value ? 1 : 0;
+    bool notify = false;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < current->count && i < MAME_MAX_MAPPINGS; i++) {
+        if (values[i] != on && strcmp(current->map[i].name, name) == 0) {
+            values[i] = on;
+            changed = notify = true;
+        }
+    }
+    xSemaphoreGive(lock);
+
+    // Wake the lighting task so the lamp is shown without waiting a frame
+    if (notify && notifyTask) {
+        xTaskNotifyGive(notifyTask);
+    }
+}
+
+bool MameOutput::snapshot(const GameOutputs*& game, uint8_t* lamps) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool wasChanged = changed;
+    changed = false;
+    game = current;
+    memcpy(lamps, values, sizeof(values));
+    xSemaphoreGive(lock);
+    return wasChanged;
+}
+
+bool MameOutput::takeGameChange(int& id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool result = gameChanged;
+    gameChanged = false;
+    id = gameId;
+    xSemaphoreGive(lock);
+    return result;
+}
@@ -0,0 +1,112 @@
+#ifndef MAME_OUTPUT_H
+#define MAME_OUTPUT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/semphr.h>
+#include <Adafruit_NeoPixel.h>
+#include "layers.h"
+
+#define MAME_MAX_NAME       32      // Longest output name we keep
+#define MAME_MAX_MAPPINGS   16      // Most outputs mapped for one game
+#define MAME_RETRY_MS       5000    // Delay between connection attempts
+
+// Maps one named MAME output (lamp, led, lockout...) onto a run of pixels
+typedef struct OutputMapping {
+    const char* name;       // Output name as sent by MAME, e.g. "led0"
+    uint16_t    first;      // First pixel of the segment
+    uint16_t    count;      // Number of pixels in the segment
+    uint32_t    onColor;    // Color while the output is non-zero
+    uint32_t    offColor;   // Color while the output is zero
+} OutputMapping;
+
+// Mapping table for one game, selected by its id from games.h
+typedef struct GameOutputs {
+    int                  game;      // Game id (see games.h)
+    const char*          rom;       // MAME rom name reported in mame_start
+    const OutputMapping* map;
+    uint8_t              count;
+} GameOutputs;
+
+// Client for MAME's network output protocol. MAME sends "name = value\r"
+// lines to every connected client; known names are mapped to pixel segments
+// through the per-game tables.
+class MameOutput {
+public:
+    MameOutput(const char* host, uint16_t port,
+               const GameOutputs* games, uint8_t gameCount);
+
+    // Network side: keep the connection alive and parse whatever arrived.
+    // Call often from the network task.
+    void poll();
+
+    // Parser entry points, exposed so the protocol can be driven without a socket
+    void feed(const char* data, size_t len);
+    void feed(char c);
+
+    // Lighting side: paint every mapped segment into the strip, or a layer
+    // (see layers.h), with alpha ORed into the colors.
+    // Returns true if any output changed since the last call.
+    // A template so a FastStrip gets its own fill().
+    template <class Strip>
+    bool apply(Strip& strip, uint32_t alpha = 0) {
+        const GameOutputs* game;
+        uint8_t lamps[MAME_MAX_MAPPINGS];
+        bool wasChanged = snapshot(game, lamps);
+        if (game) {
+            for (uint8_t i = 0; i < game->count && i < MAME_MAX_MAPPINGS; i++) {
+                const OutputMapping& m = game->map[i];
+                strip.fill((lamps[i] ? m.onColor : m.offColor) | alpha, m.first, m.count);
+            }
+        }
+        return wasChanged;
+    }
+
+    // A layer is cleared to transparent first, so the lamps of a game that
+    // stopped or changed don't stay composited over the theme
+    bool apply(Layer& layer, uint32_t alpha) {
+        layer.clear();
+        return apply<Layer>(layer, alpha);
+    }
+
+    // True (once) when MAME started or stopped a game; id is -1 on stop
+    bool takeGameChange(int& gameId);
+
+    // Task to notify when an output changes, so it can show immediately
+    void setNotifyTask(TaskHandle_t task) { notifyTask = task; }
+
+    bool connected() { return client.connected(); }
+
+private:
+    // Copy the running game and its lamp states out under the lock, so
+    // painting never holds it; true if any changed since the last copy
+    bool snapshot(const GameOutputs*& game, uint8_t* lamps);
+    void handleLine(char* line);
+    void selectGame(const GameOutputs* game);
+    void setValue(const char* name, int value);
+
+    const char*         host;
+    uint16_t            port;
+    WiFiClient          client;
+    unsigned long       lastAttempt;
+
+    const GameOutputs*  games;
+    uint8_t             gameCount;
+    const GameOutputs*  current;        // Table for the running game, NULL if none
+
+    char                line[MAME_MAX_NAME + 16];
+    uint8_t             lineLength;
+
+    // Shared between the network and lighting tasks, guarded by lock
+    SemaphoreHandle_t   lock;
+    uint8_t             values[MAME_MAX_MAPPINGS];
+    bool                changed;
+    bool                gameChanged;
+    int                 gameId;
+    TaskHandle_t        notifyTask;
+};
+
+extern const GameOutputs mameGames[];
+extern const uint8_t mameGameCount;
+
+#endif
@@ -0,0 +1,175 @@
+#include "noise.h"
+
+// Ken Perlin's permutation, doubled up by masking instead of repeating it
+static const uint8_t perm[256] = {
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180,
+};
+
+// Fade curve 6t^5 - 15t^4 + 10t^3 over the fraction's top 8 bits, Q16
+static const uint16_t fadeTable[257] = {
+        0,     0,     0,     1,     2,     5,     8,    13,    19,    27,    37,    49,
+       63,    79,    99,   121,   145,   173,   204,   239,   277,   319,   364,   414,
+      467,   524,   586,   652,   723,   798,   878,   963,  1052,  1146,  1246,  1350,
+     1460,  1574,  1695,  1820,  1951,  2087,  2229,  2376,  2529,  2687,  2851,  3021,
+     3196,  3377,  3564,  3757,  3955,  4159,  4369,  4585,  4806,  5033,  5266,  5505,
+     5749,  5999,  6255,  6517,  6784,  7057,  7335,  7619,  7909,  8204,  8504,  8810,
+     9121,  9438,  9759, 10086, 10418, 10755, 11098, 11445, 11797, 12154, 12515, 12882,
+    13253, 13628, 14008, 14393, 14781, 15174, 15571, 15973, 16378, 16787, 17199, 17616,
+    18036, 18460, 18887, 19317, 19751, 20187, 20627, 21070, 21515, 21963, 22414, 22867,
+    23323, 23781, 24241, 24703, 25168, 25634, 26101, 26571, 27042, 27514, 27987, 28462,
+    28938, 29415, 29892, 30370, 30849, 31329, 31808, 32288, 32768, 33248, 33728, 34207,
+    34687, 35166, 35644, 36121, 36598, 37074, 37549, 38022, 38494, 38965, 39435, 39902,
+    40368, 40833, 41295, 41755, 42213, 42669, 43122, 43573, 44021, 44466, 44909, 45349,
+    45785, 46219, 46649, 47076, 47500, 47920, 48337, 48749, 49158, 49563, 49965, 50362,
+    50755, 51143, 51528, 51908, 52283, 52654, 53021, 53382, 53739, 54091, 54438, 54781,
+    55118, 55450, 55777, 56098, 56415, 56726, 57032, 57332, 57627, 57917, 58201, 58479,
+    58752, 59019, 59281, 59537, 59787, 60031, 60270, 60503, 60730, 60951, 61167, 61377,
+    61581, 61779, 61972, 62159, 62340, 62515, 62685, 62849, 63007, 63160, 63307, 63449,
+    63585, 63716, 63841, 63962, 64076, 64186, 64290, 64390, 64484, 64573, 64658, 64738,
+    64813, 64884, 64950, 65012, 65069, 65122, 65172, 65217, 65259, 65297, 65332, 65363,
+    65391, 65415, 65437, 65457, 65473, 65487, 65499, 65509, 65517, 65523, 65528, 65531,
+    65534, 65535, 65535, 65535, 65535,
+};
+
+// Gradients: 1D +-1..8, 2D the axes and diagonals, 3D the cube's 12 edges
+// (4 repeated to make 16)
+static const int8_t grad1[16] = { 1, 2, 3, 4, 5, 6, 7, 8, -1, -2, -3, -4, -5, -6, -7, -8 };
+static const int8_t grad2x[8] = { 1, -1, 1, -1, 1, -1, 0, 0 };
+static const int8_t grad2y[8] = { 1, 1, -1, -1, 0, 0, 1, -1 };
+static const int8_t grad3x[16] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0 };
+static const int8_t grad3y[16] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1 };
+static const int8_t grad3z[16] = { 0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1 };
+
+// Dot products and weights are worked in Q12, one cell = 4096, which keeps
+// every product within 32 bits
+#define ONE         4096
+
+// Results to 16 bits, Q8. The largest values possible are 4 cells (1D:
+// gradients of 8 and -8, midway), 1 (2D) and 1.036 (3D), worked out corner
+// by corner for every place in a cell; the scales map them to just under
+// 32640, so clamp16() is only a guard against rounding.
+#define SCALE1      510
+#define SCALE2      2040
+#define SCALE3      1970
+
+static inline uint8_t hash(uint8_t a, uint8_t b) {
+    return perm[(uint8_t)(perm[a] + b)];
+}
+
+static inline int32_t fade(uint16_t f) {
+    uint8_t i = f >> 8;
+    int32_t a = fadeTable[i];
+    int32_t b = fadeTable[i + 1];
+    return (a + (((b - a) * (f & 0xFF)) >> 8)) >> 4;
+}
+
+static inline int32_t lerp(int32_t a, int32_t b, int32_t t) {
+    return a + (((b - a) * t) >> 12);
+}
+
+static inline int16_t clamp16(int32_t v) {
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+void noiseRow1(int16_t* out, uint16_t count, uint32_t x, uint32_t dx) {
+    int32_t g0 = 0, g1 = 0;
+    int32_t cell = -1;
+    for (uint16_t i = 0; i < count; i++, x += dx) {
+        if ((int32_t)(x >> 16) != cell) {
+            cell = x >> 16;
+            g0 = grad1[perm[(uint8_t)cell] & 15];
+            g1 = grad1[perm[(uint8_t)(cell + 1)] & 15];
+        }
+        int32_t f = (x & 0xFFFF) >> 4;
+        int32_t n = lerp(g0 * f, g1 * (f - ONE), fade(x));
+        out[i] = clamp16((n * SCALE1) >> 8);
+    }
+}
+
+void noiseRow2(int16_t* out, uint16_t count, uint32_t x, uint32_t dx, uint32_t y) {
+    uint8_t Y = y >> 16;
+    int32_t fy = (y & 0xFFFF) >> 4;
+    int32_t v = fade(y);
+
+    // Per cell: x gradients, and the y terms, fixed along the row
+    int32_t gx00 = 0, gx10 = 0, gx01 = 0, gx11 = 0;
+    int32_t c00 = 0, c10 = 0, c01 = 0, c11 = 0;
+    int32_t cell = -1;
+    for (uint16_t i = 0; i < count; i++, x += dx) {
+        if ((int32_t)(x >> 16) != cell) {
+            cell = x >> 16;
+            uint8_t h00 = hash(cell, Y) & 7, h10 = hash(cell + 1, Y) & 7;
+            uint8_t h01 = hash(cell, Y + 1) & 7, h11 = hash(cell + 1, Y + 1) & 7;
+            gx00 = grad2x[h00]; c00 = grad2y[h00] * fy;
+            gx10 = grad2x[h10]; c10 = grad2y[h10] * fy;
+            gx01 = grad2x[h01]; c01 = grad2y[h01] * (fy - ONE);
+            gx11 = grad2x[h11]; c11 = grad2y[h11] * (fy - ONE);
+        }
+        int32_t f = (x & 0xFFFF) >> 4;
+        int32_t u = fade(x);
+        int32_t a = lerp(gx00 * f + c00, gx10 * (f - ONE) + c10, u);
+        int32_t b = lerp(gx01 * f + c01, gx11 * (f - ONE) + c11, u);
+        out[i] = clamp16((lerp(a, b, v) * SCALE2) >> 8);
+    }
+}
+
+void noiseRow3(int16_t* out, uint16_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z) {
+    uint8_t Y = y >> 16, Z = z >> 16;
+    int32_t fy = (y & 0xFFFF) >> 4, fz = (z & 0xFFFF) >> 4;
+    int32_t v = fade(y), w = fade(z);
+
+    // Corners in x, y, z bit order; their y and z terms are fixed along the row
+    int32_t gx[8] = { 0 }, c[8] = { 0 };
+    int32_t cell = -1;
+    for (uint16_t i = 0; i < count; i++, x += dx) {
+        if ((int32_t)(x >> 16) != cell) {
+            cell = x >> 16;
+            for (uint8_t k = 0; k < 8; k++) {
+                uint8_t h = hash(hash(cell + (k & 1), Y + ((k >> 1) & 1)), Z + (k >> 2)) & 15;
+                gx[k] = grad3x[h];
+                c[k] = grad3y[h] * ((k & 2) ? fy - ONE : fy) + grad3z[h] * ((k & 4) ? fz - ONE : fz);
+            }
+        }
+        int32_t f = (x & 0xFFFF) >> 4;
+        int32_t f1 = f - ONE;
+        int32_t u = fade(x);
+        int32_t a = lerp(lerp(gx[0] * f + c[0], gx[1] * f1 + c[1], u),
+                         lerp(gx[2] * f + c[2], gx[3] * f1 + c[3], u), v);
+        int32_t b = lerp(lerp(gx[4] * f + c[4], gx[5] * f1 + c[5], u),
+                         lerp(gx[6] * f + c[6], gx[7] * f1 + c[7], u), v);
+        out[i] = clamp16((lerp(a, b, w) * SCALE3) >> 8);
+    }
+}
+
+int16_t noise1(uint32_t x) {
+    int16_t n;
+    noiseRow1(&n, 1, x, 0);
+    return n;
+}
+
+int16_t noise2(uint32_t x, uint32_t y) {
+    int16_t n;
+    noiseRow2(&n, 1, x, 0, y);
+    return n;
+}
+
+int16_t noise3(uint32_t x, uint32_t y, uint32_t z) {
+    int16_t n;
+    noiseRow3(&n, 1, x, 0, y, z);
+    return n;
+}
@@ -0,0 +1,28 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stdint.h>
+
+// Gradient (Perlin) noise in fixed point, for smooth organic motion without
+// floats. Coordinates are 16.16: the top 16 bits pick the lattice cell, the
+// low 16 the place in it, and the pattern repeats every 256 cells. Results
+// are signed 16-bit, within -32640 to 32640, and vary smoothly with every
+// coordinate.
+//
+// The row functions fill count values for pixels along x, starting at x
+// and dx apart, with the other coordinates fixed. They keep the cell's
+// hashes and the per-row terms while x stays in a cell, so a row costs
+// little more than its interpolation.
+
+int16_t noise1(uint32_t x);
+int16_t noise2(uint32_t x, uint32_t y);
+int16_t noise3(uint32_t x, uint32_t y, uint32_t z);
+
+void noiseRow1(int16_t* out, uint16_t count, uint32_t x, uint32_t dx);
+void noiseRow2(int16_t* out, uint16_t count, uint32_t x, uint32_t dx, uint32_t y);
+void noiseRow3(int16_t* out, uint16_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z);
+
+// 0-255 from a noise value
+inline uint8_t noise8(int16_t n) { return (uint16_t)(n + 32768) >> 8; }
+
+#endif
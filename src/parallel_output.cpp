@@ -0,0 +1,94 @@
+#include "parallel_output.h"
+#include <soc/gpio_reg.h>
+
+// Same timing as espShow() in the NeoPixel library
+#define CYCLES_800_T0H  (F_CPU / 2500000) // 0.4us
+#define CYCLES_800_T1H  (F_CPU / 1250000) // 0.8us
+#define CYCLES_800      (F_CPU /  800000) // 1.25us per bit
+
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t getCycleCount(void) __attribute__((always_inline));
+static inline uint32_t getCycleCount(void) {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0,ccount":"=a" (ccount));
+    return ccount;
+}
+
+// Each slot byte holds one bit of every lane. All pins go high together,
+// lanes sending a 0 drop at T0H and the rest at T1H.
+static void IRAM_ATTR sendSlots(const uint8_t* slots, size_t count,
+                                const uint32_t* pinMasks, uint32_t allPins) {
+    uint32_t start = 0, c;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t zeros = pinMasks[(uint8_t)~slots[i]];
+        while (((c = getCycleCount()) - start) < CYCLES_800);   // Wait for bit start
+        REG_WRITE(GPIO_OUT_W1TS_REG, allPins);
+        start = c;
+        while ((getCycleCount() - start) < CYCLES_800_T0H);
+        REG_WRITE(GPIO_OUT_W1TC_REG, zeros);
+        while ((getCycleCount() - start) < CYCLES_800_T1H);
+        REG_WRITE(GPIO_OUT_W1TC_REG, allPins);
+    }
+    while ((getCycleCount() - start) < CYCLES_800);              // Wait for last bit
+}
+
+ParallelOutput::ParallelOutput() :
+    laneCount(0), maxBytes(0), allPins(0), stream(NULL), endTime(0) {
+}
+
+ParallelOutput::~ParallelOutput() {
+    free(stream);
+}
+
+bool ParallelOutput::addLane(uint8_t pin, uint16_t first, uint16_t count) {
+    if (laneCount >= PARALLEL_LANES || pin >= 32 || stream) return false;
+    lanes[laneCount++] = { pin, first, count };
+    maxBytes = max(maxBytes, (size_t)count * 3);
+    return true;
+}
+
+bool ParallelOutput::begin() {
+    allPins = 0;
+    for (uint8_t k = 0; k < laneCount; k++) {
+        pinMode(lanes[k].pin, OUTPUT);
+        digitalWrite(lanes[k].pin, LOW);
+        allPins |= 1UL << lanes[k].pin;
+    }
+    for (int bits = 0; bits < 256; bits++) {
+        uint32_t mask = 0;
+        for (uint8_t k = 0; k < laneCount; k++) {
+            if (bits & (1 << k)) mask |= 1UL << lanes[k].pin;
+        }
+        pinMasks[bits] = mask;
+    }
+    free(stream);
+    stream = (uint8_t*)malloc(maxBytes * 8);
+    return stream != NULL;
+}
+
+// Assumes a 3-byte (RGB-type) strip
+void ParallelOutput::show(Adafruit_NeoPixel& strip) {
+    show(strip.getPixels(), strip.numPixels() * 3);
+}
+
+void ParallelOutput::show(const uint8_t* pixels, size_t numBytes) {
+    if (!stream) return;
+
+    uint16_t numPixels = numBytes / 3;
+    const uint8_t* sources[PARALLEL_LANES] = { NULL };
+    size_t lengths[PARALLEL_LANES] = { 0 };
+    for (uint8_t k = 0; k < laneCount; k++) {
+        uint16_t count = min(lanes[k].count, (uint16_t)max(0, numPixels - lanes[k].first));
+        sources[k] = pixels + lanes[k].first * 3;
+        lengths[k] = count * 3;
+    }
+    transposeLanes(sources, lengths, maxBytes, stream);
+
+    // Latch: see Adafruit_NeoPixel::show()
+    while (!canShow());
+    portENTER_CRITICAL(&mux);
+    sendSlots(stream, maxBytes * 8, pinMasks, allPins);
+    portEXIT_CRITICAL(&mux);
+    endTime = micros();
+}
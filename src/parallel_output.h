@@ -0,0 +1,50 @@
+#ifndef PARALLEL_OUTPUT_H
+#define PARALLEL_OUTPUT_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "transpose.h"
+
+// One strip driven by a parallel lane: a run of the strip's pixels on its own pin
+typedef struct Lane {
+    uint8_t  pin;       // GPIO 0-31
+    uint16_t first;     // First pixel of the run
+    uint16_t count;     // Pixels in the run
+} Lane;
+
+// Drives up to 8 strips in a single bit-banged pass. The lanes' bytes are
+// bit-plane transposed into one stream, and every bit slot is a single write
+// to the GPIO set/clear registers for all pins at once, so a frame takes as
+// long as the longest strip rather than the sum of all of them.
+// Like espShow(), interrupts are off on this core while the frame goes out.
+class ParallelOutput {
+public:
+    ParallelOutput();
+    ~ParallelOutput();
+
+    // Add lanes before begin(); false if full or the pin can't be used
+    bool addLane(uint8_t pin, uint16_t first, uint16_t count);
+
+    bool begin();
+
+    // Lanes take their pixels from a frame of numBytes RGB-type pixels
+    void show(const uint8_t* pixels, size_t numBytes);
+    void show(Adafruit_NeoPixel& strip);
+
+    // The CPU clocks every bit itself, so nothing can overlap: same as show()
+    bool showAsync(const uint8_t* pixels, size_t numBytes) { show(pixels, numBytes); return true; }
+    bool showAsync(Adafruit_NeoPixel& strip) { show(strip); return true; }
+
+    bool canShow() const { return micros() - endTime >= 300L; }
+
+private:
+    Lane      lanes[PARALLEL_LANES];
+    uint8_t   laneCount;
+    size_t    maxBytes;                 // Longest lane, in bytes
+    uint32_t  allPins;                  // GPIO mask of every lane
+    uint32_t  pinMasks[256];            // Lane bits -> GPIO mask
+    uint8_t*  stream;                   // maxBytes * 8 transposed bit slots
+    uint32_t  endTime;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "pattern.h"
+#include <string.h>
+#include <Adafruit_NeoPixel.h>
+
+#define HEADER_SIZE 6
+
+// Stack effect and operand size of each op
+typedef struct OpInfo {
+    uint8_t pops;
+    uint8_t pushes;
+    uint8_t operand;
+} OpInfo;
+
+static const OpInfo ops[PATTERN_OPS] = {
+    { 0, 0, 0 },    // 0 is not an op
+    { 0, 1, 1 },    // PUSH8
+    { 0, 1, 2 },    // PUSH16
+    { 0, 1, 3 },    // PUSH24
+    { 0, 1, 0 },    // TIME
+    { 0, 1, 0 },    // INDEX
+    { 0, 1, 0 },    // COUNT
+    { 0, 1, 1 },    // LOAD
+    { 1, 0, 1 },    // STORE
+    { 1, 2, 0 },    // DUP
+    { 1, 0, 0 },    // DROP
+    { 2, 2, 0 },    // SWAP
+    { 2, 1, 0 },    // ADD
+    { 2, 1, 0 },    // SUB
+    { 2, 1, 0 },    // MUL
+    { 2, 1, 0 },    // DIV
+    { 2, 1, 0 },    // MOD
+    { 2, 1, 0 },    // AND
+    { 2, 1, 0 },    // OR
+    { 2, 1, 0 },    // XOR
+    { 2, 1, 0 },    // SHL
+    { 2, 1, 0 },    // SHR
+    { 2, 1, 0 },    // MIN
+    { 2, 1, 0 },    // MAX
+    { 2, 1, 0 },    // LT
+    { 3, 1, 0 },    // SELECT
+    { 1, 1, 0 },    // SIN8
+    { 3, 1, 0 },    // HSV
+    { 3, 1, 0 },    // RGB
+    { 1, 1, 0 },    // PALETTE
+    { 3, 1, 0 },    // BLEND
+};
+
+const char* patternErrorName(PatternError error) {
+    switch (error) {
+        case PATTERN_OK:            return "ok";
+        case PATTERN_BAD_HEADER:    return "bad header";
+        case PATTERN_BAD_OPCODE:    return "bad opcode";
+        case PATTERN_TRUNCATED:     return "truncated operand";
+        case PATTERN_BAD_REGISTER:  return "bad register";
+        case PATTERN_UNDERFLOW:     return "stack underflow";
+        case PATTERN_OVERFLOW:      return "stack overflow";
+        case PATTERN_BAD_RESULT:    return "wrong number of results";
+    }
+    return "unknown";
+}
+
+Pattern::Pattern() :
+    frameCode(NULL), pixelCode(NULL), frameLength(0), pixelLength(0),
+    colorCount(0), usesTime(false), period(0), failedAt(0), loads(0) {
+    memset(&own, 0, sizeof(own));
+}
+
+PatternError Pattern::verify(const uint8_t* code, uint8_t length, uint8_t result, size_t base) {
+    uint8_t depth = 0;
+    for (uint8_t pc = 0; pc < length; ) {
+        failedAt = base + pc;
+        uint8_t op = code[pc];
+        if (op == 0 || op >= PATTERN_OPS) return PATTERN_BAD_OPCODE;
+        const OpInfo& info = ops[op];
+        if (pc + 1 + info.operand > length) return PATTERN_TRUNCATED;
+        if ((op == PATTERN_LOAD || op == PATTERN_STORE) && code[pc + 1] >= PATTERN_REGISTERS) {
+            return PATTERN_BAD_REGISTER;
+        }
+        if (depth < info.pops) return PATTERN_UNDERFLOW;
+        depth = depth - info.pops + info.pushes;
+        if (depth > PATTERN_STACK) return PATTERN_OVERFLOW;
+        pc += 1 + info.operand;
+    }
+    failedAt = base + length;
+    return depth == result ? PATTERN_OK : PATTERN_BAD_RESULT;
+}
+
+PatternError Pattern::load(const uint8_t* data, size_t length) {
+    failedAt = 0;
+    if (length < HEADER_SIZE || length > PATTERN_MAX_SIZE
+        || data[0] != 'P' || data[1] != 'V' || data[2] != 1 || data[3] > PATTERN_COLORS
+        || length != HEADER_SIZE + data[3] * 3u + data[4] + data[5]) {
+        return PATTERN_BAD_HEADER;
+    }
+    size_t frameStart = HEADER_SIZE + data[3] * 3;
+    size_t pixelStart = frameStart + data[4];
+    PatternError error = verify(data + frameStart, data[4], 0, frameStart);
+    if (error == PATTERN_OK) error = verify(data + pixelStart, data[5], 1, pixelStart);
+    if (error != PATTERN_OK) return error;
+
+    memcpy(program, data, length);
+    colorCount = data[3];
+    for (uint8_t i = 0; i < colorCount; i++) {
+        const uint8_t* c = data + HEADER_SIZE + i * 3;
+        colors[i] = ((uint32_t)c[0] << 16) | ((uint32_t)c[1] << 8) | c[2];
+    }
+    frameCode = program + frameStart;
+    frameLength = data[4];
+    pixelCode = program + pixelStart;
+    pixelLength = data[5];
+    loads++;
+    period = 0;
+
+    // Operands are skipped, so a TIME byte inside one doesn't count
+    usesTime = false;
+    for (size_t pc = frameStart; pc < length; pc += 1 + ops[program[pc]].operand) {
+        if (program[pc] == PATTERN_TIME) usesTime = true;
+    }
+    return PATTERN_OK;
+}
+
+void Pattern::beginFrame(PatternState& state, uint32_t now, uint16_t numPixels) {
+    if (state.program != loads) {
+        memset(state.registers, 0, sizeof(state.registers));
+        state.program = loads;
+    }
+    state.time = (int32_t)now;
+    state.count = numPixels;
+    run(state, frameCode, frameLength, 0);
+}
+
+uint32_t Pattern::pixel(PatternState& state, uint16_t index) {
+    return (uint32_t)run(state, pixelCode, pixelLength, index) & 0xFFFFFF;
+}
+
+// Straight through the code; load() has ruled out anything that could go
+// wrong, so nothing is checked here
+int32_t Pattern::run(PatternState& state, const uint8_t* code, uint8_t length, int32_t index) {
+    int32_t stack[PATTERN_STACK + 1];
+    int32_t* sp = stack;    // Points at the top value; stack[0] is never used
+    const uint8_t* end = code + length;
+    int32_t a, b;
+
+    while (code < end) {
+        switch (*code++) {
+        case PATTERN_PUSH8:   *++sp = code[0]; code += 1; break;
+        case PATTERN_PUSH16:  *++sp = code[0] | (code[1] << 8); code += 2; break;
+        case PATTERN_PUSH24:  *++sp = (code[0] << 16) | (code[1] << 8) | code[2]; code += 3; break;
+        case PATTERN_TIME:    *++sp = state.time; break;
+        case PATTERN_INDEX:   *++sp = index; break;
+        case PATTERN_COUNT:   *++sp = state.count; break;
+        case PATTERN_LOAD:    *++sp = state.registers[*code++]; break;
+        case PATTERN_STORE:   state.registers[*code++] = *sp--; break;
+        case PATTERN_DUP:     sp[1] = sp[0]; sp++; break;
+        case PATTERN_DROP:    sp--; break;
+        case PATTERN_SWAP:    a = sp[0]; sp[0] = sp[-1]; sp[-1] = a; break;
+        case PATTERN_ADD:     b = *sp--; *sp = (int32_t)((uint32_t)*sp + (uint32_t)b); break;
+        case PATTERN_SUB:     b = *sp--; *sp = (int32_t)((uint32_t)*sp - (uint32_t)b); break;
+        case PATTERN_MUL:     b = *sp--; *sp = (int32_t)((uint32_t)*sp * (uint32_t)b); break;
+        case PATTERN_DIV:
+            // INT32_MIN / -1 overflows; negate through uint32_t instead
+            b = *sp--;
+            *sp = b == -1 ? (int32_t)(0 - (uint32_t)*sp) : b ? *sp / b : 0;
+            break;
+        case PATTERN_MOD:
+            b = *sp--;
+            if (b == -1) {
+                *sp = 0;
+            }
+            else if (b) {
+                a = *sp % b;
+                *sp = (a != 0 && (a < 0) != (b < 0)) ? a + b : a;
+            }
+            else {
+                *sp = 0;
+            }
+            break;
+        case PATTERN_AND:     b = *sp--; *sp &= b; break;
+        case PATTERN_OR:      b = *sp--; *sp |= b; break;
+        case PATTERN_XOR:     b = *sp--; *sp ^= b; break;
+        case PATTERN_SHL:     b = *sp--; *sp = (int32_t)((uint32_t)*sp << (b & 31)); break;
+        case PATTERN_SHR:     b = *sp--; *sp >>= (b & 31); break;
+        case PATTERN_MIN:     b = *sp--; if (b < *sp) *sp = b; break;
+        case PATTERN_MAX:     b = *sp--; if (b > *sp) *sp = b; break;
+        case PATTERN_LT:      b = *sp--; *sp = *sp < b; break;
+        case PATTERN_SELECT:  b = *sp--; a = *sp--; *sp = *sp ? a : b; break;
+        case PATTERN_SIN8:    *sp = Adafruit_NeoPixel::sine8(*sp); break;
+        case PATTERN_HSV:
+            b = *sp--; a = *sp--;
+            *sp = Adafruit_NeoPixel::ColorHSV(*sp, a, b);
+            break;
+        case PATTERN_RGB:
+            b = *sp--; a = *sp--;
+            *sp = ((*sp & 0xFF) << 16) | ((a & 0xFF) << 8) | (b & 0xFF);
+            break;
+        case PATTERN_PALETTE:
+            if (colorCount) {
+                a = *sp % colorCount;
+                *sp = colors[a < 0 ? a + colorCount : a];
+            }
+            else {
+                *sp = 0;
+            }
+            break;
+        case PATTERN_BLEND: {
+            // Two channels per multiply, as in the layer kernels
+            uint32_t w = *sp-- & 0xFF;
+            w += w >> 7;
+            uint32_t to = *sp--;
+            uint32_t from = *sp;
+            uint32_t rb = ((to & 0xFF00FF) * w + (from & 0xFF00FF) * (256 - w)) >> 8;
+            uint32_t g  = ((to & 0x00FF00) * w + (from & 0x00FF00) * (256 - w)) >> 8;
+            *sp = (rb & 0xFF00FF) | (g & 0x00FF00);
+            break;
+        }
+        }
+    }
+    return sp > stack ? *sp : 0;
+}
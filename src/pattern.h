@@ -0,0 +1,140 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PATTERN_MAX_SIZE    512     // Bytes of an uploaded pattern, header included
+#define PATTERN_STACK       16      // Deepest stack a pattern may use
+#define PATTERN_REGISTERS   8       // Values kept between pixels and frames
+#define PATTERN_COLORS      16      // Palette entries
+
+// Effects as small stack-machine programs, uploaded instead of flashed.
+//
+// Binary format:
+//   'P' 'V' version(1) colors frameLength pixelLength
+//   colors * R,G,B
+//   frame code: run once per frame, leaves nothing on the stack
+//   pixel code: run for every pixel, leaves its color (0xRRGGBB)
+//
+// Values are 32-bit signed integers that wrap on overflow, and x / 0 is 0.
+// Code is straight-line, so load() checks every instruction, operand and
+// stack depth up front and run time needs no checks at all. Registers start
+// at 0 and keep their values from frame to frame; the frame code typically
+// works out a phase from the time and stores it for the pixel code.
+enum PatternOp {
+    PATTERN_PUSH8 = 1,  // operand: 1 byte, unsigned
+    PATTERN_PUSH16,     // operand: 2 bytes, little-endian, unsigned
+    PATTERN_PUSH24,     // operand: 3 bytes R,G,B, pushes 0xRRGGBB
+    PATTERN_TIME,       // -> ms clock
+    PATTERN_INDEX,      // -> pixel index (0 in the frame code)
+    PATTERN_COUNT,      // -> number of pixels
+    PATTERN_LOAD,       // operand: register; -> value
+    PATTERN_STORE,      // operand: register; value ->
+    PATTERN_DUP,        // a -> a a
+    PATTERN_DROP,       // a ->
+    PATTERN_SWAP,       // a b -> b a
+    PATTERN_ADD,        // a b -> a + b, and so on
+    PATTERN_SUB,
+    PATTERN_MUL,
+    PATTERN_DIV,        // Division by 0 gives 0
+    PATTERN_MOD,        // Same, result has the sign of b (always >= 0 for b > 0)
+    PATTERN_AND,
+    PATTERN_OR,
+    PATTERN_XOR,
+    PATTERN_SHL,        // Shift counts are taken mod 32
+    PATTERN_SHR,        // Arithmetic
+    PATTERN_MIN,
+    PATTERN_MAX,
+    PATTERN_LT,         // a b -> 1 if a < b, else 0
+    PATTERN_SELECT,     // c a b -> c ? a : b
+    PATTERN_SIN8,       // x -> sine of x (0-255 is one turn), 0-255
+    PATTERN_HSV,        // hue(16 bits) sat val -> color
+    PATTERN_RGB,        // r g b -> color
+    PATTERN_PALETTE,    // index -> palette color, index taken mod the palette size
+    PATTERN_BLEND,      // a b weight(0-255) -> color from a towards b
+    PATTERN_OPS
+};
+
+enum PatternError {
+    PATTERN_OK,
+    PATTERN_BAD_HEADER,     // Magic, version or lengths don't add up
+    PATTERN_BAD_OPCODE,
+    PATTERN_TRUNCATED,      // Operand runs past the end of its code
+    PATTERN_BAD_REGISTER,
+    PATTERN_UNDERFLOW,      // Pops more than was pushed
+    PATTERN_OVERFLOW,       // Deeper than PATTERN_STACK
+    PATTERN_BAD_RESULT,     // Frame code must leave 0 values, pixel code 1
+};
+
+// Short description of an error, for API answers
+const char* patternErrorName(PatternError error);
+
+// Registers and frame values of one place drawing a program: the main theme
+// and every segment showing the pattern keep their own, so one's registers
+// never leak into another's. They start over when a new program is loaded.
+typedef struct PatternState {
+    int32_t  registers[PATTERN_REGISTERS];
+    int32_t  time;
+    int32_t  count;
+    uint32_t program;       // Load the registers belong to
+} PatternState;
+
+class Pattern {
+public:
+    Pattern();
+
+    // Check and take a program; on error the current one is kept, and
+    // errorOffset() tells the byte at fault
+    PatternError load(const uint8_t* data, size_t length);
+    size_t errorOffset() const { return failedAt; }
+
+    bool valid() const { return pixelCode != NULL; }
+
+    // True if the program reads the clock, i.e. needs redrawing every frame
+    bool animated() const { return usesTime; }
+
+    // Frames after which an animated program repeats, as declared by whoever
+    // uploaded it (0 if unknown); lets its cycle be cached
+    void setPeriod(uint16_t frames) { period = frames; }
+    uint16_t getPeriod() const { return period; }
+
+    // Run the frame code for time now, then pixel(i) gives each pixel.
+    // Without a state, the pattern's own is used.
+    void beginFrame(PatternState& state, uint32_t now, uint16_t numPixels);
+    uint32_t pixel(PatternState& state, uint16_t index);
+    void beginFrame(uint32_t now, uint16_t numPixels) { beginFrame(own, now, numPixels); }
+    uint32_t pixel(uint16_t index) { return pixel(own, index); }
+
+    // Whole frame onto a Layer, IndexedFrame or strip
+    template <class Canvas>
+    void render(Canvas& canvas, uint32_t now, PatternState& state) {
+        if (!valid()) return;
+        beginFrame(state, now, canvas.numPixels());
+        for (uint16_t i = 0; i < canvas.numPixels(); i++) {
+            canvas.setPixelColor(i, pixel(state, i));
+        }
+    }
+    template <class Canvas>
+    void render(Canvas& canvas, uint32_t now) { render(canvas, now, own); }
+
+private:
+    PatternError verify(const uint8_t* code, uint8_t length, uint8_t result, size_t base);
+    int32_t run(PatternState& state, const uint8_t* code, uint8_t length, int32_t index);
+
+    uint8_t        program[PATTERN_MAX_SIZE];
+    const uint8_t* frameCode;
+    const uint8_t* pixelCode;
+    uint8_t        frameLength;
+    uint8_t        pixelLength;
+    uint8_t        colorCount;
+    uint32_t       colors[PATTERN_COLORS];
+    bool           usesTime;
+    uint16_t       period;
+    size_t         failedAt;
+
+    uint32_t       loads;           // Programs loaded so far
+    PatternState   own;
+};
+
+#endif
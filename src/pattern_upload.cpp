@@ -0,0 +1,74 @@
+#include "pattern_upload.h"
+#include "http_request.h"
+
+PatternUpload::PatternUpload(Pattern& pattern, SemaphoreHandle_t lock, void (*onUpload)()) :
+    pattern(pattern), lock(lock), onUpload(onUpload) {
+}
+
+bool PatternUpload::matches(const char* requestLine, size_t length) {
+    return requestIs(requestLine, length, PATTERN_PATH);
+}
+
+void PatternUpload::handle(WiFiClient& client, const char* requestLine) {
+    char header[128];
+    long bodyLength = -1;
+    int length;
+    while ((length = readHeaderLine(client, header, sizeof(header))) > 0) {
+        if (strncasecmp(header, "Content-Length:", 15) == 0) {
+            bodyLength = atol(header + 15);
+        }
+    }
+    if (length < 0) {
+        client.stop();
+        return;
+    }
+    if (bodyLength < 0) {
+        respondJson(client, 411, "{\"error\": \"Content-Length required\"}");
+        return;
+    }
+    if (bodyLength > PATTERN_MAX_SIZE) {
+        respondJson(client, 413, "{\"error\": \"pattern too large\"}");
+        return;
+    }
+
+    // Small enough to take whole before checking it
+    uint8_t data[PATTERN_MAX_SIZE];
+    long received = 0;
+    unsigned long lastData = millis();
+    while (received < bodyLength && millis() - lastData < HTTP_TIMEOUT_MS) {
+        int n = client.read(data + received, bodyLength - received);
+        if (n > 0) {
+            received += n;
+            lastData = millis();
+        }
+        else if (!client.connected()) {
+            break;
+        }
+        else {
+            delay(1);
+        }
+    }
+
+    if (xSemaphoreTake(lock, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) {
+        respondJson(client, 503, "{\"error\": \"strip busy\"}");
+        return;
+    }
+    PatternError error = pattern.load(data, received);
+    if (error == PATTERN_OK) {
+        long period = queryInt(requestLine, "period", 0);
+        pattern.setPeriod(period > 0 && period <= 0xFFFF ? period : 0);
+        onUpload();
+    }
+    xSemaphoreGive(lock);
+
+    char body[64];
+    if (error == PATTERN_OK) {
+        snprintf(body, sizeof(body), "{\"bytes\": %ld}", received);
+        respondJson(client, 200, body);
+    }
+    else {
+        snprintf(body, sizeof(body), "{\"error\": \"%s\", \"offset\": %u}",
+                 patternErrorName(error), (unsigned)pattern.errorOffset());
+        respondJson(client, 400, body);
+    }
+}
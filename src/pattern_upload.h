@@ -0,0 +1,32 @@
+#ifndef PATTERN_UPLOAD_H
+#define PATTERN_UPLOAD_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/semphr.h>
+#include "pattern.h"
+
+#define PATTERN_PATH    "POST /pattern"
+
+// POST /pattern
+//
+// The body is a compiled pattern (see pattern.h), raw bytes. It is checked
+// in full before it replaces the running one; a rejected pattern is
+// answered with the error and the offset of the byte at fault.
+class PatternUpload {
+public:
+    // lock guards the pattern; onUpload is called with it held once loaded
+    PatternUpload(Pattern& pattern, SemaphoreHandle_t lock, void (*onUpload)());
+
+    static bool matches(const char* requestLine, size_t length);
+
+    // Handle the rest of the request after its request line, and answer it
+    void handle(WiFiClient& client, const char* requestLine);
+
+private:
+    Pattern&          pattern;
+    SemaphoreHandle_t lock;
+    void            (*onUpload)();
+};
+
+#endif
@@ -0,0 +1,10 @@
+#include "pixel_copy.h"
+
+void rgbToStrip(Adafruit_NeoPixel& strip, uint16_t first, uint16_t count) {
+    uint8_t* p = strip.getPixels() + first * 3;
+    for (uint16_t i = first; i < first + count; i++) {
+        uint8_t r = p[0], g = p[1], b = p[2];
+        strip.setPixelColor(i, r, g, b);
+        p += 3;
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef PIXEL_COPY_H
+#define PIXEL_COPY_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+
+// Convert count R,G,B triplets, already written raw into the strip buffer at
+// pixel first, to the strip's own color order and brightness, in place.
+// Only valid for 3-byte (RGB-type) strips.
+void rgbToStrip(Adafruit_NeoPixel& strip, uint16_t first, uint16_t count);
+
+#endif
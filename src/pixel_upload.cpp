@@ -0,0 +1,160 @@
+#include "pixel_upload.h"
+#include "http_request.h"
+
+PixelUpload::PixelUpload(Layer& layer, SemaphoreHandle_t lock, void (*onBegin)(), void (*onUpload)()) :
+    layer(layer), lock(lock), onBegin(onBegin), onUpload(onUpload),
+    next(0), end(0), bytesPerPixel(3), partialBytes(0), started(false) {
+}
+
+bool PixelUpload::matches(const char* requestLine, size_t length) {
+    return requestIs(requestLine, length, UPLOAD_PATH);
+}
+
+void PixelUpload::handle(WiFiClient& client, const char* requestLine) {
+    // Headers: only the body length and type matter
+    char header[128];
+    long bodyLength = -1;
+    bool base64 = queryIs(requestLine, "encoding", "base64");
+    int length;
+    while ((length = readHeaderLine(client, header, sizeof(header))) > 0) {
+        if (strncasecmp(header, "Content-Length:", 15) == 0) {
+            bodyLength = atol(header + 15);
+        }
+        else if (strncasecmp(header, "Content-Type:", 13) == 0) {
+            if (strstr(header, "base64") || strstr(header, "text/plain")) base64 = true;
+        }
+    }
+    if (length < 0) {
+        client.stop();
+        return;
+    }
+    if (bodyLength < 0) {
+        respondJson(client, 411, "{\"error\": \"Content-Length required\"}");
+        return;
+    }
+
+    bytesPerPixel = queryIs(requestLine, "format", "rgbw") ? 4 : 3;
+    uint32_t dataLength = base64 ? bodyLength / 4 * 3 : bodyLength;
+    long first = queryInt(requestLine, "offset", 0);
+    long count = queryInt(requestLine, "length", dataLength / bytesPerPixel);
+    if (first >= layer.numPixels()) {
+        respondJson(client, 400, "{\"error\": \"offset out of range\"}");
+        return;
+    }
+    count = min(count, (long)(layer.numPixels() - first));
+
+    // Pixels go in a chunk at a time as the body arrives
+    next = first;
+    end = first + max(count, 0L);
+    partialBytes = 0;
+    started = false;
+    bool stored = base64 ? readBase64(client, bodyLength) : readRaw(client, bodyLength);
+    uint16_t written = next - first;
+
+    if (started) {
+        if (xSemaphoreTake(lock, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) {
+            stored = false;
+        }
+        else {
+            onUpload();
+            xSemaphoreGive(lock);
+        }
+    }
+    if (!stored) {
+        respondJson(client, 503, "{\"error\": \"strip busy\"}");
+        return;
+    }
+
+    char body[48];
+    snprintf(body, sizeof(body), "{\"offset\": %ld, \"pixels\": %u}", first, written);
+    respondJson(client, 200, body);
+}
+
+// Bytes into pixels from next on, under the lock; false if it couldn't be had
+bool PixelUpload::store(const uint8_t* data, uint32_t n) {
+    if (n == 0 || next >= end) return true;
+    if (xSemaphoreTake(lock, (TickType_t)HTTP_TIMEOUT_MS) != pdTRUE) return false;
+    if (!started) {
+        onBegin();
+        started = true;
+    }
+    for (uint32_t i = 0; i < n && next < end; i++) {
+        partial[partialBytes++] = data[i];
+        if (partialBytes < bytesPerPixel) continue;
+        layer.setPixelColor(next++, partial[0], partial[1], partial[2]);
+        partialBytes = 0;
+    }
+    xSemaphoreGive(lock);
+    return true;
+}
+
+// Raw bytes: read a chunk at a time and stored as they come, anything past
+// the last pixel discarded
+bool PixelUpload::readRaw(WiFiClient& client, uint32_t bodyLength) {
+    uint8_t chunk[UPLOAD_CHUNK];
+    uint32_t received = 0;
+    unsigned long lastData = millis();
+
+    while (received < bodyLength && millis() - lastData < HTTP_TIMEOUT_MS) {
+        int available = client.available();
+        if (available <= 0) {
+            if (!client.connected()) break;
+            delay(1);
+            continue;
+        }
+        int n = client.read(chunk, min((uint32_t)available,
+                                       min(bodyLength - received, (uint32_t)sizeof(chunk))));
+        if (n <= 0) continue;
+        received += n;
+        lastData = millis();
+        if (!store(chunk, n)) return false;
+    }
+    return true;
+}
+
+static int8_t base64Value(uint8_t c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1; // Padding, whitespace and anything else is skipped
+}
+
+// Base64: decoded a chunk at a time through the stack and stored
+bool PixelUpload::readBase64(WiFiClient& client, uint32_t bodyLength) {
+    uint8_t chunk[UPLOAD_CHUNK];
+    uint8_t bytes[UPLOAD_CHUNK];
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    uint32_t received = 0;
+    unsigned long lastData = millis();
+
+    while (received < bodyLength && millis() - lastData < HTTP_TIMEOUT_MS) {
+        int available = client.available();
+        if (available <= 0) {
+            if (!client.connected()) break;
+            delay(1);
+            continue;
+        }
+        int n = client.read(chunk, min((uint32_t)available,
+                                       min(bodyLength - received, (uint32_t)sizeof(chunk))));
+        if (n <= 0) continue;
+        received += n;
+        lastData = millis();
+
+        // Four characters make three bytes, so a chunk's bytes always fit
+        uint32_t decoded = 0;
+        for (int i = 0; i < n; i++) {
+            int8_t value = base64Value(chunk[i]);
+            if (value < 0) continue;
+            bits = (bits << 6) | value;
+            bitCount += 6;
+            if (bitCount < 8) continue;
+            bitCount -= 8;
+            bytes[decoded++] = bits >> bitCount;
+        }
+        if (!store(bytes, decoded)) return false;
+    }
+    return true;
+}
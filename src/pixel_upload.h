@@ -0,0 +1,52 @@
+#ifndef PIXEL_UPLOAD_H
+#define PIXEL_UPLOAD_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/semphr.h>
+#include "layers.h"
+
+#define UPLOAD_PATH     "POST /pixels"
+#define UPLOAD_CHUNK    192     // Bytes read from the socket at a time
+
+// POST /pixels?offset=<first pixel>&length=<pixels>[&format=rgbw][&encoding=base64]
+//
+// The body is raw R,G,B(,W) bytes, or their base64 encoding (also chosen by a
+// text/plain or */base64 Content-Type). It is read from the socket without
+// going through aREST, so a frame of any length is uploaded in one request,
+// and streamed into the layer UPLOAD_CHUNK bytes at a time, each chunk under
+// the strip lock for just as long as it takes to write. Nothing is
+// allocated, and a slow client doesn't stall lighting. W is dropped, layers
+// being RGB.
+class PixelUpload {
+public:
+    // lock guards the layer. onBegin is called with it held before the first
+    // pixels are written (to keep the layer from being redrawn under them),
+    // onUpload once they all are.
+    PixelUpload(Layer& layer, SemaphoreHandle_t lock, void (*onBegin)(), void (*onUpload)());
+
+    static bool matches(const char* requestLine, size_t length);
+
+    // Handle the rest of the request after its request line, and answer it
+    void handle(WiFiClient& client, const char* requestLine);
+
+private:
+    bool readRaw(WiFiClient& client, uint32_t bodyLength);
+    bool readBase64(WiFiClient& client, uint32_t bodyLength);
+    bool store(const uint8_t* data, uint32_t n);
+
+    Layer&             layer;
+    SemaphoreHandle_t  lock;
+    void             (*onBegin)();
+    void             (*onUpload)();
+
+    // The upload in progress
+    uint16_t           next;            // Pixel the next bytes go to
+    uint16_t           end;
+    uint8_t            bytesPerPixel;
+    uint8_t            partial[4];      // A pixel split between chunks
+    uint8_t            partialBytes;
+    bool               started;
+};
+
+#endif
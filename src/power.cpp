@@ -0,0 +1,28 @@
+#include "power.h"
+
+PowerBudget::PowerBudget(uint32_t numPixels, uint32_t budgetMa) :
+    lastMa(0), limitedFrames(0), numPixels(numPixels), budget(budgetMa) {
+}
+
+uint32_t PowerBudget::estimate(uint32_t level, uint16_t scale) const {
+    // 64 bits: level * scale * mA overflows at a few thousand white pixels
+    uint64_t channels = (uint64_t)level * scale * LED_CHANNEL_MA;
+    return (uint32_t)(channels / (255 * 256)) + numPixels * LED_IDLE_MA;
+}
+
+uint16_t PowerBudget::limit(uint32_t level, uint16_t scale) {
+    uint32_t ma = estimate(level, scale);
+    uint32_t idle = numPixels * LED_IDLE_MA;
+    if (ma <= budget || ma <= idle) {
+        lastMa = ma;
+        return scale;
+    }
+
+    // Only the lit part scales; the idle draw is there regardless
+    uint32_t available = budget > idle ? budget - idle : 0;
+    uint16_t limited = (uint64_t)scale * available / (ma - idle);
+    if (limited < 1) limited = 1;
+    lastMa = estimate(level, limited);
+    limitedFrames++;
+    return limited;
+}
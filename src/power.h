@@ -0,0 +1,37 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+// WS2812B draw: about 20 mA per channel at full level, 1 mA per pixel idle
+#define LED_CHANNEL_MA  20
+#define LED_IDLE_MA     1
+
+// Current estimate and limit for one supply. A frame is described by its
+// level, the sum of all its channel values (see FastStrip::level()), and the
+// scale it is sent at (1-256, 256 = as is).
+class PowerBudget {
+public:
+    PowerBudget(uint32_t numPixels, uint32_t budgetMa);
+
+    void setBudget(uint32_t ma) { budget = ma; }
+    void setNumPixels(uint32_t n) { numPixels = n; }
+    uint32_t getBudget() const { return budget; }
+
+    // Estimated draw in mA
+    uint32_t estimate(uint32_t level, uint16_t scale) const;
+
+    // Scale to send the frame at so it stays within budget: scale itself if
+    // it already fits, less otherwise
+    uint16_t limit(uint32_t level, uint16_t scale);
+
+    // Exported over REST
+    uint32_t lastMa;            // Estimate for the last frame, after limiting
+    uint32_t limitedFrames;     // Frames that had to be scaled down
+
+private:
+    uint32_t numPixels;
+    uint32_t budget;
+};
+
+#endif
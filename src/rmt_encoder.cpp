@@ -0,0 +1,24 @@
+#include "rmt_encoder.h"
+#include <string.h>
+
+RmtEncoder::RmtEncoder(const RmtTiming& timing) {
+    setTiming(timing);
+}
+
+void RmtEncoder::setTiming(const RmtTiming& t) {
+    timing = t;
+    uint32_t zero = rmtSymbol(t.t0h, t.t0l);
+    uint32_t one  = rmtSymbol(t.t1h, t.t1l);
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            table[value][bit] = (value & (0x80 >> bit)) ? one : zero;
+        }
+    }
+}
+
+void RmtEncoder::encode(const uint8_t* src, size_t count, uint32_t* dst) const {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dst, table[src[i]], sizeof(table[0]));
+        dst += 8;
+    }
+}
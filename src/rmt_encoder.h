@@ -0,0 +1,47 @@
+#ifndef RMT_ENCODER_H
+#define RMT_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// RMT clock: 80 MHz APB divided by 2, one tick = 25 ns
+#define RMT_CLOCK_DIV   2
+#define RMT_TICK_NS     25
+#define RMT_NS(ns)      (((ns) + RMT_TICK_NS / 2) / RMT_TICK_NS)
+
+// High and low time of each bit, in RMT ticks
+typedef struct RmtTiming {
+    uint16_t t0h, t0l;  // "0" bit
+    uint16_t t1h, t1l;  // "1" bit
+} RmtTiming;
+
+// WS2812B datasheet values
+static const RmtTiming timing800KHz = { RMT_NS(400), RMT_NS(850), RMT_NS(800), RMT_NS(450) };
+static const RmtTiming timing400KHz = { RMT_NS(500), RMT_NS(2000), RMT_NS(1200), RMT_NS(1300) };
+
+// Pack one high-then-low pulse the way rmt_item32_t lays it out:
+// duration0:15, level0:1, duration1:15, level1:1
+static inline uint32_t rmtSymbol(uint16_t high, uint16_t low) {
+    return (uint32_t)high | (1UL << 15) | ((uint32_t)low << 16);
+}
+
+// Converts pixel bytes to RMT symbols, MSB first, through a byte -> 8 symbol
+// lookup table. Pure code, no ESP-IDF dependency.
+class RmtEncoder {
+public:
+    RmtEncoder(const RmtTiming& timing = timing800KHz);
+
+    // Rebuild the table for a different bit timing
+    void setTiming(const RmtTiming& timing);
+
+    // Write 8 symbols for each of the count bytes in src to dst
+    void encode(const uint8_t* src, size_t count, uint32_t* dst) const;
+
+    const RmtTiming& getTiming() const { return timing; }
+
+private:
+    RmtTiming timing;
+    uint32_t  table[256][8];
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "rmt_output.h"
+
+// The translator callback takes no context, so all channels share one
+// encoder; every strip on the cabinet runs at 800 KHz
+static RmtEncoder encoder(timing800KHz);
+
+// The transmit-end callback is shared by all channels as well
+static RmtOutput* outputs[RMT_CHANNEL_MAX];
+
+// Called by the RMT driver whenever transmit memory needs refilling
+static void translate(const void* src, rmt_item32_t* dest, size_t srcSize,
+                      size_t wantedNum, size_t* translatedSize, size_t* itemNum) {
+    if (src == NULL || dest == NULL) {
+        *translatedSize = 0;
+        *itemNum = 0;
+        return;
+    }
+    size_t count = min(srcSize, wantedNum / 8);
+    encoder.encode((const uint8_t*)src, count, (uint32_t*)dest);
+
+    // srcSize is what is left of the frame: stretch the low half of the
+    // last bit into the latch, so the end of transmission is a latched frame
+    if (count == srcSize && count > 0) {
+        dest[count * 8 - 1].duration1 = RMT_NS(LATCH_US * 1000UL);
+    }
+    *translatedSize = count;
+    *itemNum = count * 8;
+}
+
+RmtOutput::RmtOutput(uint8_t pin, rmt_channel_t channel) :
+    pin(pin), channel(channel), serviceTask(NULL), notifyTask(NULL),
+    capacity(0), external(false), sending(0), queuedBytes(0), busy(false), queued(false),
+    filling(false), frames(0), dropped(0) {
+    buffers[0] = buffers[1] = NULL;
+    vPortCPUInitializeMutex(&mux);
+}
+
+bool RmtOutput::begin() {
+    rmt_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.rmt_mode = RMT_MODE_TX;
+    config.channel = channel;
+    config.gpio_num = (gpio_num_t)pin;
+    config.clk_div = RMT_CLOCK_DIV;
+    config.mem_block_num = 1;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    config.tx_config.idle_output_en = true;
+
+    if (rmt_config(&config) != ESP_OK
+        || rmt_driver_install(channel, 0, 0) != ESP_OK
+        || rmt_translator_init(channel, translate) != ESP_OK) {
+        return false;
+    }
+
+    // Queued frames are started from a task next to the RMT interrupt,
+    // above the lighting task so it gets the wire back without delay
+    if (!serviceTask && xTaskCreatePinnedToCore(service, "rmt", 2048, this, 3,
+                                                &serviceTask, xPortGetCoreID()) != pdPASS) {
+        return false;
+    }
+    outputs[channel] = this;
+    rmt_register_tx_end_callback(txEnd, NULL);
+    return true;
+}
+
+// Interrupt context
+void RmtOutput::txEnd(rmt_channel_t channel, void* arg) {
+    RmtOutput* self = outputs[channel];
+    if (!self) return;
+
+    portENTER_CRITICAL_ISR(&self->mux);
+    self->busy = false;
+    self->frames++;
+    portEXIT_CRITICAL_ISR(&self->mux);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->serviceTask, &woken);
+    if (self->notifyTask) {
+        vTaskNotifyGiveFromISR(self->notifyTask, &woken);
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void RmtOutput::service(void* arg) {
+    RmtOutput* self = (RmtOutput*)arg;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->startQueued();
+    }
+}
+
+// Put the queued frame on the wire if the wire is free
+void RmtOutput::startQueued() {
+    portENTER_CRITICAL(&mux);
+    bool start = queued && !busy && !filling;
+    if (start) {
+        busy = true;
+        queued = false;
+        sending ^= 1;
+    }
+    size_t numBytes = queuedBytes;
+    portEXIT_CRITICAL(&mux);
+
+    if (start) {
+        rmt_write_sample(channel, buffers[sending], numBytes, false);
+    }
+}
+
+void RmtOutput::setBuffers(uint8_t* memory, size_t size) {
+    if (!memory || buffers[0]) return;
+    buffers[0] = memory;
+    buffers[1] = memory + size;
+    capacity = size;
+    external = true;
+}
+
+bool RmtOutput::reserve(size_t numBytes) {
+    if (numBytes <= capacity) return true;
+    if (external) return false;
+
+    // Never move a buffer that is on the wire
+    wait();
+    uint8_t* memory = (uint8_t*)realloc(buffers[0], numBytes * 2);
+    if (!memory) return false;
+    buffers[0] = memory;
+    buffers[1] = memory + numBytes;
+    capacity = numBytes;
+    return true;
+}
+
+bool RmtOutput::showAsync(const uint8_t* pixels, size_t numBytes) {
+    if (!pixels || !numBytes) return true;
+    if (!reserve(numBytes)) return false;
+
+    // Take the buffer that is not on the wire; a frame still waiting in it
+    // is superseded by this one
+    portENTER_CRITICAL(&mux);
+    if (queued) dropped++;
+    queued = false;
+    filling = true;
+    uint8_t* next = buffers[sending ^ 1];
+    portEXIT_CRITICAL(&mux);
+
+    memcpy(next, pixels, numBytes);
+
+    portENTER_CRITICAL(&mux);
+    queuedBytes = numBytes;
+    filling = false;
+    queued = true;
+    portEXIT_CRITICAL(&mux);
+
+    // Start now if the wire is free, otherwise the end of the current frame will
+    startQueued();
+    return true;
+}
+
+// Assumes a 3-byte (RGB-type) strip
+bool RmtOutput::showAsync(Adafruit_NeoPixel& strip) {
+    return showAsync(strip.getPixels(), strip.numPixels() * 3);
+}
+
+void RmtOutput::show(const uint8_t* pixels, size_t numBytes) {
+    if (showAsync(pixels, numBytes)) {
+        wait();
+    }
+}
+
+void RmtOutput::show(Adafruit_NeoPixel& strip) {
+    show(strip.getPixels(), strip.numPixels() * 3);
+}
+
+void RmtOutput::wait() {
+    while (!canShow()) {
+        // Returns at once if the queued frame has not been started yet
+        if (rmt_wait_tx_done(channel, portMAX_DELAY) == ESP_OK) {
+            taskYIELD();
+        }
+    }
+}
+
+bool RmtOutput::canShow() {
+    portENTER_CRITICAL(&mux);
+    bool idle = !busy && !queued;
+    portEXIT_CRITICAL(&mux);
+    return idle;
+}
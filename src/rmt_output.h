@@ -0,0 +1,81 @@
+#ifndef RMT_OUTPUT_H
+#define RMT_OUTPUT_H
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <freertos/semphr.h>
+#include <Adafruit_NeoPixel.h>
+#include "rmt_encoder.h"
+
+#define LATCH_US    300     // Quiet time after a frame before the next one
+
+// WS2812 output through the ESP32 RMT peripheral. Pixel bytes are turned
+// into RMT symbols on the fly by the driver's translator as the transmit
+// memory drains, so no symbol buffer is needed and the CPU (and its
+// interrupts) stay free while the frame is clocked out.
+//
+// The latch is sent as part of the frame (a long low after the last bit),
+// so a transmission that has ended is also latched and the next frame can
+// start right away.
+class RmtOutput {
+public:
+    RmtOutput(uint8_t pin, rmt_channel_t channel = RMT_CHANNEL_0);
+
+    bool begin();
+
+    // Use memory owned by the caller (2 * capacity bytes) for the two frame
+    // copies instead of allocating them. Call before the first show.
+    void setBuffers(uint8_t* memory, size_t capacity);
+
+    // Send a frame; the calling task sleeps until it is out
+    void show(const uint8_t* pixels, size_t numBytes);
+    void show(Adafruit_NeoPixel& strip);
+
+    // Send a frame without waiting. The pixels are copied, so the caller can
+    // start on the next frame at once. If a frame is still going out this
+    // one is queued and sent as soon as it ends; a frame already queued is
+    // replaced (and counted in droppedCount). False if out of memory.
+    // Not reentrant: callers take turns (main.cpp holds stripSem).
+    bool showAsync(const uint8_t* pixels, size_t numBytes);
+    bool showAsync(Adafruit_NeoPixel& strip);
+
+    // Sleep until nothing is being sent or queued
+    void wait();
+
+    // Task to notify each time a frame has gone out
+    void setNotifyTask(TaskHandle_t task) { notifyTask = task; }
+
+    // Like Adafruit_NeoPixel::canShow(), true once the last frame is latched
+    bool canShow();
+
+    uint32_t frameCount() const { return frames; }
+    uint32_t droppedCount() const { return dropped; }
+
+private:
+    static void txEnd(rmt_channel_t channel, void* arg);
+    static void service(void* arg);
+    bool reserve(size_t numBytes);
+    void startQueued();
+
+    uint8_t       pin;
+    rmt_channel_t channel;
+    TaskHandle_t  serviceTask;
+    TaskHandle_t  notifyTask;
+
+    // Two copies of the frame: one on the wire, one filled for the next show.
+    // The flags are shared with the transmit-end interrupt, guarded by mux.
+    uint8_t*      buffers[2];
+    size_t        capacity;
+    bool          external;         // Buffers belong to the caller
+    uint8_t       sending;          // Index of the buffer on the wire
+    size_t        queuedBytes;
+    portMUX_TYPE  mux;
+    volatile bool busy;             // A frame is on the wire
+    volatile bool queued;           // The other buffer is ready to go
+    volatile bool filling;          // The other buffer is being written
+
+    uint32_t      frames;
+    uint32_t      dropped;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "segments.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+SegmentMap::SegmentMap() : segmentCount(0) {
+    memset(slots, 0, sizeof(slots));
+}
+
+// FNV-1a
+uint32_t SegmentMap::hash(const char* name, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Slot holding name in table, or the free slot it would go in (as -1 - slot)
+int8_t SegmentMap::slotOf(const Segment* list, const uint8_t* table,
+                          const char* name, size_t length) const {
+    uint8_t slot = hash(name, length) & (SEGMENT_SLOTS - 1);
+    while (table[slot]) {
+        const char* found = list[table[slot] - 1].name;
+        if (strlen(found) == length && strncmp(found, name, length) == 0) return slot;
+        slot = (slot + 1) & (SEGMENT_SLOTS - 1);
+    }
+    return -1 - slot;
+}
+
+Segment* SegmentMap::find(const char* name, size_t length) {
+    int8_t slot = slotOf(segments, slots, name, length);
+    return slot >= 0 ? &segments[slots[slot] - 1] : NULL;
+}
+
+// One "pixel" or "first-last" run at q, and the comma after it unless it
+// ends the list; q is left on the next run
+static bool parseRun(const char*& q, const char* end, uint16_t numPixels, long& first, long& last) {
+    char* rest;
+    first = strtol(q, &rest, 10);
+    last = first;
+    if (rest == q) return false;
+    if (*rest == '-') {
+        q = rest + 1;
+        last = strtol(q, &rest, 10);
+        if (rest == q) return false;
+    }
+    if (first < 0 || last < first || last >= numPixels) return false;
+    q = rest;
+    if (q == end) return true;
+    if (*q++ != ',') return false;
+    return q < end;     // Nothing after a trailing comma
+}
+
+bool SegmentMap::parse(const char* text, uint16_t numPixels) {
+    // Built aside, so a bad definition leaves the current one in place
+    Segment list[SEGMENTS_MAX];
+    uint16_t listed[SEGMENT_INDICES];
+    uint8_t table[SEGMENT_SLOTS];
+    uint8_t count = 0;
+    uint16_t used = 0;
+    memset(table, 0, sizeof(table));
+
+    const char* p = text;
+    while (*p) {
+        const char* end = strchr(p, ';');
+        if (!end) end = p + strlen(p);
+        const char* equals = (const char*)memchr(p, '=', end - p);
+        if (count == SEGMENTS_MAX || !equals) return false;
+
+        size_t nameLength = equals - p;
+        if (nameLength == 0 || nameLength >= SEGMENT_NAME_MAX) return false;
+        for (const char* c = p; c < equals; c++) {
+            if (!isalnum((unsigned char)*c) && *c != '_') return false;
+        }
+        int8_t slot = slotOf(list, table, p, nameLength);
+        if (slot >= 0) return false;
+
+        Segment& segment = list[count];
+        memset(&segment, 0, sizeof(segment));
+        memcpy(segment.name, p, nameLength);
+        segment.state = -1;
+        segment.level = 255;
+        segment.dirty = true;
+
+        // Check the runs first: a single run is a plain range, and only a
+        // list of them takes room in the index list
+        uint16_t runs = 0;
+        long total = 0;
+        long runFirst = 0;
+        for (const char* q = equals + 1; q < end; runs++) {
+            long first, last;
+            if (!parseRun(q, end, numPixels, first, last)) return false;
+            runFirst = first;
+            total += last - first + 1;
+        }
+        if (runs == 0) return false;
+        if (runs == 1) {
+            segment.first = runFirst;
+            segment.count = total;
+        }
+        else {
+            if (used + total > SEGMENT_INDICES) return false;
+            segment.first = used;
+            segment.count = total;
+            segment.listed = true;
+            for (const char* q = equals + 1; q < end; ) {
+                long first, last;
+                parseRun(q, end, numPixels, first, last);
+                for (long i = first; i <= last; i++) listed[used++] = i;
+            }
+        }
+
+        table[-1 - slot] = ++count;
+        p = *end ? end + 1 : end;
+    }
+
+    memcpy(segments, list, sizeof(list));
+    memcpy(indices, listed, used * sizeof(uint16_t));
+    memcpy(slots, table, sizeof(table));
+    segmentCount = count;
+    return true;
+}
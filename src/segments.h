@@ -0,0 +1,106 @@
+#ifndef SEGMENTS_H
+#define SEGMENTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SEGMENTS_MAX        8
+#define SEGMENT_NAME_MAX    16      // Including the terminator
+#define SEGMENT_INDICES     256     // Listed pixels, over all segments
+#define SEGMENT_SLOTS       16      // Name hash slots, a power of two above SEGMENTS_MAX
+
+// A named zone of the logical strip (marquee, control panel...), a run of
+// pixels or a list of them, drawn with a theme of its own
+typedef struct Segment {
+    char     name[SEGMENT_NAME_MAX];
+    uint16_t first;         // First pixel, or first entry of the index list
+    uint16_t count;
+    bool     listed;        // Pixels come from the index list
+    int      state;         // Theme drawn, -1 to show the main theme
+    uint8_t  level;         // Brightness, 255 as drawn
+    uint32_t frameMs;       // Time between frames, 0 for the theme's own pace
+    uint64_t lastFrame;     // Animation clock, us
+    bool     dirty;         // Settings changed, draw on the next frame
+} Segment;
+
+// The segments of the logical strip, found by name through a small hash
+// table: one probe in the usual case, whatever the number of segments.
+class SegmentMap {
+public:
+    SegmentMap();
+
+    // Replace every segment from "name=pixels;name=pixels", pixels being
+    // comma separated pixels and "first-last" runs, e.g.
+    // "marquee=0-19;panel=24-29;coin=20,22". Every segment starts out
+    // showing the main theme. False if the text is malformed, a name is
+    // repeated or a pixel isn't below numPixels; the segments are unchanged
+    // then.
+    bool parse(const char* text, uint16_t numPixels);
+
+    uint8_t count() const { return segmentCount; }
+    Segment& operator[](uint8_t i) { return segments[i]; }
+
+    // Segment called name (length characters), NULL if there is none
+    Segment* find(const char* name, size_t length);
+
+    // Logical pixel of a segment's pixel i
+    uint16_t pixel(const Segment& segment, uint16_t i) const {
+        return segment.listed ? indices[segment.first + i] : segment.first + i;
+    }
+
+private:
+    static uint32_t hash(const char* name, size_t length);
+    int8_t slotOf(const Segment* list, const uint8_t* table, const char* name, size_t length) const;
+
+    Segment  segments[SEGMENTS_MAX];
+    uint8_t  segmentCount;
+    uint16_t indices[SEGMENT_INDICES];
+    uint8_t  slots[SEGMENT_SLOTS];      // Segment number + 1, 0 if free
+};
+
+// A segment seen by the themes as a strip of its own: pixel i is the
+// segment's pixel i on canvas (a Layer, IndexedFrame or strip), dimmed to
+// the segment's level
+template <class Canvas>
+class SegmentCanvas {
+public:
+    SegmentCanvas(Canvas& canvas, const SegmentMap& map, const Segment& segment) :
+        canvas(canvas), map(map), segment(segment) {}
+
+    uint16_t numPixels() const { return segment.count; }
+
+    void setPixelColor(uint16_t n, uint32_t c) {
+        if (n < segment.count) canvas.setPixelColor(map.pixel(segment, n), dim(c));
+    }
+    uint32_t getPixelColor(uint16_t n) const {
+        return n < segment.count ? canvas.getPixelColor(map.pixel(segment, n)) : 0;
+    }
+
+    // Same bounds as Adafruit_NeoPixel::fill()
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0) {
+        if (first >= segment.count) return;
+        if (count == 0 || first + count > segment.count) count = segment.count - first;
+        c = dim(c);
+        if (!segment.listed) {
+            canvas.fill(c, segment.first + first, count);
+            return;
+        }
+        for (uint16_t i = first; i < first + count; i++) {
+            canvas.setPixelColor(map.pixel(segment, i), c);
+        }
+    }
+
+private:
+    uint32_t dim(uint32_t c) const {
+        if (segment.level == 255) return c;
+        uint32_t rb = (((c & 0x00FF00FF) * segment.level) >> 8) & 0x00FF00FF;
+        uint32_t g  = (((c & 0x0000FF00) * segment.level) >> 8) & 0x0000FF00;
+        return (c & 0xFF000000) | rb | g;
+    }
+
+    Canvas&           canvas;
+    const SegmentMap& map;
+    const Segment&    segment;
+};
+
+#endif
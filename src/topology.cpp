@@ -0,0 +1,181 @@
+#include "topology.h"
+
+typedef struct OrderName {
+    const char*  name;
+    neoPixelType type;
+} OrderName;
+
+static const OrderName orders[] = {
+    { "RGB",  NEO_RGB },  { "RBG",  NEO_RBG },  { "GRB",  NEO_GRB },
+    { "GBR",  NEO_GBR },  { "BRG",  NEO_BRG },  { "BGR",  NEO_BGR },
+    { "RGBW", NEO_RGBW }, { "RBGW", NEO_RBGW }, { "GRBW", NEO_GRBW },
+    { "GBRW", NEO_GBRW }, { "BRGW", NEO_BRGW }, { "BGRW", NEO_BGRW },
+};
+
+static uint8_t typeBytes(neoPixelType type) {
+    return ((type >> 6) & 3) == ((type >> 4) & 3) ? 3 : 4;
+}
+
+// Parse one "pin:length[:order][@offset]" entry ending at end
+static bool parseStrip(const char* p, const char* end, uint16_t next, StripConfig& strip) {
+    char* rest;
+    long pin = strtol(p, &rest, 10);
+    if (rest == p || *rest != ':' || pin < 0 || pin > 39) return false;
+    p = rest + 1;
+
+    long length = strtol(p, &rest, 10);
+    if (rest == p || length <= 0 || length > TOPOLOGY_MAX_PIXELS) return false;
+    p = rest;
+
+    strip.pin = pin;
+    strip.length = length;
+    strip.type = NEO_GRB;
+    strip.offset = next;
+
+    if (p < end && *p == ':') {
+        p++;
+        const char* name = p;
+        while (p < end && *p != '@') p++;
+        bool found = false;
+        for (const OrderName& order : orders) {
+            if (strlen(order.name) == (size_t)(p - name)
+                && strncasecmp(order.name, name, p - name) == 0) {
+                strip.type = order.type;
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+
+    if (p < end && *p == '@') {
+        p++;
+        long offset = strtol(p, &rest, 10);
+        if (rest == p || offset < 0 || offset >= TOPOLOGY_MAX_PIXELS) return false;
+        strip.offset = offset;
+        p = rest;
+    }
+    return p == end && (uint32_t)strip.offset + strip.length <= TOPOLOGY_MAX_PIXELS;
+}
+
+uint8_t parseTopology(const char* text, StripConfig* strips, uint8_t max) {
+    uint8_t count = 0;
+    uint16_t next = 0;
+    const char* p = text;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        if (!end) end = p + strlen(p);
+        if (count == max || !parseStrip(p, end, next, strips[count])) return 0;
+        next = strips[count].offset + strips[count].length;
+        count++;
+        p = *end ? end + 1 : end;
+    }
+    return count;
+}
+
+Topology::Topology() :
+    stripCount(0), logicalPixels(0), mirrored(false), arena(NULL), arenaSize(0),
+    logicalFrame(NULL), frames(NULL), transmit(NULL), indexed(NULL) {
+    memset(frameStart, 0, sizeof(frameStart));
+    memset(luts, 0, sizeof(luts));
+    memset(dithers, 0, sizeof(dithers));
+}
+
+bool Topology::begin(const StripConfig* config, uint8_t count, bool dither, bool withTransmit,
+                     IndexedFrame* indexedFrame) {
+    if (arena || count == 0 || count > TOPOLOGY_MAX_STRIPS) return false;
+
+    // Sizes first: frames are laid out back to back in strip order
+    uint32_t logicalEnd = 0;
+    frameStart[0] = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        logicalEnd = max(logicalEnd, (uint32_t)config[i].offset + config[i].length);
+        frameStart[i + 1] = frameStart[i] + (size_t)config[i].length * typeBytes(config[i].type);
+    }
+    if (logicalEnd > TOPOLOGY_MAX_PIXELS) return false;
+    size_t frameTotal = frameStart[count];
+    size_t logicalBytes = logicalEnd * (indexedFrame ? 1 : 3);
+    if (indexedFrame) dither = false;
+
+    // 16-bit values first, to keep them aligned:
+    // [dither values][logical][frames][transmit][dither error]
+    size_t ditherBytes = dither ? frameTotal * 3 : 0;
+    size_t transmitBytes = withTransmit ? frameTotal * 2 : 0;
+    size_t size = ditherBytes + logicalBytes + frameTotal + transmitBytes;
+    uint8_t* memory = (uint8_t*)calloc(1, size);
+    if (!memory) return false;
+
+    arena = memory;
+    arenaSize = size;
+    uint16_t* values = (uint16_t*)memory;
+    logicalFrame = memory + frameTotal * (dither ? 2 : 0);
+    frames = logicalFrame + logicalBytes;
+    transmit = withTransmit ? frames + frameTotal : NULL;
+    uint8_t* errors = frames + frameTotal + transmitBytes;
+
+    memcpy(strips, config, count * sizeof(StripConfig));
+    stripCount = count;
+    logicalPixels = logicalEnd;
+    indexed = indexedFrame;
+    if (indexed) indexed->adopt(logicalFrame, logicalEnd);
+
+    mirrored = false;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = i + 1; j < count; j++) {
+            if (strips[i].offset < strips[j].offset + strips[j].length
+                && strips[j].offset < strips[i].offset + strips[i].length) mirrored = true;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        luts[i] = new ColorLut(strips[i].type);
+        luts[i]->setSource(NEO_GRB);
+        if (dither) {
+            dithers[i] = new TemporalDither(values + frameStart[i], errors + frameStart[i],
+                                            strips[i].length, typeBytes(strips[i].type));
+        }
+    }
+    return true;
+}
+
+uint32_t Topology::physicalPixels() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < stripCount; i++) {
+        total += strips[i].length;
+    }
+    return total;
+}
+
+uint32_t Topology::level(uint32_t logicalLevel) const {
+    if (!mirrored) return logicalLevel;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < stripCount; i++) {
+        if (indexed) {
+            total += indexed->level(strips[i].offset, strips[i].length);
+            continue;
+        }
+        const uint8_t* p = logicalFrame + strips[i].offset * 3;
+        for (uint32_t n = 0; n < strips[i].length * 3u; n++) total += p[n];
+    }
+    return total;
+}
+
+bool Topology::encode(uint8_t i, uint16_t scale) {
+    if (indexed) {
+        indexed->encode(*luts[i], frame(i), strips[i].offset, strips[i].length, scale);
+        return false;
+    }
+    const uint8_t* src = logicalFrame + strips[i].offset * 3;
+    if (dithers[i]) {
+        dithers[i]->load(src, *luts[i], scale);
+        dithers[i]->render(frame(i));
+        return dithers[i]->dithering();
+    }
+    luts[i]->apply(src, frame(i), strips[i].length, scale);
+    return false;
+}
+
+bool Topology::refresh(uint8_t i) {
+    if (!dithers[i] || !dithers[i]->dithering()) return false;
+    dithers[i]->render(frame(i));
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "color_lut.h"
+#include "dither.h"
+#include "indexed_frame.h"
+
+#define TOPOLOGY_MAX_STRIPS 8       // One per RMT channel
+#define TOPOLOGY_MAX_PIXELS 8192    // Logical pixels
+
+// One physical strip and the run of logical pixels it shows
+typedef struct StripConfig {
+    uint8_t      pin;
+    uint16_t     length;
+    neoPixelType type;      // Color order, e.g. NEO_GRB
+    uint16_t     offset;    // Logical pixel shown by the strip's first pixel
+} StripConfig;
+
+// Parse "pin:length[:order][@offset]", comma separated, e.g.
+// "13:300:GRB,14:300:RGBW". Order defaults to GRB; without an offset a strip
+// continues where the previous one ended. Returns the number of strips,
+// 0 if the text is malformed.
+uint8_t parseTopology(const char* text, StripConfig* strips, uint8_t max);
+
+// Strips of any length and color order, seen by effects as one logical RGB
+// strip (NEO_GRB order, like the rest of the firmware). Strips may overlap
+// in the logical strip, to mirror pixels.
+//
+// All pixel memory lives in one arena allocated by begin(): the logical
+// frame, each strip's corrected frame (back to back, in its own color
+// order), the outputs' transmit buffers and, with dithering, the 16-bit
+// frames and their carried error. With an IndexedFrame the logical frame is
+// one palette index per pixel instead, drawn through that frame.
+class Topology {
+public:
+    Topology();
+
+    // Lay out and allocate the strips; false if invalid or out of memory.
+    // transmit reserves two frames per strip for the outputs. indexed, if
+    // given, adopts the logical frame; there is no dithering then.
+    bool begin(const StripConfig* strips, uint8_t count, bool dither, bool transmit,
+               IndexedFrame* indexed = NULL);
+
+    uint8_t count() const { return stripCount; }
+    const StripConfig& config(uint8_t i) const { return strips[i]; }
+
+    // Logical strip, NEO_GRB order, or palette indices
+    uint16_t numPixels() const { return logicalPixels; }
+    uint8_t* logical() { return logicalFrame; }
+
+    // Pixels over all strips
+    uint32_t physicalPixels() const;
+
+    // Sum of every channel value the strips show (see FastStrip::level()),
+    // for the power estimate. Without overlapping strips that is the
+    // logical strip's, logicalLevel, as it is; mirrored pixels count once
+    // for every strip showing them, so then each strip's pixels are summed.
+    uint32_t level(uint32_t logicalLevel) const;
+
+    // Strip i's corrected frame, ready to send
+    uint8_t* frame(uint8_t i) { return frames + frameStart[i]; }
+    size_t frameBytes(uint8_t i) const { return frameStart[i + 1] - frameStart[i]; }
+
+    // Every strip's frame, back to back
+    uint8_t* allFrames() { return frames; }
+    size_t allFrameBytes() const { return frameStart[stripCount]; }
+
+    // Two frames' worth for strip i's output, NULL unless asked for
+    uint8_t* transmitBuffer(uint8_t i) { return transmit ? transmit + 2 * frameStart[i] : NULL; }
+
+    ColorLut& lut(uint8_t i) { return *luts[i]; }
+
+    // Correct strip i's part of the logical frame into frame(i), scaled by
+    // scale (1-256). True if the strip is dithering and needs refreshing.
+    bool encode(uint8_t i, uint16_t scale);
+
+    // Next dithered frame for strip i; false if it is not dithering
+    bool refresh(uint8_t i);
+
+    size_t arenaBytes() const { return arenaSize; }
+
+private:
+    StripConfig     strips[TOPOLOGY_MAX_STRIPS];
+    uint8_t         stripCount;
+    uint16_t        logicalPixels;
+    size_t          frameStart[TOPOLOGY_MAX_STRIPS + 1];
+    bool            mirrored;       // Some strips overlap
+
+    uint8_t*        arena;
+    size_t          arenaSize;
+    uint8_t*        logicalFrame;
+    uint8_t*        frames;
+    uint8_t*        transmit;
+    IndexedFrame*   indexed;
+
+    ColorLut*       luts[TOPOLOGY_MAX_STRIPS];
+    TemporalDither* dithers[TOPOLOGY_MAX_STRIPS];
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "transition.h"
+#include <string.h>
+#include <strings.h>
+
+Transition::Transition(TransitionType type, uint32_t ms) :
+    type(type), started(0), running(false) {
+    setDuration(ms);
+}
+
+void Transition::start(uint32_t now) {
+    started = now;
+    running = type != TRANSITION_CUT && duration > 0;
+}
+
+void Transition::apply(Layer& incoming, uint32_t now) {
+    uint32_t progress = 256;    // 0-256
+    if (running) {
+        uint32_t elapsed = now - started;
+        if (elapsed < duration) progress = (elapsed << 8) / duration;
+    }
+
+    if (progress >= 256) {
+        running = false;
+        incoming.setMode(BLEND_REPLACE);
+        incoming.setOpacity(255);
+        return;
+    }
+
+    if (type == TRANSITION_CROSSFADE) {
+        incoming.setMode(BLEND_REPLACE);
+        incoming.setOpacity(progress - (progress >> 8));
+        return;
+    }
+
+    // Alpha goes in the top byte of every incoming pixel
+    incoming.setMode(BLEND_ALPHA);
+    incoming.setOpacity(255);
+    uint32_t* p = incoming.pixels();
+    uint16_t n = incoming.numPixels();
+
+    if (type == TRANSITION_WIPE) {
+        // Edge position in 1/256 pixels, from before the first pixel until
+        // it has passed the last one
+        int32_t edge = (int32_t)(progress * (n + TRANSITION_EDGE));
+        for (uint16_t i = 0; i < n; i++) {
+            int32_t a = (edge - ((int32_t)i << 8)) / TRANSITION_EDGE;
+            if (a < 0) a = 0;
+            if (a > 255) a = 255;
+            p[i] = (p[i] & 0xFFFFFF) | ((uint32_t)a << 24);
+        }
+    }
+    else {
+        // Every pixel starts at its own point, from a hash of its index,
+        // and fades in over 1/8 of the transition
+        uint32_t level = (progress * 288) >> 8;
+        for (uint16_t i = 0; i < n; i++) {
+            uint32_t start = (uint32_t)(i * 2654435761UL) >> 24;
+            int32_t a = ((int32_t)level - (int32_t)start) * 8;
+            if (a < 0) a = 0;
+            if (a > 255) a = 255;
+            p[i] = (p[i] & 0xFFFFFF) | ((uint32_t)a << 24);
+        }
+    }
+}
+
+bool parseTransition(const char* name, TransitionType& type) {
+    static const char* const names[] = { "cut", "crossfade", "wipe", "dissolve" };
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            type = (TransitionType)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,49 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include <stdint.h>
+#include "layers.h"
+
+#define TRANSITION_MS       800     // Default duration
+#define TRANSITION_MAX_MS   60000
+#define TRANSITION_EDGE     8       // Width of the wipe's soft edge, in pixels
+
+enum TransitionType {
+    TRANSITION_CUT,         // Switch at once
+    TRANSITION_CROSSFADE,   // Whole strip fades across
+    TRANSITION_WIPE,        // Soft edge runs from the first pixel to the last
+    TRANSITION_DISSOLVE,    // Pixels fade across one by one, in scattered order
+};
+
+// Timed change from the layer below to an incoming layer over it. The time
+// is set in ms and does not depend on the strip length. Every frame,
+// apply() sets the incoming layer's opacity (crossfade) or per-pixel alpha
+// (wipe, dissolve) for the time elapsed, and the layer stack blends the two.
+class Transition {
+public:
+    Transition(TransitionType type = TRANSITION_CROSSFADE, uint32_t ms = TRANSITION_MS);
+
+    void setType(TransitionType t) { type = t; }
+    TransitionType getType() const { return type; }
+    void setDuration(uint32_t ms) { duration = ms < TRANSITION_MAX_MS ? ms : TRANSITION_MAX_MS; }
+    uint32_t getDuration() const { return duration; }
+
+    void start(uint32_t now);
+    void cancel() { running = false; }
+    bool active() const { return running; }
+
+    // Blend incoming for time now. At the end the layer is left opaque and
+    // the transition stops.
+    void apply(Layer& incoming, uint32_t now);
+
+private:
+    TransitionType type;
+    uint32_t       duration;
+    uint32_t       started;
+    bool           running;
+};
+
+// "crossfade", "wipe", "dissolve" or "cut"; false if the name is unknown
+bool parseTransition(const char* name, TransitionType& type);
+
+#endif
@@ -0,0 +1,62 @@
+#include "transpose.h"
+
+// Hacker's Delight transpose8, on two 32-bit halves so it stays in
+// registers on the ESP32. Lanes go in reversed so lane k lands in bit k.
+static inline void transposeWords(uint32_t x, uint32_t y, uint8_t* out) {
+    uint32_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+
+    t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+
+    out[0] = x >> 24; out[1] = x >> 16; out[2] = x >> 8; out[3] = x;
+    out[4] = y >> 24; out[5] = y >> 16; out[6] = y >> 8; out[7] = y;
+}
+
+void transpose8(const uint8_t in[8], uint8_t out[8]) {
+    uint32_t x = ((uint32_t)in[7] << 24) | ((uint32_t)in[6] << 16) | ((uint32_t)in[5] << 8) | in[4];
+    uint32_t y = ((uint32_t)in[3] << 24) | ((uint32_t)in[2] << 16) | ((uint32_t)in[1] << 8) | in[0];
+    transposeWords(x, y, out);
+}
+
+// Lanes that are missing or have run out read from here, a span at a time
+#define ZERO_SPAN   256
+static const uint8_t zeros[ZERO_SPAN] = { 0 };
+
+void transposeLanes(const uint8_t* const lanes[PARALLEL_LANES],
+                    const size_t lengths[PARALLEL_LANES],
+                    size_t count, uint8_t* out) {
+    // In spans where no lane starts or runs out, so every byte goes through
+    // the word path whatever the lanes' lengths
+    size_t i = 0;
+    while (i < count) {
+        size_t end = i + ZERO_SPAN < count ? i + ZERO_SPAN : count;
+        const uint8_t* in[PARALLEL_LANES];
+        for (int k = 0; k < PARALLEL_LANES; k++) {
+            size_t length = lanes[k] ? lengths[k] : 0;
+            if (i < length) {
+                in[k] = lanes[k] + i;
+                if (length < end) end = length;
+            }
+            else {
+                in[k] = zeros;
+            }
+        }
+
+        for (size_t j = 0; j < end - i; j++) {
+            uint32_t x = ((uint32_t)in[7][j] << 24) | ((uint32_t)in[6][j] << 16)
+                       | ((uint32_t)in[5][j] << 8) | in[4][j];
+            uint32_t y = ((uint32_t)in[3][j] << 24) | ((uint32_t)in[2][j] << 16)
+                       | ((uint32_t)in[1][j] << 8) | in[0][j];
+            transposeWords(x, y, out);
+            out += 8;
+        }
+        i = end;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PARALLEL_LANES  8
+
+// Bit-plane transpose of up to 8 lanes into one parallel stream.
+// For every byte position i, 8 bytes are written to out, one per bit slot
+// (MSB first); bit k of each holds lane k's bit for that slot. Lanes that
+// are NULL or shorter than count read as zero. out must hold count * 8 bytes.
+void transposeLanes(const uint8_t* const lanes[PARALLEL_LANES],
+                    const size_t lengths[PARALLEL_LANES],
+                    size_t count, uint8_t* out);
+
+// 8x8 bit matrix transpose of one byte from each lane (in[k] is lane k)
+void transpose8(const uint8_t in[8], uint8_t out[8]);
+
+#endif
@@ -0,0 +1,60 @@
+#include "udp_stream.h"
+
+UdpStream::UdpStream(uint16_t numPixels) :
+    numPixels(numPixels),
+    pixels((uint8_t*)calloc(numPixels, 3)),
+    decoder(pixels, pixels ? numPixels : 0),
+    jitter(numPixels),
+    senderPort(0), lastRequest(0), lastFrame(0), frames(0) {
+}
+
+void UdpStream::begin(uint16_t port) {
+    udp.begin(port);
+}
+
+bool UdpStream::poll() {
+    int size;
+    while ((size = udp.parsePacket()) > 0) {
+        int len = udp.read(packet, sizeof(packet));
+        if (len <= 0) continue;
+
+        sender = udp.remoteIP();
+        senderPort = udp.remotePort();
+
+        switch (decoder.decode(packet, len)) {
+            case DELTA_COMPLETE:
+                // A stream starting after a pause gets a fresh clock estimate
+                if (!active()) jitter.reset();
+                jitter.push(pixels, decoder.timestamp(), millis());
+                frames++;
+                lastFrame = millis();
+                break;
+            case DELTA_OUT_OF_SYNC:
+                requestKeyframe();
+                break;
+            default:
+                break;
+        }
+    }
+    return jitter.play(millis());
+}
+
+void UdpStream::copyTo(Adafruit_NeoPixel& strip) {
+    const uint8_t* p = jitter.output();
+    uint16_t n = min(numPixels, strip.numPixels());
+    for (uint16_t i = 0; i < n; i++) {
+        strip.setPixelColor(i, p[0], p[1], p[2]);
+        p += 3;
+    }
+}
+
+void UdpStream::requestKeyframe() {
+    if (millis() - lastRequest < STREAM_REQUEST_MS) return;
+    lastRequest = millis();
+
+    uint8_t request[DELTA_HEADER_SIZE];
+    deltaKeyframeRequest(request, decoder.sequence());
+    udp.beginPacket(sender, senderPort);
+    udp.write(request, sizeof(request));
+    udp.endPacket();
+}
@@ -0,0 +1,54 @@
+#ifndef UDP_STREAM_H
+#define UDP_STREAM_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Adafruit_NeoPixel.h>
+#include "delta_stream.h"
+#include "jitter_buffer.h"
+
+#define STREAM_PORT         7777
+#define STREAM_TIMEOUT_MS   2500    // Hand back to the theme after this long idle
+#define STREAM_REQUEST_MS   100     // Minimum time between keyframe requests
+
+// Receives the delta-encoded frame stream (see delta_stream.h) over UDP and
+// plays the frames out through a jitter buffer, timed by their timestamps
+class UdpStream {
+public:
+    UdpStream(uint16_t numPixels);
+
+    void begin(uint16_t port = STREAM_PORT);
+
+    // Drain pending packets; returns true when the frame to show has changed
+    bool poll();
+
+    // True while frames keep arriving
+    bool active() const { return frames > 0 && millis() - lastFrame < STREAM_TIMEOUT_MS; }
+
+    // Copy the frame due now into the strip
+    void copyTo(Adafruit_NeoPixel& strip);
+
+    JitterBuffer& playout() { return jitter; }
+    uint32_t frameTimestamp() const { return decoder.timestamp(); }
+    uint32_t frameCount() const { return frames; }
+    uint32_t lostCount() const { return decoder.lostCount(); }
+
+private:
+    void requestKeyframe();
+
+    WiFiUDP       udp;
+    uint16_t      numPixels;
+    uint8_t*      pixels;
+    DeltaDecoder  decoder;
+    JitterBuffer  jitter;
+    uint8_t       packet[DELTA_MAX_PACKET];
+
+    IPAddress     sender;
+    uint16_t      senderPort;
+    unsigned long lastRequest;
+    unsigned long lastFrame;
+    uint32_t      frames;
+};
+
+#endif
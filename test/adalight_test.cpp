@@ -0,0 +1,135 @@
+// Adalight over a pty, the way a PC's ambilight software talks to the USB
+// serial port: the greeting, frames decoded into the strip's color order,
+// resynchronizing after garbage and bad headers, frames longer than the
+// strip, and frame throughput with the host writing flat out.
+
+#include "host_test.h"
+#include "adalight.h"
+#include <thread>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+static void writeAll(int fd, const uint8_t* data, size_t length) {
+    while (length) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0) return;
+        data += n;
+        length -= n;
+    }
+}
+
+// Header and payload for count pixels, pixel i colored (i, seed, 255 - i)
+static size_t makeFrame(uint8_t* out, uint16_t count, uint8_t seed) {
+    uint16_t n = count - 1;
+    out[0] = 'A'; out[1] = 'd'; out[2] = 'a';
+    out[3] = n >> 8;
+    out[4] = n;
+    out[5] = out[3] ^ out[4] ^ 0x55;
+    for (uint16_t i = 0; i < count; i++) {
+        out[6 + i * 3] = i;
+        out[7 + i * 3] = seed;
+        out[8 + i * 3] = 255 - i;
+    }
+    return 6 + count * 3;
+}
+
+static bool frameShown(Adafruit_NeoPixel& strip, uint8_t seed) {
+    for (uint16_t i = 0; i < strip.numPixels(); i++) {
+        uint32_t expected = ((uint32_t)(uint8_t)i << 16) | ((uint32_t)seed << 8) | (uint8_t)(255 - i);
+        if (strip.getPixelColor(i) != expected) return false;
+    }
+    return true;
+}
+
+// Poll until a frame is complete, or a second has passed
+static bool pollFrame(Adalight& adalight) {
+    double begin = hostMicros();
+    while (hostMicros() - begin < 1e6) {
+        if (adalight.poll()) return true;
+    }
+    return false;
+}
+
+int main() {
+    int master, slave;
+    if (openpty(&master, &slave, NULL, NULL, NULL) < 0) {
+        perror("openpty");
+        return 1;
+    }
+    struct termios raw;
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+    tcgetattr(master, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(master, TCSANOW, &raw);
+
+    HardwareSerial port(slave);
+    Adafruit_NeoPixel strip(30, 13, NEO_GRB + NEO_KHZ800);
+    strip.begin();
+    Adalight adalight(port, strip);
+    adalight.begin();
+
+    // The host waits for "Ada\n" before sending
+    char greeting[5] = {0};
+    CHECK_EQ(read(master, greeting, 4), 4);
+    CHECK(strcmp(greeting, "Ada\n") == 0);
+
+    // One frame, in the strip's GRB order underneath
+    uint8_t frame[6 + 1000 * 3];
+    size_t length = makeFrame(frame, 30, 7);
+    writeAll(master, frame, length);
+    CHECK(pollFrame(adalight));
+    CHECK(frameShown(strip, 7));
+    CHECK_EQ(strip.getPixels()[3 * 5 + 1], 5);     // Red of pixel 5 in the G,R,B layout
+
+    // Garbage and a header with a bad checksum are skipped
+    const uint8_t junk[] = { 'x', 'A', 'd', 'A', 'd', 'a', 0, 29, 0 };
+    writeAll(master, junk, sizeof(junk));
+    length = makeFrame(frame, 30, 8);
+    writeAll(master, frame, length);
+    CHECK(pollFrame(adalight));
+    CHECK(frameShown(strip, 8));
+    CHECK_EQ(adalight.errorCount(), 1);
+
+    // Pixels beyond the strip are read and dropped, and the next frame lines up
+    length = makeFrame(frame, 40, 9);
+    writeAll(master, frame, length);
+    CHECK(pollFrame(adalight));
+    CHECK(frameShown(strip, 9));
+    length = makeFrame(frame, 30, 10);
+    writeAll(master, frame, length);
+    CHECK(pollFrame(adalight));
+    CHECK(frameShown(strip, 10));
+    CHECK(adalight.active());
+
+    // Throughput: 300 pixels a frame, written as fast as the pty takes them
+    Adafruit_NeoPixel big(300, 13, NEO_GRB + NEO_KHZ800);
+    big.begin();
+    Adalight bigLight(port, big);
+    const int frames = 2000;
+    length = makeFrame(frame, 300, 1);
+    std::thread host([&] {
+        for (int i = 0; i < frames; i++) {
+            frame[7] = i;   // Some payload change per frame
+            writeAll(master, frame, length);
+        }
+    });
+    double begin = hostMicros();
+    int received = 0;
+    while (received < frames && hostMicros() - begin < 20e6) {
+        if (bigLight.poll()) received++;
+    }
+    double elapsed = hostMicros() - begin;
+    host.join();
+    CHECK_EQ(received, frames);
+    CHECK_EQ(bigLight.errorCount(), 0);
+    printf("300-pixel frames over a pty: %.0f frames/s, %.1f MB/s (1 Mbaud is %.0f frames/s)\n",
+           received / elapsed * 1e6, received * length / elapsed,
+           1000000.0 / 10 / length);
+
+    close(master);
+    close(slave);
+    return testResult("adalight");
+}
@@ -0,0 +1,251 @@
+// Audio: the FFT finding a tone in its bin at every size, WavReader mixing
+// down stereo and skipping chunks it doesn't need, beats found on every kick
+// of a synthetic 120 bpm track with the time from each kick to its beat, the
+// windows handed from a capture thread to an analysis thread, and FFT time
+// per size.
+//
+// Given a WAV file (or - for stdin) it analyzes that instead and prints the
+// levels, beats and timing:
+//
+//   ./build/audio_test music.wav
+//   sox music.mp3 -t wav -b 16 - | ./build/audio_test -
+
+#include "host_test.h"
+#include "audio.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#define RATE        22050
+#define SECONDS     20
+#define BLOCK       128         // Samples per I2S DMA buffer on the device
+#define KICK_FIRST  250000      // us
+#define KICK_EVERY  500000      // 120 bpm
+#define FRAMES      20000
+
+typedef std::vector<uint8_t> Bytes;
+
+static void put16(Bytes& b, uint16_t v) { b.push_back(v); b.push_back(v >> 8); }
+static void put32(Bytes& b, uint32_t v) { put16(b, v); put16(b, v >> 16); }
+
+// A 16-bit PCM WAV file of samples (interleaved if channels > 1), with an
+// extra chunk before the data if given
+static Bytes wavFile(const std::vector<int16_t>& samples, uint16_t channels, uint16_t bits = 16,
+                     const char* extra = NULL) {
+    Bytes b = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' };
+    put32(b, 16);
+    put16(b, 1);
+    put16(b, channels);
+    put32(b, RATE);
+    put32(b, RATE * channels * 2);
+    put16(b, channels * 2);
+    put16(b, bits);
+    if (extra) {
+        b.insert(b.end(), { 'L', 'I', 'S', 'T' });
+        put32(b, strlen(extra));
+        b.insert(b.end(), extra, extra + strlen(extra));
+        if (strlen(extra) & 1) b.push_back(0);
+    }
+    b.insert(b.end(), { 'd', 'a', 't', 'a' });
+    put32(b, samples.size() * 2);
+    for (int16_t s : samples) put16(b, s);
+    uint32_t riff = b.size() - 8;
+    memcpy(&b[4], &riff, 4);
+    return b;
+}
+
+// Every sample a WavReader gets from file
+static bool readAll(FILE* file, std::vector<int16_t>& out, uint32_t& rate) {
+    WavReader wav;
+    if (!file || !wav.open(file)) return false;
+    int16_t block[BLOCK];
+    size_t n;
+    while ((n = wav.read(block, BLOCK)) > 0) out.insert(out.end(), block, block + n);
+    rate = wav.rate();
+    return true;
+}
+
+static bool readBytes(Bytes& bytes, std::vector<int16_t>& out) {
+    FILE* file = fmemopen(bytes.data(), bytes.size(), "rb");
+    uint32_t rate;
+    bool ok = readAll(file, out, rate);
+    if (file) fclose(file);
+    return ok;
+}
+
+// A kick drum on every beat, a hi-hat between and a chord under it all
+static std::vector<int16_t> track() {
+    std::vector<int16_t> out(RATE * SECONDS);
+    srand(1);
+    for (size_t i = 0; i < out.size(); i++) {
+        double t = (double)i / RATE;
+        double v = 0.08 * (sin(2 * M_PI * 220 * t) + sin(2 * M_PI * 277 * t) + sin(2 * M_PI * 330 * t));
+        if (t >= KICK_FIRST / 1e6) {
+            double k = fmod(t - KICK_FIRST / 1e6, KICK_EVERY / 1e6);
+            v += 0.6 * exp(-k * 18) * sin(2 * M_PI * (55 + 60 * exp(-k * 30)) * k);
+        }
+        v += 0.08 * exp(-fmod(t, 0.25) * 60) * (rand() * 2.0 / RAND_MAX - 1);
+        out[i] = v > 1 ? 32767 : v < -1 ? -32768 : (int16_t)(v * 32767);
+    }
+    return out;
+}
+
+struct Run {
+    std::vector<uint64_t> beats;    // Capture time of the window each beat was found in
+    uint32_t windows;
+    double analyzeUs;               // Mean and worst
+    double worstUs;
+};
+
+// Samples through an analyzer in blocks, as the I2S capture task hands them
+// over, analyzing after each block
+static Run analyze(const std::vector<int16_t>& samples, uint32_t rate, bool print) {
+    AudioAnalyzer analyzer(rate);
+    Run run = { {}, 0, 0, 0 };
+    for (size_t i = 0; i + BLOCK <= samples.size(); i += BLOCK) {
+        uint64_t now = (uint64_t)(i + BLOCK - 1) * 1000000 / rate;
+        analyzer.write(&samples[i], BLOCK, now);
+        double begin = hostMicros();
+        if (!analyzer.analyze()) continue;
+        double us = hostMicros() - begin;
+        run.analyzeUs += us;
+        run.worstUs = std::max(run.worstUs, us);
+        run.windows++;
+        const AudioLevels& levels = analyzer.levels();
+        if (levels.beat) run.beats.push_back(levels.beatUs);
+        if (print && (levels.beat || i % rate < BLOCK)) {
+            printf("%7.2f s  bands", levels.windowUs / 1e6);
+            for (int b = 0; b < AUDIO_BANDS; b++) printf(" %3u", levels.bands[b]);
+            printf("  level %3u%s\n", levels.level, levels.beat ? "  beat" : "");
+        }
+    }
+    if (run.windows) run.analyzeUs /= run.windows;
+    return run;
+}
+
+int main(int argc, char** argv) {
+    // A file given: just show what it does
+    if (argc > 1) {
+        FILE* file = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+        std::vector<int16_t> samples;
+        uint32_t rate = 0;
+        if (!readAll(file, samples, rate)) {
+            printf("%s: not a 16-bit PCM WAV file\n", argv[1]);
+            return 1;
+        }
+        printf("%zu samples at %u Hz\n", samples.size(), rate);
+        Run run = analyze(samples, rate, true);
+        printf("%u windows, %zu beats, analysis %.1f us a window (%.1f at most)\n",
+               run.windows, run.beats.size(), run.analyzeUs, run.worstUs);
+        return 0;
+    }
+
+    // A tone on a bin is loudest in that bin, at every size
+    for (uint16_t n = FFT_MIN_SIZE; n <= FFT_MAX_SIZE; n *= 2) {
+        RealFft fft(n);
+        CHECK_EQ(fft.size(), n);
+        std::vector<int16_t> tone(n);
+        std::vector<uint32_t> power(n / 2 + 1);
+        int wrong = 0;
+        for (uint16_t bin = 2; bin < n / 2 - 1; bin += n / 16) {
+            for (uint16_t i = 0; i < n; i++) tone[i] = 16000 * sin(2 * M_PI * bin * i / n);
+            fft.power(tone.data(), power.data());
+            uint16_t loudest = 0;
+            for (uint16_t k = 1; k <= n / 2; k++) if (power[k] > power[loudest]) loudest = k;
+            wrong += loudest != bin;
+        }
+        CHECK_EQ(wrong, 0);
+    }
+    CHECK_EQ(RealFft(100).size(), 0);
+    CHECK_EQ(RealFft(2048).size(), 0);
+
+    // WavReader: stereo mixed down, a chunk before the data skipped, and
+    // anything but 16-bit PCM refused
+    std::vector<int16_t> stereo = { 1000, 3000, -32768, -32768, 32767, 32767, 7, -9 };
+    std::vector<int16_t> mono;
+    Bytes b = wavFile(stereo, 2, 16, "INFOISFTtest");
+    CHECK(readBytes(b, mono));
+    CHECK(mono == std::vector<int16_t>({ 2000, -32768, 32767, -1 }));
+    Bytes eight = wavFile(stereo, 1, 8);
+    CHECK(!readBytes(eight, mono));
+    Bytes garbage = { 'R', 'I', 'F', 'X', 0, 0, 0, 0, 'W', 'A', 'V', 'E' };
+    CHECK(!readBytes(garbage, mono));
+
+    // The track through a WAV file: a beat on every kick, found within one
+    // hop and a half of it starting
+    std::vector<int16_t> music = track();
+    Bytes musicFile = wavFile(music, 1);
+    std::vector<int16_t> samples;
+    CHECK(readBytes(musicFile, samples));
+    CHECK(samples == music);
+    Run run = analyze(samples, RATE, false);
+    uint32_t kicks = (SECONDS * 1000000 - KICK_FIRST) / KICK_EVERY + 1;
+    uint32_t onKicks = 0, spurious = 0;
+    double totalMs = 0, worstMs = 0;
+    for (uint64_t beat : run.beats) {
+        if (beat < KICK_FIRST) {
+            spurious++;
+            continue;
+        }
+        double ms = ((beat - KICK_FIRST) % KICK_EVERY) / 1000.0;
+        if (ms > AUDIO_HOP * 1500.0 / RATE) {
+            spurious++;
+            continue;
+        }
+        onKicks++;
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+    }
+    CHECK_EQ(onKicks, kicks);
+    CHECK_EQ(spurious, 0);
+    printf("%u of %u kicks found, %u spurious; kick to beat %.1f ms on average, %.1f at most\n",
+           onKicks, kicks, spurious, onKicks ? totalMs / onKicks : 0, worstMs);
+    printf("%u windows, analysis %.1f us a window (%.1f at most)\n", run.windows, run.analyzeUs, run.worstUs);
+
+    // Two threads, as on the device: capture at ten times real time never
+    // waits on analysis, and every window is either analyzed or counted as
+    // dropped
+    AudioAnalyzer shared(RATE);
+    std::atomic<bool> done(false);
+    std::thread analysis([&] {
+        while (!done) {
+            if (!shared.analyze()) std::this_thread::yield();
+        }
+        shared.analyze();
+    });
+    uint32_t handed = 0;
+    size_t written = 0;
+    std::chrono::microseconds blockUs(BLOCK * 1000000 / RATE / 10);
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i + BLOCK <= music.size(); i += BLOCK) {
+        // Waits for the next block, as the capture task does on I2S
+        next += blockUs;
+        std::this_thread::sleep_until(next);
+        handed += shared.write(&music[i], BLOCK, (uint64_t)(i + BLOCK - 1) * 1000000 / RATE);
+        written += BLOCK;
+    }
+    done = true;
+    analysis.join();
+    AudioStats& stats = shared.stats();
+    CHECK_EQ(stats.windows + stats.overruns, written / AUDIO_HOP);
+    CHECK_EQ(stats.windows, handed);
+    printf("threads: %u windows analyzed, %u dropped\n", stats.windows, stats.overruns);
+
+    // FFT time per size
+    for (uint16_t n = 64; n <= FFT_MAX_SIZE; n *= 2) {
+        RealFft fft(n);
+        std::vector<uint32_t> power(n / 2 + 1);
+        int frames = FRAMES * 64 / n;
+        double start = hostMicros();
+        for (int f = 0; f < frames; f++) {
+            fft.power(&music[(f * 97) % (music.size() - n)], power.data());
+            benchSink += power[f % (n / 2)];
+        }
+        printf("%4u-point FFT %7.2f us\n", n, (hostMicros() - start) / frames);
+    }
+
+    return testResult("audio");
+}
@@ -0,0 +1,163 @@
+// Delta stream against raw frames on the cabinet's kind of animations:
+// bytes on the wire and decode time per frame, every decoded frame
+// checked against the one sent, and recovery through keyframe requests
+// when packets are lost.
+
+#include "host_test.h"
+#include "delta_stream.h"
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+
+#define FRAMES      500
+#define KEY_EVERY   100     // Frames between unprompted keyframes
+
+typedef void (*Animation)(uint8_t* frame, uint16_t n, int f);
+
+static void put(uint8_t* frame, uint16_t i, uint32_t c) {
+    frame[i * 3] = c >> 16;
+    frame[i * 3 + 1] = c >> 8;
+    frame[i * 3 + 2] = c;
+}
+
+// Solid color, as most game themes are
+static void solid(uint8_t* frame, uint16_t n, int f) {
+    for (uint16_t i = 0; i < n; i++) put(frame, i, 0xFFFF00);
+}
+
+// Theme with the start lamps blinking at the end of the strip
+static void lamps(uint8_t* frame, uint16_t n, int f) {
+    for (uint16_t i = 0; i < n; i++) put(frame, i, 0x0000FF);
+    for (uint16_t i = n - 6; i < n; i++) put(frame, i, (f / 10) & 1 ? 0xFFFFFF : 0);
+}
+
+// Christmas crawl: groups of 6, a step every 25 frames (500 ms)
+static void crawl(uint8_t* frame, uint16_t n, int f) {
+    for (uint16_t i = 0; i < n; i++) put(frame, i, ((i + f / 25) % 12) < 6 ? 0xFF0000 : 0x00FF00);
+}
+
+// Rainbow marquee: every third pixel lit, moving every 2 frames
+static void chase(uint8_t* frame, uint16_t n, int f) {
+    for (uint16_t i = 0; i < n; i++) {
+        put(frame, i, (i + f / 2) % 3 ? 0 : Adafruit_NeoPixel::ColorHSV(i * 65536L / n + f * 256));
+    }
+}
+
+// Rainbow: every pixel changes every frame, the worst case
+static void rainbow(uint8_t* frame, uint16_t n, int f) {
+    for (uint16_t i = 0; i < n; i++) put(frame, i, Adafruit_NeoPixel::ColorHSV(i * 65536L / n + f * 512));
+}
+
+struct Receiver {
+    std::vector<uint8_t> frame;
+    DeltaDecoder decoder;
+    int complete, outOfSync;
+    double decodeUs;
+    Receiver(uint16_t n) : frame(n * 3), decoder(frame.data(), n), complete(0), outOfSync(0), decodeUs(0) {}
+};
+
+struct Link {
+    Receiver* receiver;
+    uint32_t  lossEvery;    // Drop one packet in this many, 0 for none
+    uint32_t  packets;
+    bool      wantKeyframe;
+};
+
+static void deliver(const uint8_t* packet, size_t length, void* context) {
+    Link& link = *(Link*)context;
+    link.packets++;
+    if (link.lossEvery && (link.packets * 2654435761u) % link.lossEvery == 0) return;
+    double begin = hostMicros();
+    DeltaResult result = link.receiver->decoder.decode(packet, length);
+    link.receiver->decodeUs += hostMicros() - begin;
+    if (result == DELTA_COMPLETE) link.receiver->complete++;
+    if (result == DELTA_OUT_OF_SYNC) {
+        link.receiver->outOfSync++;
+        link.wantKeyframe = true;   // A keyframe request on the way back
+    }
+}
+
+// Send FRAMES of an animation; returns wire bytes, counts frames shown wrong
+static size_t stream(Animation animation, uint16_t n, uint32_t lossEvery,
+                     Receiver& receiver, int& wrong, int& shown) {
+    std::vector<uint8_t> prev(n * 3), next(n * 3);
+    Link link = { &receiver, lossEvery, 0, false };
+    uint16_t sequence = 0;
+    size_t bytes = 0;
+    wrong = shown = 0;
+    for (int f = 0; f < FRAMES; f++) {
+        animation(next.data(), n, f);
+        bool key = f % KEY_EVERY == 0 || link.wantKeyframe;
+        link.wantKeyframe = false;
+        int before = receiver.complete;
+        bytes += deltaEncode(f ? prev.data() : NULL, next.data(), n, key, sequence, f * 20, deliver, &link);
+        if (receiver.complete > before) {
+            shown++;
+            if (memcmp(receiver.frame.data(), next.data(), n * 3)) wrong++;
+        }
+        prev.swap(next);
+    }
+    return bytes;
+}
+
+int main() {
+    struct { const char* name; Animation animation; uint16_t n; } cases[] = {
+        { "solid 300",   solid,   300 },
+        { "lamps 300",   lamps,   300 },
+        { "crawl 300",   crawl,   300 },
+        { "chase 300",   chase,   300 },
+        { "rainbow 300", rainbow, 300 },
+        { "rainbow 1000", rainbow, 1000 },
+    };
+
+    printf("%-13s %10s %10s %7s %12s %12s\n", "animation", "raw B/fr", "delta B/fr", "ratio", "decode us", "memcpy us");
+    for (auto& c : cases) {
+        Receiver receiver(c.n);
+        int wrong, shown;
+        size_t bytes = stream(c.animation, c.n, 0, receiver, wrong, shown);
+        CHECK_EQ(shown, FRAMES);
+        CHECK_EQ(wrong, 0);
+
+        // Raw frames: a copy of the whole frame each
+        std::vector<uint8_t> a(c.n * 3), b(c.n * 3);
+        double begin = hostMicros();
+        for (int f = 0; f < FRAMES; f++) {
+            a[f % a.size()] = f;
+            memcpy(b.data(), a.data(), a.size());
+            benchSink += b[f % b.size()];
+        }
+        double copyUs = (hostMicros() - begin) / FRAMES;
+
+        double raw = DELTA_HEADER_SIZE + c.n * 3;
+        double delta = (double)bytes / FRAMES;
+        printf("%-13s %10.0f %10.1f %6.1f%% %12.2f %12.2f\n", c.name, raw, delta,
+               delta * 100 / raw, receiver.decodeUs / FRAMES, copyUs);
+    }
+
+    // Lossy link: every frame shown must be exactly the one sent, and the
+    // stream must recover through keyframe requests
+    for (uint32_t lossEvery : { 50u, 10u, 4u }) {
+        Receiver receiver(300);
+        int wrong, shown;
+        stream(chase, 300, lossEvery, receiver, wrong, shown);
+        CHECK_EQ(wrong, 0);
+        CHECK(shown >= FRAMES / 4);
+        printf("1 packet in %2u lost: %d of %d frames shown, %d resyncs, %u packets lost, none wrong\n",
+               lossEvery, shown, FRAMES, receiver.outOfSync, receiver.decoder.lostCount());
+    }
+
+    // Keyframe requests are headers the sender recognizes
+    uint8_t request[DELTA_HEADER_SIZE];
+    deltaKeyframeRequest(request, 42);
+    CHECK_EQ(request[0], DELTA_MAGIC);
+    CHECK_EQ(request[1] & DELTA_TYPE_MASK, DELTA_KEYFRAME_REQUEST);
+
+    // Truncated and out-of-range packets are refused
+    uint8_t frame[30];
+    DeltaDecoder decoder(frame, 10);
+    uint8_t bad[] = { DELTA_MAGIC, DELTA_KEYFRAME | DELTA_FLAG_END, 0, 0, 0, 0, 0, 0,
+                      DELTA_FILL, 8, 0, 5, 0, 1, 2, 3 };
+    CHECK_EQ(decoder.decode(bad, sizeof(bad)), DELTA_INVALID);
+    CHECK_EQ(decoder.decode(bad, 12), DELTA_INVALID);
+
+    return testResult("delta_stream");
+}
@@ -0,0 +1,92 @@
+// Temporal dither: golden output for a few known 16-bit values, every
+// channel averaging out to its exact value, how many more levels a dim
+// gradient gets than at 8 bits, and what a 300 pixel frame costs.
+
+#include "host_test.h"
+#include "dither.h"
+#include <set>
+#include <string.h>
+
+#define PIXELS  300
+#define FRAMES  10000
+
+// First frames of a 2 pixel dither, from its seeded phases
+static const uint16_t goldenValues[6] = { 0x0000, 0x0080, 0x0140, 0x3210, 0xFF80, 0xFFFF };
+static const uint8_t golden[4][6] = {
+    { 0, 1, 1, 50, 255, 255 },
+    { 0, 0, 1, 50, 255, 255 },
+    { 0, 1, 1, 50, 255, 255 },
+    { 0, 0, 2, 51, 255, 255 },
+};
+
+int main() {
+    TemporalDither small(2);
+    CHECK(small.valid());
+    memcpy(small.values(), goldenValues, sizeof(goldenValues));
+    small.update();
+    CHECK(small.dithering());
+    for (auto& expected : golden) {
+        uint8_t out[6];
+        small.render(out);
+        CHECK(memcmp(out, expected, sizeof(out)) == 0);
+    }
+
+    // Over 256 frames every channel sums to its 16-bit value, short of the
+    // top level where there is nothing to carry into
+    TemporalDither dither(PIXELS);
+    uint16_t* values = dither.values();
+    for (size_t i = 0; i < dither.size(); i++) values[i] = i * 0xFF00 / dither.size();
+    dither.update();
+    uint32_t sums[PIXELS * 3] = {};
+    uint8_t out[PIXELS * 3];
+    for (int f = 0; f < 256; f++) {
+        dither.render(out);
+        for (size_t i = 0; i < dither.size(); i++) sums[i] += out[i];
+    }
+    for (size_t i = 0; i < dither.size(); i++) CHECK_EQ(sums[i], values[i]);
+
+    // Whole 8-bit levels don't dither
+    for (size_t i = 0; i < dither.size(); i++) values[i] = (i & 0xFF) << 8;
+    dither.update();
+    CHECK(!dither.dithering());
+
+    // A gray gradient at brightness 50, as the cabinet runs: levels reaching
+    // the LEDs per frame at 8 bits, and averaged over 16 dithered frames
+    ColorLut lut(NEO_GRB);
+    lut.setBrightness(50);
+    uint8_t gradient[PIXELS * 3], plain[PIXELS * 3];
+    for (int i = 0; i < PIXELS * 3; i++) gradient[i] = i / 3 * 255 / (PIXELS - 1);
+    lut.apply(gradient, plain, PIXELS);
+    dither.load(gradient, lut);
+    CHECK(dither.dithering());
+    uint32_t averaged[PIXELS * 3] = {};
+    for (int f = 0; f < 16; f++) {
+        dither.render(out);
+        for (int i = 0; i < PIXELS * 3; i++) averaged[i] += out[i];
+    }
+    std::set<uint32_t> plainLevels, ditheredLevels;
+    for (int i = 0; i < PIXELS * 3; i += 3) {
+        plainLevels.insert(plain[i]);
+        ditheredLevels.insert(averaged[i]);
+    }
+    CHECK(ditheredLevels.size() > plainLevels.size() * 4);
+    printf("gradient at brightness 50: %zu levels at 8 bits, %zu dithered over 16 frames\n",
+           plainLevels.size(), ditheredLevels.size());
+
+    // Cost per 300 pixel frame; 200 frames a second leaves 5000 us each
+    double begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        dither.render(out);
+        benchSink += out[f % sizeof(out)];
+    }
+    double renderUs = (hostMicros() - begin) / FRAMES;
+    begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        gradient[f % sizeof(gradient)] ^= 1;
+        dither.load(gradient, lut);
+    }
+    double loadUs = (hostMicros() - begin) / FRAMES;
+    printf("300 px frame: render %.2f us, load %.2f us\n", renderUs, loadUs);
+
+    return testResult("dither");
+}
@@ -0,0 +1,93 @@
+// FastStrip against Adafruit_NeoPixel: the same bytes in the buffer for every
+// setter, brightness and color order, the running level against a rescan,
+// and how much faster the compile-time typed setters are for our NEO_GRB strip.
+
+#include "host_test.h"
+#include "fast_strip.h"
+#include <string.h>
+
+#define PIXELS  300
+#define FRAMES  2000
+
+template <neoPixelType TYPE>
+static void compare(const char* name) {
+    FastStrip<TYPE> fast(PIXELS, 13);
+    Adafruit_NeoPixel plain(PIXELS, 13, TYPE);
+    size_t bytes = fast.numPixels() * FastStrip<TYPE>::BYTES_PER_PIXEL;
+
+    for (int brightness = 0; brightness < 256; brightness += 25) {
+        fast.setBrightness(brightness);
+        plain.setBrightness(brightness);
+        for (uint16_t i = 0; i < PIXELS; i++) {
+            uint32_t c = 0x9A12F3E4u * (i + 1) + brightness;
+            if (i % 3 == 0) {
+                fast.setPixelColor(i, c);
+                plain.setPixelColor(i, c);
+            }
+            else if (i % 3 == 1) {
+                fast.setPixelColor(i, c >> 16, c >> 8, c);
+                plain.setPixelColor(i, c >> 16, c >> 8, c);
+            }
+            else {
+                fast.setPixelColor(i, c >> 16, c >> 8, c, c >> 24);
+                plain.setPixelColor(i, c >> 16, c >> 8, c, c >> 24);
+            }
+        }
+        fast.fill(0xAB123456, 17, 40);
+        plain.fill(0xAB123456, 17, 40);
+        fast.setPixelColor(PIXELS, 0xFFFFFF);      // Out of range, ignored
+        CHECK(memcmp(fast.getPixels(), plain.getPixels(), bytes) == 0);
+        for (uint16_t i = 0; i < PIXELS; i++) CHECK_EQ(fast.getPixelColor(i), plain.getPixelColor(i));
+
+        // The running level matches a rescan, also after brightness rescaled the frame
+        uint32_t level = 0;
+        for (size_t i = 0; i < bytes; i++) level += fast.getPixels()[i];
+        CHECK_EQ(fast.level(), level);
+    }
+    fast.clear();
+    CHECK_EQ(fast.level(), 0);
+    printf("%s: same buffer as Adafruit_NeoPixel\n", name);
+}
+
+// A rainbow written pixel by pixel, the way the themes draw
+template <class Strip>
+static double drawUs(Strip& strip) {
+    double begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        for (uint16_t i = 0; i < PIXELS; i++) strip.setPixelColor(i, (i + f) * 0x010203u);
+        benchSink += strip.getPixels()[f % PIXELS];
+    }
+    return (hostMicros() - begin) / FRAMES;
+}
+
+template <class Strip>
+static double readUs(Strip& strip) {
+    double begin = hostMicros();
+    uint32_t total = 0;
+    for (int f = 0; f < FRAMES; f++) {
+        for (uint16_t i = 0; i < PIXELS; i++) total += strip.getPixelColor(i);
+    }
+    benchSink += total;
+    return (hostMicros() - begin) / FRAMES;
+}
+
+int main() {
+    compare<NEO_GRB + NEO_KHZ800>("NEO_GRB");
+    compare<NEO_RGB + NEO_KHZ800>("NEO_RGB");
+    compare<NEO_GRBW + NEO_KHZ800>("NEO_GRBW");
+    compare<NEO_WRGB + NEO_KHZ800>("NEO_WRGB");
+
+    FastStrip<NEO_GRB + NEO_KHZ800> fast(PIXELS, 13);
+    Adafruit_NeoPixel plain(PIXELS, 13, NEO_GRB + NEO_KHZ800);
+    fast.setBrightness(50);
+    plain.setBrightness(50);
+    Adafruit_NeoPixel& wrapped = fast;     // Runtime-typed, as Adalight and uploads see it
+
+    printf("%-24s %10s %10s\n", "300 px NEO_GRB, frame", "set us", "get us");
+    printf("%-24s %10.2f %10.2f\n", "Adafruit_NeoPixel", drawUs(plain), readUs(plain));
+    printf("%-24s %10.2f %10.2f\n", "FastStrip", drawUs(fast), readUs(fast));
+    printf("%-24s %10.2f %10.2f\n", "FastStrip as base class", drawUs(wrapped), readUs(wrapped));
+    fast.invalidateLevel();
+
+    return testResult("fast_strip");
+}
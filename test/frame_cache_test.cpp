@@ -0,0 +1,96 @@
+// Frame cache: a recorded cycle replays exactly what was drawn, run-length
+// or raw, including budgets past 64 KB on large topologies; a cycle over
+// budget is dropped; and replaying costs less than drawing.
+
+#include "host_test.h"
+#include "frame_cache.h"
+#include "layers.h"
+#include <Adafruit_NeoPixel.h>
+#include <string.h>
+
+#define FRAMES  2000
+
+// The Christmas crawl, as drawAlt() in main.cpp draws it at step k
+static void crawl(Layer& layer, uint32_t k) {
+    for (uint16_t i = 0; i < layer.numPixels(); i++) {
+        layer.setPixelColor(i, (i + k) % 12 < 6 ? 0xFF0000 : 0x00FF00);
+    }
+}
+
+// Rainbow along the strip; neighbors share a color on long strips
+static void rainbow(Layer& layer, uint32_t k) {
+    for (uint16_t i = 0; i < layer.numPixels(); i++) {
+        layer.setPixelColor(i, Adafruit_NeoPixel::ColorHSV(i * 65536L / layer.numPixels() + k * 4096));
+    }
+}
+
+// Every pixel different, so frames are stored raw
+static void sparkle(Layer& layer, uint32_t k) {
+    for (uint16_t i = 0; i < layer.numPixels(); i++) {
+        layer.setPixelColor(i, (i * 2654435761u + k * 40503u) >> 8);
+    }
+}
+
+// Record period frames of draw, then replay two cycles against drawing them
+static int replayed(FrameCache& cache, void (*draw)(Layer&, uint32_t), uint16_t n, uint16_t period) {
+    LayerStack layers;
+    CHECK(layers.begin(n, 2));
+    cache.begin(1, n, period);
+    for (uint16_t k = 0; k < period; k++) {
+        draw(layers[0], k);
+        if (!cache.record(layers[0])) return -1;
+    }
+    CHECK(cache.complete());
+    CHECK(cache.holds(1, n));
+    int wrong = 0;
+    for (uint32_t k = 0; k < period * 2u; k++) {
+        draw(layers[0], k % period);
+        layers[1].fill(0x123456);
+        cache.replay(k, layers[1]);
+        wrong += memcmp(layers[0].pixels(), layers[1].pixels(), n * 4) != 0;
+    }
+    return wrong;
+}
+
+int main() {
+    // Run-length: the crawl's 12 steps on 300 pixels take about 10 bytes a
+    // pixel, against 36 raw
+    FrameCache small;
+    CHECK_EQ(replayed(small, crawl, 300, 12), 0);
+    CHECK(small.bytes() < 300 * 11);
+    printf("crawl, 300 px: %zu bytes for 12 frames\n", small.bytes());
+
+    // Raw, past 64 KB: 4 frames of 8192 pixels are 96 KB
+    FrameCache large(128 * 1024);
+    CHECK_EQ(replayed(large, sparkle, 8192, 4), 0);
+    CHECK_EQ(large.bytes(), 4 * 8192 * 3);
+    printf("sparkle, 8192 px: %zu bytes for 4 frames\n", large.bytes());
+
+    // Over budget: dropped, and nothing is replayed
+    FrameCache tight(4000);
+    CHECK_EQ(replayed(tight, sparkle, 300, 12), -1);
+    CHECK(!tight.complete());
+    CHECK(tight.holds(1, 300));
+    CHECK(!tight.holds(2, 300));
+
+    // Replay against drawing the rainbow, 300 pixels
+    FrameCache cycle;
+    CHECK_EQ(replayed(cycle, rainbow, 300, 12), 0);
+    LayerStack layers;
+    layers.begin(300, 1);
+    double begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        rainbow(layers[0], f % 12);
+        benchSink += layers[0].getPixelColor(f % 300);
+    }
+    double drawUs = (hostMicros() - begin) / FRAMES;
+    begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        cycle.replay(f, layers[0]);
+        benchSink += layers[0].getPixelColor(f % 300);
+    }
+    double replayUs = (hostMicros() - begin) / FRAMES;
+    printf("rainbow, 300 px: drawn %.2f us, replayed %.2f us a frame\n", drawUs, replayUs);
+
+    return testResult("frame_cache");
+}
@@ -0,0 +1,44 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Checks and timing for the host tests. Each test is a program that prints
+// what it measured and exits non-zero if a check failed.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long _a = (long long)(a), _b = (long long)(b); \
+        if (_a != _b) { \
+            printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+                   __FILE__, __LINE__, #a, #b, _a, _b); \
+            failures++; \
+        } \
+    } while (0)
+
+// Exit status for main()
+static inline int testResult(const char* name) {
+    printf("%s: %s\n", name, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
+
+// Host time in microseconds, for benchmarks
+static inline double hostMicros() {
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps a benchmark's result from being optimized away
+static volatile uint32_t benchSink;
+
+#endif
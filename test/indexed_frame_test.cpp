@@ -0,0 +1,219 @@
+// Indexed frame: colors given palette entries as they come, entries no pixel
+// shows any more reused, the nearest entry once the palette is full, the
+// level from the entry counts against FastStrip's through random writes,
+// reserved entries left alone, rotating the palette leaving the pixels as
+// they are, the Christmas crawl by palette cycling as main.cpp draws it, and
+// encoding against the RGB path: the same bytes in every color order, and
+// the time for the crawl and encoding at 8192 pixels.
+
+#include "host_test.h"
+#include "indexed_frame.h"
+#include "fast_strip.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define PIXELS      300
+#define LARGE       8192
+#define FRAMES      200
+#define RED         0xFF0000
+#define GREEN       0x00FF00
+
+typedef FastStrip<NEO_GRB + NEO_KHZ800> Strip;
+
+// What the frame shows, into an RGB strip
+static void mirror(IndexedFrame& frame, Strip& strip) {
+    for (uint16_t i = 0; i < frame.numPixels(); i++) strip.setPixelColor(i, frame.getPixelColor(i));
+}
+
+// The crawl as main.cpp draws it on RGB canvases
+template <class Canvas>
+static void drawAlt(Canvas& layer, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset) {
+    uint16_t currentGroupSize = offset % (2 * groupSize);
+    bool colorSelected = false;
+    if (currentGroupSize >= groupSize) {
+        colorSelected = !colorSelected;
+        currentGroupSize -= groupSize;
+    }
+    for (int i = 0; i < layer.numPixels(); i++) {
+        if (currentGroupSize >= groupSize) {
+            colorSelected = !colorSelected;
+            currentGroupSize = 0;
+        }
+        layer.setPixelColor(i, colorSelected ? color2 : color1);
+        currentGroupSize += 1;
+    }
+}
+
+// ... and on the indexed frame, by cycling the palette
+static bool crawlLaidOut = false;
+static uint32_t crawlOffset = 0;
+
+static void drawCrawl(IndexedFrame& frame, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset) {
+    uint16_t entries = 2 * groupSize;
+    if (!crawlLaidOut) {
+        frame.clear();
+        frame.reserve(entries);
+        for (uint16_t k = 0; k < entries; k++) {
+            frame.setPaletteColor(entries - 1 - k, (k + offset) % entries < groupSize ? color1 : color2);
+        }
+        for (uint16_t i = 0; i < frame.numPixels(); i++) {
+            frame.setPixelIndex(i, entries - 1 - i % entries);
+        }
+        crawlLaidOut = true;
+    }
+    else {
+        for (uint32_t k = (offset - crawlOffset) % entries; k > 0; k--) {
+            frame.rotatePalette(0, entries);
+        }
+    }
+    crawlOffset = offset;
+}
+
+int main() {
+    std::vector<uint8_t> memory(LARGE);
+    Strip strip(PIXELS, 13);
+
+    // Entries as colors come; reused once no pixel shows them; the nearest
+    // once the palette is full
+    IndexedFrame small(4);
+    small.adopt(memory.data(), 30);
+    small.fill(RED);
+    CHECK_EQ(small.getPixelIndex(29), 1);
+    small.fill(GREEN);
+    CHECK_EQ(small.getPixelIndex(0), 0);            // Black's entry, now free
+    small.setPixelColor(3, 0x0000FF);
+    CHECK_EQ(small.getPixelIndex(3), 1);            // Red's
+    small.setPixelColor(4, 0x000000);
+    small.setPixelColor(5, 0xFFFFFF);
+    CHECK_EQ(small.getPixelIndex(5), 3);
+    small.setPixelColor(6, 0x1010F0);               // Full: blue is nearest
+    CHECK_EQ(small.getPixelIndex(6), 1);
+    CHECK_EQ(small.getPixelColor(6), 0x0000FF);
+    CHECK_EQ(small.indexOf(GREEN), 0);
+    CHECK_EQ(small.indexOf(GREEN), 0);              // From the cache
+
+    // Level against FastStrip's through mixed writes, palette changes and
+    // more colors than entries
+    IndexedFrame frame(16);
+    frame.adopt(memory.data(), PIXELS);
+    srand(1);
+    uint32_t colors[40];
+    for (uint32_t& c : colors) c = (rand() * 7919u) & 0xFFFFFF;
+    int checked = 0;
+    for (int k = 0; k < 20000; k++) {
+        uint16_t n = rand() % (PIXELS + 10);
+        uint32_t c = colors[rand() % 40];
+        switch (rand() % 6) {
+            case 0: frame.setPixelColor(n, c); break;
+            case 1: frame.setPixelColor(n, c >> 16, c >> 8, c); break;
+            case 2: frame.fill(c, n, rand() % 20); break;
+            case 3: frame.fillIndex(rand() % 16, n, rand() % 20); break;
+            case 4: if (k % 100 == 0) frame.setPaletteColor(rand() % 16, c); break;
+            default: if (k % 3000 == 0) frame.clear(); break;
+        }
+        if (k % 97 == 0) {
+            mirror(frame, strip);
+            CHECK_EQ(frame.level(), strip.level());
+            CHECK_EQ(frame.level(0, PIXELS), strip.level());
+            uint32_t part = 0;
+            for (uint16_t i = 100; i < 150; i++) {
+                uint32_t c = frame.getPixelColor(i);
+                part += (c >> 16 & 0xFF) + (c >> 8 & 0xFF) + (c & 0xFF);
+            }
+            CHECK_EQ(frame.level(100, 50), part);
+            checked++;
+        }
+    }
+    printf("level matched FastStrip's %d times through 20000 random writes\n", checked);
+
+    // Reserved entries are neither matched nor handed out, full or not
+    frame.clear();
+    frame.reserve(4);
+    for (uint8_t i = 0; i < 4; i++) frame.setPaletteColor(i, i ? RED : GREEN);
+    CHECK(frame.indexOf(RED) >= 4);
+    CHECK(frame.indexOf(GREEN) >= 4);
+    for (uint16_t i = 0; i < 16; i++) frame.setPixelColor(i, i * 0x111111);
+    CHECK(frame.indexOf(0xFE0000) >= 4);
+    CHECK_EQ(frame.reservedEntries(), 4);
+    frame.clear();
+    CHECK_EQ(frame.reservedEntries(), 0);
+
+    // Rotating the palette moves colors, not pixels
+    for (uint16_t i = 0; i < PIXELS; i++) frame.setPixelColor(i, colors[i % 8]);
+    std::vector<uint8_t> before(frame.indices(), frame.indices() + PIXELS);
+    uint32_t palette[16];
+    for (uint8_t i = 0; i < 16; i++) palette[i] = frame.getPaletteColor(i);
+    frame.rotatePalette(0, 8);
+    CHECK(memcmp(before.data(), frame.indices(), PIXELS) == 0);
+    int moved = 0;
+    for (uint16_t i = 0; i < PIXELS; i++) {
+        uint8_t index = frame.getPixelIndex(i);
+        moved += frame.getPixelColor(i) != palette[index < 8 ? (index + 7) % 8 : index];
+    }
+    CHECK_EQ(moved, 0);
+    mirror(frame, strip);
+    CHECK_EQ(frame.level(), strip.level());         // Counts follow the entries, not the colors
+
+    // The crawl by cycling against drawing it, stepping and skipping steps
+    int wrong = 0;
+    crawlLaidOut = false;
+    for (uint32_t offset : { 0u, 1u, 2u, 3u, 8u, 9u, 20u, 21u, 33u }) {
+        drawCrawl(frame, RED, GREEN, 6, offset);
+        drawAlt(strip, RED, GREEN, 6, offset);
+        for (uint16_t i = 0; i < PIXELS; i++) wrong += frame.getPixelColor(i) != strip.getPixelColor(i);
+        CHECK_EQ(frame.level(), strip.level());
+    }
+    CHECK_EQ(wrong, 0);
+
+    // Encoding: the same bytes as correcting the RGB strip, in every order,
+    // scaled or not, in full or in part
+    const neoPixelType types[] = { NEO_GRB, NEO_RGB, NEO_BGR, NEO_RGBW, NEO_GRBW };
+    IndexedFrame many(INDEXED_MAX_COLORS);
+    many.adopt(memory.data(), PIXELS);
+    for (uint16_t i = 0; i < PIXELS; i++) many.setPixelColor(i, colors[rand() % 40]);
+    mirror(many, strip);
+    std::vector<uint8_t> indexedOut(PIXELS * 4), rgbOut(PIXELS * 4);
+    int different = 0;
+    for (neoPixelType type : types) {
+        ColorLut lut(type);
+        lut.setSource(NEO_GRB);
+        for (uint16_t scale : { 256, 100 }) {
+            many.encode(lut, indexedOut.data(), 0, PIXELS, scale);
+            lut.apply(strip.getPixels(), rgbOut.data(), PIXELS, scale);
+            different += memcmp(indexedOut.data(), rgbOut.data(), PIXELS * lut.bytesPerPixel()) != 0;
+            many.encode(lut, indexedOut.data(), 100, 50, scale);
+            lut.apply(strip.getPixels() + 100 * 3, rgbOut.data(), 50, scale);
+            different += memcmp(indexedOut.data(), rgbOut.data(), 50 * lut.bytesPerPixel()) != 0;
+        }
+    }
+    CHECK_EQ(different, 0);
+
+    // 8192 pixels: the crawl drawn or cycled, and encoded
+    IndexedFrame large(16);
+    large.adopt(memory.data(), LARGE);
+    Strip rgb(LARGE, 13);
+    ColorLut lut(NEO_GRB);
+    std::vector<uint8_t> out(LARGE * 3);
+    struct {
+        const char* name;
+        void (*run)(IndexedFrame&, Strip&, ColorLut&, uint8_t*, uint32_t);
+    } cases[] = {
+        { "crawl drawn, RGB",     [](IndexedFrame&, Strip& s, ColorLut&, uint8_t*, uint32_t f) { drawAlt(s, RED, GREEN, 6, f); } },
+        { "crawl drawn, indexed", [](IndexedFrame& i, Strip&, ColorLut&, uint8_t*, uint32_t f) { drawAlt(i, RED, GREEN, 6, f); } },
+        { "crawl cycled",         [](IndexedFrame& i, Strip&, ColorLut&, uint8_t*, uint32_t f) { drawCrawl(i, RED, GREEN, 6, f); } },
+        { "encode RGB",           [](IndexedFrame&, Strip& s, ColorLut& l, uint8_t* o, uint32_t) { l.apply(s.getPixels(), o, LARGE); } },
+        { "encode indexed",       [](IndexedFrame& i, Strip&, ColorLut& l, uint8_t* o, uint32_t) { i.encode(l, o, 0, LARGE); } },
+    };
+    crawlLaidOut = false;
+    for (auto& c : cases) {
+        double begin = hostMicros();
+        for (int f = 0; f < FRAMES; f++) {
+            c.run(large, rgb, lut, out.data(), f);
+            benchSink += out[f] + large.getPixelIndex(f) + rgb.getPixels()[f];
+        }
+        printf("%-22s %8.1f us a frame of %u pixels\n", c.name, (hostMicros() - begin) / FRAMES, LARGE);
+    }
+
+    return testResult("indexed_frame");
+}
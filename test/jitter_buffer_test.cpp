@@ -0,0 +1,144 @@
+// JitterBuffer fed by a simulated WiFi sender: 50 frames a second, lossy,
+// with jittery transit and bursts where frames queue up and arrive
+// together. Checks play-out order, the reported metrics and how much
+// steadier play-out is than arrival, with frames held or interpolated.
+
+#include "host_test.h"
+#include "jitter_buffer.h"
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <random>
+
+#define PIXELS      10
+#define FRAME_MS    20
+#define FRAMES      3000
+#define CLOCK_SKEW  123456      // Receiver clock minus sender clock
+
+struct Arrival {
+    uint32_t at;            // Receiver time
+    uint32_t timestamp;     // Sender time
+};
+
+static std::vector<Arrival> simulate(uint32_t seed, double loss, uint32_t jitterMs, uint32_t burstMs) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<Arrival> arrivals;
+    uint32_t stallUntil = 0;
+    for (uint32_t f = 0; f < FRAMES; f++) {
+        uint32_t timestamp = 1000 + f * FRAME_MS;
+        if (uniform(random) < loss) continue;
+        uint32_t at = timestamp + CLOCK_SKEW + 5 + random() % (jitterMs + 1);
+        // Now and then the link stalls and everything sent meanwhile arrives at once
+        if (burstMs && uniform(random) < 0.01) stallUntil = at + burstMs;
+        if (at < stallUntil) at = stallUntil;
+        // One queue: a frame can't overtake the one sent before it
+        if (!arrivals.empty() && at < arrivals.back().at) at = arrivals.back().at;
+        arrivals.push_back({ at, timestamp });
+    }
+    return arrivals;
+}
+
+static double deviation(const std::vector<double>& v) {
+    double mean = 0, square = 0;
+    for (double x : v) mean += x;
+    mean /= v.size();
+    for (double x : v) square += (x - mean) * (x - mean);
+    return sqrt(square / v.size());
+}
+
+struct Result {
+    JitterStats stats;
+    double arrivalDeviation, playDeviation;
+    int outOfOrder, blended;
+};
+
+static Result run(const std::vector<Arrival>& arrivals, uint32_t delay, bool interpolate) {
+    JitterBuffer buffer(PIXELS);
+    buffer.setDelay(delay);
+    buffer.setInterpolate(interpolate);
+    Result result = {};
+
+    // Frame content is the frame number, so play-out order can be read back
+    uint8_t frame[PIXELS * 3];
+    std::vector<double> arrivalGaps, playGaps;
+    size_t next = 0;
+    int lastShown = -1, lastPlayedAt = -1, lastArrival = -1;
+    uint32_t end = arrivals.back().at + 500;
+    for (uint32_t now = arrivals.front().at; now < end; now++) {
+        for (; next < arrivals.size() && arrivals[next].at <= now; next++) {
+            memset(frame, (arrivals[next].timestamp / FRAME_MS) & 0xFF, sizeof(frame));
+            buffer.push(frame, arrivals[next].timestamp, now);
+            if (lastArrival >= 0) arrivalGaps.push_back(now - lastArrival);
+            lastArrival = now;
+        }
+        uint32_t played = buffer.stats().played;
+        if (!buffer.play(now)) continue;
+
+        uint8_t shown = buffer.output()[0];
+        if (buffer.stats().played != played) {
+            // A new frame was taken; frames never go backwards
+            if (lastShown >= 0 && (int8_t)(shown - lastShown) < 0 && !interpolate) result.outOfOrder++;
+            if (lastPlayedAt >= 0) playGaps.push_back(now - lastPlayedAt);
+            lastPlayedAt = now;
+            lastShown = shown;
+        }
+        else if (interpolate) {
+            result.blended++;
+        }
+    }
+    result.stats = buffer.stats();
+    result.arrivalDeviation = deviation(arrivalGaps);
+    result.playDeviation = deviation(playGaps);
+    return result;
+}
+
+int main() {
+    struct { const char* name; double loss; uint32_t jitter, burst, delay; } cases[] = {
+        { "clean",            0.00,  5,   0,  60 },
+        { "jittery",          0.02, 40,   0,  60 },
+        { "jittery, bursts",  0.05, 40, 120,  60 },
+        { "bursts, 140 ms",   0.05, 40, 120, 140 },
+    };
+    printf("%-16s %6s %6s %6s %6s %8s %9s %10s %10s\n", "link", "delay", "played", "late",
+           "under", "jitter", "playout", "arrive sd", "play sd");
+    for (auto& c : cases) {
+        std::vector<Arrival> arrivals = simulate(7, c.loss, c.jitter, c.burst);
+        Result held = run(arrivals, c.delay, false);
+        printf("%-16s %6u %6u %6u %6u %8u %9u %10.2f %10.2f\n", c.name, c.delay,
+               held.stats.played, held.stats.late, held.stats.underruns, held.stats.jitter,
+               held.stats.playoutJitter, held.arrivalDeviation, held.playDeviation);
+
+        CHECK_EQ(held.outOfOrder, 0);
+        CHECK(held.stats.played + held.stats.late + held.stats.overflow <= arrivals.size());
+        CHECK(held.stats.playoutJitter <= 1);
+        CHECK(held.playDeviation <= held.arrivalDeviation);
+        if (c.burst == 0) CHECK(held.stats.played >= arrivals.size() * 95 / 100);
+
+        // Interpolation: output keeps moving between frames
+        Result blended = run(arrivals, c.delay, true);
+        CHECK(blended.blended > (int)blended.stats.played);
+        CHECK_EQ(blended.stats.played, held.stats.played);
+    }
+
+    // A delay long enough for the bursts loses fewer frames to lateness
+    std::vector<Arrival> bursty = simulate(7, 0.05, 40, 120);
+    CHECK(run(bursty, 140, false).stats.late < run(bursty, 60, false).stats.late);
+
+    // A sender restarting its clock is followed
+    JitterBuffer buffer(PIXELS);
+    uint8_t frame[PIXELS * 3] = {0};
+    for (uint32_t now = 1000; now < 2000; now++) {
+        if (now % FRAME_MS == 0) buffer.push(frame, 50000 + now, now);
+        buffer.play(now);
+    }
+    uint32_t played = buffer.stats().played;
+    CHECK(played >= 45);
+    for (uint32_t now = 3000; now < 4000; now++) {
+        if (now % FRAME_MS == 0) buffer.push(frame, now - 3000, now);
+        buffer.play(now);
+    }
+    CHECK(buffer.stats().played >= played + 45);
+
+    return testResult("jitter_buffer");
+}
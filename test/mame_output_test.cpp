@@ -0,0 +1,136 @@
+// MameOutput against a scripted fake MAME output server on localhost:
+// games are picked up, lamps are mapped onto pixels, lines split across
+// packets and junk are handled, and the time from a message being sent to
+// its lamp being painted is measured.
+
+#include "host_test.h"
+#include "mame_output.h"
+#include "fast_strip.h"
+#include "layers.h"
+#include "games.h"
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+static int listenSocket(uint16_t& port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(s, (struct sockaddr*)&address, length);
+    listen(s, 1);
+    getsockname(s, (struct sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+    return s;
+}
+
+static void sendText(int s, const char* text) {
+    send(s, text, strlen(text), MSG_NOSIGNAL);
+}
+
+// Poll as the network task does, painting as the lighting task does, until
+// pixel shows color or timeout ms pass; returns the time it took in us, or -1
+static double waitForPixel(MameOutput& mame, FastStrip<NEO_GRB + NEO_KHZ800>& strip,
+                           uint16_t pixel, uint32_t color, double sent, int timeout) {
+    while (hostMicros() - sent < timeout * 1000.0) {
+        mame.poll();
+        mame.apply(strip);
+        if (strip.getPixelColor(pixel) == color) return hostMicros() - sent;
+    }
+    return -1;
+}
+
+int main() {
+    uint16_t port;
+    int server = listenSocket(port);
+    MameOutput mame("127.0.0.1", port, mameGames, mameGameCount);
+    TaskHandle_t lighting = hostTaskCreate();
+    mame.setNotifyTask(lighting);
+    FastStrip<NEO_GRB + NEO_KHZ800> strip(30, 13);
+    strip.begin();
+
+    // The first poll connects straight away
+    mame.poll();
+    CHECK(mame.connected());
+    int client = accept(server, NULL, NULL);
+    CHECK(client >= 0);
+
+    // Starting a game switches theme
+    sendText(client, "mame_start = pacman\r");
+    int gameId = -2;
+    double begin = hostMicros();
+    while (!mame.takeGameChange(gameId) && hostMicros() - begin < 1e6) mame.poll();
+    CHECK_EQ(gameId, games::pacman);
+
+    // Start lamps light in pacman's yellow, and the lighting task is woken
+    ulTaskNotifyTake(pdTRUE, 0);
+    sendText(client, "led0 = 1\r");
+    CHECK(waitForPixel(mame, strip, 24, 0xFFFF00, hostMicros(), 1000) >= 0);
+    CHECK_EQ(strip.getPixelColor(26), 0xFFFF00);
+    CHECK_EQ(strip.getPixelColor(27), 0);
+    CHECK(ulTaskNotifyTake(pdTRUE, 0) > 0);
+
+    // A line split across packets, unknown names and an overlong line
+    sendText(client, "coin_lockout0 = 1\rthis_name_is_much_too_long_to_be_any_output_we_map = 1\rle");
+    delay(5);
+    mame.poll();
+    CHECK_EQ(strip.getPixelColor(27), 0);
+    sendText(client, "d1 = 1\r");
+    CHECK(waitForPixel(mame, strip, 27, 0xFFFF00, hostMicros(), 1000) >= 0);
+
+    // Repeating a value doesn't wake the lighting task again
+    ulTaskNotifyTake(pdTRUE, 0);
+    sendText(client, "led1 = 1\r");
+    delay(5);
+    mame.poll();
+    CHECK(!mame.apply(strip));
+    CHECK_EQ(ulTaskNotifyTake(pdTRUE, 0), 0);
+
+    // Latency from the message leaving the server to the lamp being painted
+    const int toggles = 200;
+    double total = 0, worst = 0;
+    int missed = 0;
+    for (int i = 0; i < toggles; i++) {
+        bool on = i & 1;
+        sendText(client, on ? "led0 = 1\r" : "led0 = 0\r");
+        double latency = waitForPixel(mame, strip, 24, on ? 0xFFFF00 : 0, hostMicros(), 1000);
+        if (latency < 0) {
+            missed++;
+            continue;
+        }
+        total += latency;
+        worst = max(worst, latency);
+    }
+    CHECK_EQ(missed, 0);
+    printf("message to pixel: %.1f us mean, %.1f us worst over %d toggles\n",
+           total / toggles, worst, toggles);
+
+    // On the lamp layer, as the lighting task paints them
+    LayerStack layers;
+    CHECK(layers.begin(30, 1));
+    layers[0].fill(0xFF123456);
+    mame.apply(layers[0], 0xFF000000);
+    CHECK_EQ(layers[0].getPixelColor(24), 0xFFFFFF00);
+    CHECK_EQ(layers[0].getPixelColor(0), 0);
+
+    // Stopping the game is reported as -1, and its lamps leave the layer
+    sendText(client, "mame_stop = 1\r");
+    begin = hostMicros();
+    while (!mame.takeGameChange(gameId) && hostMicros() - begin < 1e6) mame.poll();
+    CHECK_EQ(gameId, -1);
+    CHECK(mame.apply(layers[0], 0xFF000000));
+    CHECK_EQ(layers[0].getPixelColor(24), 0);
+
+    // Server going away is noticed
+    close(client);
+    delay(5);
+    mame.poll();
+    CHECK(!mame.connected());
+
+    close(server);
+    return testResult("mame_output");
+}
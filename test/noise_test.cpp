@@ -0,0 +1,140 @@
+// Noise: the row functions against the scalar ones, zero on the lattice and
+// a period of 256 cells, the range used without clamping (every 1D
+// coordinate, sampled rows in 2D and 3D) and the largest step between
+// neighboring pixels, and throughput in pixels per millisecond for each
+// dimension against per-pixel calls and floating-point Perlin noise.
+
+#include "host_test.h"
+#include "noise.h"
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define PIXELS  300
+#define FRAMES  20000
+#define DX      3000            // About 22 pixels a cell, as the effects use
+#define ROWS    200
+#define ROW     4096
+
+// Ken Perlin's improved noise in floats, for the speed we'd get without
+// fixed point
+static int perm[512];
+
+static double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+static double lerp(double t, double a, double b) { return a + t * (b - a); }
+
+static double grad(int hash, double x, double y, double z) {
+    int h = hash & 15;
+    double u = h < 8 ? x : y;
+    double v = h < 4 ? y : h == 12 || h == 14 ? x : z;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+static double perlin(double x, double y, double z) {
+    int X = (int)floor(x) & 255, Y = (int)floor(y) & 255, Z = (int)floor(z) & 255;
+    x -= floor(x);
+    y -= floor(y);
+    z -= floor(z);
+    double u = fade(x), v = fade(y), w = fade(z);
+    int A = perm[X] + Y, AA = perm[A] + Z, AB = perm[A + 1] + Z;
+    int B = perm[X + 1] + Y, BA = perm[B] + Z, BB = perm[B + 1] + Z;
+    return lerp(w, lerp(v, lerp(u, grad(perm[AA], x, y, z),         grad(perm[BA], x - 1, y, z)),
+                           lerp(u, grad(perm[AB], x, y - 1, z),     grad(perm[BB], x - 1, y - 1, z))),
+                   lerp(v, lerp(u, grad(perm[AA + 1], x, y, z - 1), grad(perm[BA + 1], x - 1, y, z - 1)),
+                           lerp(u, grad(perm[AB + 1], x, y - 1, z - 1), grad(perm[BB + 1], x - 1, y - 1, z - 1))));
+}
+
+struct Spread {
+    int low, high, step, clamped;
+};
+
+static void measure(Spread& s, const int16_t* row, int count) {
+    for (int i = 0; i < count; i++) {
+        s.low = min(s.low, (int)row[i]);
+        s.high = max(s.high, (int)row[i]);
+        if (i) s.step = max(s.step, abs(row[i] - row[i - 1]));
+        s.clamped += row[i] == 32767 || row[i] == -32768;
+    }
+}
+
+int main() {
+    static int16_t row[ROW];
+
+    // Rows are the scalar functions, across cell edges and the wrap
+    int different = 0;
+    uint32_t x = 0xFFF00000;
+    noiseRow1(row, PIXELS, x, DX);
+    for (int i = 0; i < PIXELS; i++) different += row[i] != noise1(x + i * DX);
+    noiseRow2(row, PIXELS, x, DX, 50000);
+    for (int i = 0; i < PIXELS; i++) different += row[i] != noise2(x + i * DX, 50000);
+    noiseRow3(row, PIXELS, x, DX, 50000, 70000);
+    for (int i = 0; i < PIXELS; i++) different += row[i] != noise3(x + i * DX, 50000, 70000);
+    CHECK_EQ(different, 0);
+
+    // Zero on the lattice, and the same 256 cells on
+    int off = 0, unlike = 0;
+    for (uint32_t k = 0; k < 300; k++) {
+        uint32_t cell = k * 7919 << 16;
+        off += noise1(cell) != 0;
+        off += noise2(cell, cell * 3) != 0;
+        off += noise3(cell, cell * 3, cell * 5) != 0;
+        uint32_t p = k * 48271 + 12345;
+        unlike += noise3(p, p * 3, p * 5) != noise3(p + (256 << 16), p * 3 + (256 << 16), p * 5);
+    }
+    CHECK_EQ(off, 0);
+    CHECK_EQ(unlike, 0);
+
+    // Most of the 16-bit range is used but never clamped, and neighbors
+    // never jump. In 1D that is every coordinate there is; a cell of 8 and
+    // -8 gradients gives its largest value
+    Spread spread[3] = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+    for (uint32_t x = 0; x < 256u << 16; x += ROW) {
+        noiseRow1(row, ROW, x, 1);
+        measure(spread[0], row, ROW);
+    }
+    for (uint32_t y = 0; y < ROWS; y++) {
+        noiseRow1(row, ROW, y * 777777, DX);
+        measure(spread[0], row, ROW);
+        noiseRow2(row, ROW, 12345, DX, y * 23456);
+        measure(spread[1], row, ROW);
+        noiseRow3(row, ROW, 12345, DX, y * 23456, y * 9999 + 5000);
+        measure(spread[2], row, ROW);
+    }
+    for (int d = 0; d < 3; d++) {
+        CHECK(spread[d].low < -24000);
+        CHECK(spread[d].high > 24000);
+        CHECK(spread[d].step < 5000);
+        CHECK_EQ(spread[d].clamped, 0);
+        printf("%dD: %6d to %5d, largest step %4d at %u a pixel\n",
+               d + 1, spread[d].low, spread[d].high, spread[d].step, DX);
+    }
+
+    // Throughput, a 300 pixel row a frame
+    srand(1);
+    for (int i = 0; i < 256; i++) perm[i] = perm[i + 256] = rand() & 255;
+    struct {
+        const char* name;
+        int frames;
+        void (*draw)(int16_t*, uint32_t);
+    } cases[] = {
+        { "noiseRow1",        FRAMES,      [](int16_t* r, uint32_t f) { noiseRow1(r, PIXELS, f * 1000, DX); } },
+        { "noiseRow2",        FRAMES,      [](int16_t* r, uint32_t f) { noiseRow2(r, PIXELS, 0, DX, f * 1000); } },
+        { "noiseRow3",        FRAMES,      [](int16_t* r, uint32_t f) { noiseRow3(r, PIXELS, 0, DX, f * 1000, f * 500); } },
+        { "noise3 per pixel", FRAMES / 10, [](int16_t* r, uint32_t f) {
+            for (int i = 0; i < PIXELS; i++) r[i] = noise3(i * DX, f * 1000, f * 500);
+        } },
+        { "float Perlin 3D",  FRAMES / 10, [](int16_t* r, uint32_t f) {
+            for (int i = 0; i < PIXELS; i++) r[i] = perlin(i * DX / 65536.0, f * 1000 / 65536.0, f * 500 / 65536.0) * 32767;
+        } },
+    };
+    for (auto& c : cases) {
+        double begin = hostMicros();
+        for (int f = 0; f < c.frames; f++) {
+            c.draw(row, f);
+            benchSink += row[f % PIXELS];
+        }
+        printf("%-17s %8.0f pixels a ms\n", c.name, (double)PIXELS * c.frames * 1000 / (hostMicros() - begin));
+    }
+
+    return testResult("noise");
+}
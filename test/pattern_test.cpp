@@ -0,0 +1,167 @@
+// Pattern VM: programs are checked on load and rejected at the faulty byte,
+// the rainbow and the Christmas crawl as patterns draw exactly what the
+// hand-written themes do, arithmetic edge cases wrap instead of overflowing,
+// every PatternState keeps its own registers, and the VM's cost per pixel
+// against the hand-written themes.
+
+#include "host_test.h"
+#include "pattern.h"
+#include "layers.h"
+#include <Adafruit_NeoPixel.h>
+#include <vector>
+
+#define PIXELS  300
+#define FRAMES  2000
+
+enum {
+    P8 = PATTERN_PUSH8, P16 = PATTERN_PUSH16, P24 = PATTERN_PUSH24, TIME = PATTERN_TIME,
+    INDEX = PATTERN_INDEX, COUNT = PATTERN_COUNT, LD = PATTERN_LOAD, ST = PATTERN_STORE,
+    ADD = PATTERN_ADD, SUB = PATTERN_SUB, MUL = PATTERN_MUL, DIV = PATTERN_DIV, MOD = PATTERN_MOD,
+    SHL = PATTERN_SHL, LT = PATTERN_LT, SEL = PATTERN_SELECT, HSV = PATTERN_HSV,
+};
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes program(const Bytes& frame, const Bytes& pixel) {
+    Bytes p = { 'P', 'V', 1, 0, (uint8_t)frame.size(), (uint8_t)pixel.size() };
+    p.insert(p.end(), frame.begin(), frame.end());
+    p.insert(p.end(), pixel.begin(), pixel.end());
+    return p;
+}
+
+// The themes as main.cpp draws them
+static void drawAlt(Layer& layer, uint32_t color1, uint32_t color2, uint16_t groupSize, uint32_t offset) {
+    uint16_t currentGroupSize = offset % (2 * groupSize);
+    bool colorSelected = false;
+    if (currentGroupSize >= groupSize) {
+        colorSelected = !colorSelected;
+        currentGroupSize -= groupSize;
+    }
+    for (int i = 0; i < layer.numPixels(); i++) {
+        if (currentGroupSize >= groupSize) {
+            colorSelected = !colorSelected;
+            currentGroupSize = 0;
+        }
+        layer.setPixelColor(i, colorSelected ? color2 : color1);
+        currentGroupSize += 1;
+    }
+}
+
+static void drawRainbow(Layer& layer, uint16_t firstHue) {
+    for (int i = 0; i < layer.numPixels(); i++) {
+        layer.setPixelColor(i, Adafruit_NeoPixel::ColorHSV(firstHue + (i * 65536L / layer.numPixels())));
+    }
+}
+
+// Value left by pixel code run once on a fresh pattern
+static int32_t evaluate(const Bytes& pixel) {
+    Pattern p;
+    Bytes code = program({}, pixel);
+    CHECK_EQ(p.load(code.data(), code.size()), PATTERN_OK);
+    p.beginFrame(0, 1);
+    return (int32_t)p.pixel(0);
+}
+
+int main() {
+    // Rejected at the byte at fault; the program loaded before is kept
+    struct { Bytes code; PatternError error; size_t offset; } bad[] = {
+        { program({}, { 99 }),            PATTERN_BAD_OPCODE,   6 },
+        { program({ ADD }, { P8, 1 }),    PATTERN_UNDERFLOW,    6 },
+        { program({}, { P8, 1, P8, 2 }),  PATTERN_BAD_RESULT,  10 },
+        { program({}, { P16, 1 }),        PATTERN_TRUNCATED,    6 },
+        { program({}, { LD, 9 }),         PATTERN_BAD_REGISTER, 6 },
+        { { 'P', 'V', 2, 0, 0, 0 },       PATTERN_BAD_HEADER,   0 },
+    };
+    Pattern kept;
+    Bytes one = program({}, { P8, 1 });
+    CHECK_EQ(kept.load(one.data(), one.size()), PATTERN_OK);
+    for (auto& b : bad) {
+        CHECK_EQ(kept.load(b.code.data(), b.code.size()), b.error);
+        CHECK_EQ(kept.errorOffset(), b.offset);
+    }
+    CHECK(kept.valid());
+
+    // Rainbow: hue = time * 4 + index * 65536 / count
+    Bytes rainbowCode = program({ TIME, P8, 2, SHL, ST, 0 },
+                                { INDEX, P24, 1, 0, 0, MUL, COUNT, DIV, LD, 0, ADD, P8, 255, P8, 255, HSV });
+    // Christmas crawl: red and green in groups of 6, a step every 500 ms
+    Bytes crawlCode = program({ TIME, P16, 0xF4, 0x01, DIV, ST, 0 },
+                              { INDEX, LD, 0, ADD, P8, 12, MOD, P8, 6, LT, P24, 255, 0, 0, P24, 0, 255, 0, SEL });
+    Pattern rainbow, crawl;
+    CHECK_EQ(rainbow.load(rainbowCode.data(), rainbowCode.size()), PATTERN_OK);
+    CHECK_EQ(crawl.load(crawlCode.data(), crawlCode.size()), PATTERN_OK);
+    CHECK(rainbow.animated());
+
+    LayerStack layers;
+    CHECK(layers.begin(PIXELS, 2));
+    Layer& vm = layers[0];
+    Layer& hand = layers[1];
+    int different = 0;
+    for (uint32_t ms : { 0u, 1000u, 123456u, 16383u }) {
+        rainbow.render(vm, ms);
+        drawRainbow(hand, ms << 2);
+        for (int i = 0; i < PIXELS; i++) different += vm.getPixelColor(i) != hand.getPixelColor(i);
+        crawl.render(vm, ms);
+        drawAlt(hand, 0xFF0000, 0x00FF00, 6, ms / 500);
+        for (int i = 0; i < PIXELS; i++) different += vm.getPixelColor(i) != hand.getPixelColor(i);
+    }
+    CHECK_EQ(different, 0);
+
+    // Overflow wraps; INT32_MIN / -1 is INT32_MIN and its remainder 0
+    Bytes intMin = { P8, 1, P8, 31, SHL };
+    Bytes minusOne = { P8, 0, P8, 1, SUB };
+    Bytes sum = intMin;
+    sum.insert(sum.end(), minusOne.begin(), minusOne.end());
+    sum.push_back(ADD);
+    CHECK_EQ(evaluate(sum), 0xFFFFFF);                  // INT32_MAX, as a color
+    Bytes quotient = intMin;
+    quotient.insert(quotient.end(), minusOne.begin(), minusOne.end());
+    quotient.push_back(DIV);
+    CHECK_EQ(evaluate(quotient), 0);                    // INT32_MIN & 0xFFFFFF
+    Bytes remainder = intMin;
+    remainder.insert(remainder.end(), minusOne.begin(), minusOne.end());
+    remainder.push_back(MOD);
+    CHECK_EQ(evaluate(remainder), 0);
+    CHECK_EQ(evaluate({ P8, 7, P8, 0, DIV }), 0);
+    CHECK_EQ(evaluate({ P8, 0, P8, 7, SUB, P8, 3, MOD }), 2);   // -7 mod 3
+
+    // A frame counter: every state counts its own frames, and a new load
+    // starts them all over
+    Bytes counterCode = program({ LD, 0, P8, 1, ADD, ST, 0 }, { LD, 0 });
+    Pattern counter;
+    CHECK_EQ(counter.load(counterCode.data(), counterCode.size()), PATTERN_OK);
+    PatternState a = {}, b = {};
+    for (int f = 0; f < 5; f++) {
+        counter.beginFrame(a, 0, 1);
+        if (f % 2) counter.beginFrame(b, 0, 1);
+    }
+    counter.beginFrame(0, 1);
+    CHECK_EQ(counter.pixel(a, 0), 5);
+    CHECK_EQ(counter.pixel(b, 0), 2);
+    CHECK_EQ(counter.pixel(0), 1);
+    CHECK_EQ(counter.load(counterCode.data(), counterCode.size()), PATTERN_OK);
+    counter.beginFrame(a, 0, 1);
+    CHECK_EQ(counter.pixel(a, 0), 1);
+
+    // Cost per pixel, VM against hand-written
+    struct {
+        const char* name;
+        void (*draw)(Layer&, Pattern&, uint32_t);
+        Pattern* pattern;
+    } cases[] = {
+        { "rainbow hand-written", [](Layer& l, Pattern&, uint32_t ms) { drawRainbow(l, ms << 2); }, &rainbow },
+        { "rainbow pattern",      [](Layer& l, Pattern& p, uint32_t ms) { p.render(l, ms); }, &rainbow },
+        { "crawl hand-written",   [](Layer& l, Pattern&, uint32_t ms) { drawAlt(l, 0xFF0000, 0x00FF00, 6, ms / 500); }, &crawl },
+        { "crawl pattern",        [](Layer& l, Pattern& p, uint32_t ms) { p.render(l, ms); }, &crawl },
+    };
+    for (auto& c : cases) {
+        double begin = hostMicros();
+        for (int f = 0; f < FRAMES; f++) {
+            c.draw(vm, *c.pattern, f * 20);
+            benchSink += vm.getPixelColor(f % PIXELS);
+        }
+        printf("%-22s %6.1f ns a pixel\n", c.name, (hostMicros() - begin) * 1000 / FRAMES / PIXELS);
+    }
+
+    return testResult("pattern");
+}
@@ -0,0 +1,101 @@
+// Power estimate: the strip's running level against a rescan through random
+// writes, the estimate against adding up every channel's draw, the limit
+// holding white frames to the budget while dim ones go out untouched, and
+// what keeping the level costs against rescanning each frame.
+
+#include "host_test.h"
+#include "fast_strip.h"
+#include "power.h"
+#include <stdlib.h>
+
+#define PIXELS  300
+#define BUDGET  5000
+#define FRAMES  10000
+
+typedef FastStrip<NEO_GRB + NEO_KHZ800> Strip;
+
+static uint32_t rescan(Strip& strip) {
+    uint32_t level = 0;
+    for (size_t i = 0; i < strip.numPixels() * 3; i++) level += strip.getPixels()[i];
+    return level;
+}
+
+// Each channel's share of LED_CHANNEL_MA, added up pixel by pixel
+static double channelMa(Strip& strip, uint16_t scale) {
+    double ma = 0;
+    for (size_t i = 0; i < strip.numPixels() * 3; i++) {
+        ma += strip.getPixels()[i] * scale / 256.0 * LED_CHANNEL_MA / 255;
+    }
+    return ma + strip.numPixels() * LED_IDLE_MA;
+}
+
+int main() {
+    Strip strip(PIXELS, 13);
+    srand(1);
+    int checked = 0;
+    for (int k = 0; k < 100000; k++) {
+        uint16_t n = rand() % (PIXELS + 10);
+        uint32_t c = rand() * 7919u;
+        switch (rand() % 5) {
+            case 0: strip.setPixelColor(n, c); break;
+            case 1: strip.setPixelColor(n, c, c >> 8, c >> 16); break;
+            case 2: strip.fill(c, n, rand() % 20); break;
+            case 3: if (k % 1000 == 0) strip.setBrightness(rand()); break;
+            default: if (k % 5000 == 0) strip.clear(); break;
+        }
+        if (k % 97 == 0) {
+            CHECK_EQ(strip.level(), rescan(strip));
+            checked++;
+        }
+    }
+    printf("running level matched a rescan %d times through 100000 random writes\n", checked);
+
+    // The estimate is one multiply of the level; it should be within a mA of
+    // the per-channel sum
+    PowerBudget power(PIXELS, BUDGET);
+    strip.setBrightness(255);      // Full brightness
+    for (uint16_t scale : { 256, 200, 50 }) {
+        double exact = channelMa(strip, scale);
+        uint32_t estimate = power.estimate(strip.level(), scale);
+        CHECK(estimate <= exact + 1 && estimate + 1 >= exact);
+    }
+
+    // Full white is held to the budget, a dim scene is not touched
+    strip.fill(0xFFFFFF);
+    uint32_t white = power.estimate(strip.level(), 256);
+    uint16_t scale = power.limit(strip.level(), 256);
+    CHECK(scale < 256);
+    CHECK(power.lastMa <= BUDGET);
+    CHECK(power.lastMa > BUDGET * 9 / 10);
+    CHECK_EQ(power.limitedFrames, 1);
+    printf("full white: %u mA, sent at scale %u for %u mA\n", white, scale, power.lastMa);
+
+    strip.fill(0x101010);
+    CHECK_EQ(power.limit(strip.level(), 256), 256);
+    CHECK_EQ(power.limitedFrames, 1);
+
+    // Keeping the level as pixels are written, against rescanning every frame
+    Adafruit_NeoPixel plain(PIXELS, 13, NEO_GRB + NEO_KHZ800);
+    double begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        for (uint16_t i = 0; i < PIXELS; i++) plain.setPixelColor(i, (uint32_t)(i * f));
+        benchSink += plain.getPixels()[f % PIXELS];
+    }
+    double untrackedUs = (hostMicros() - begin) / FRAMES;
+    begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        for (uint16_t i = 0; i < PIXELS; i++) strip.setPixelColor(i, (uint32_t)(i * f));
+        benchSink += power.limit(strip.level(), 256);
+    }
+    double trackedUs = (hostMicros() - begin) / FRAMES;
+    begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        strip.invalidateLevel();
+        benchSink += power.limit(strip.level(), 256);
+    }
+    double rescanUs = (hostMicros() - begin) / FRAMES;
+    printf("300 px frame: drawn %.2f us untracked, %.2f us tracked and limited; rescan %.2f us\n",
+           untrackedUs, trackedUs, rescanUs);
+
+    return testResult("power");
+}
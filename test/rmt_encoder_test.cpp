@@ -0,0 +1,104 @@
+// RMT encoder against a reference bitstream: every symbol must be the pulse
+// for the matching bit, MSB first, within the WS2812B datasheet timing, and
+// the lookup table must beat encoding one bit at a time.
+
+#include "host_test.h"
+#include "rmt_encoder.h"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#define FRAMES  1000
+
+// Bits of the bytes as '0'/'1', MSB first, as the LEDs must receive them
+static std::string referenceBits(const uint8_t* src, size_t count) {
+    std::string bits;
+    for (size_t i = 0; i < count; i++) {
+        for (int bit = 7; bit >= 0; bit--) bits += (src[i] >> bit) & 1 ? '1' : '0';
+    }
+    return bits;
+}
+
+// Read the symbols back as bits, '?' for a pulse that is neither
+static std::string decodeBits(const uint32_t* symbols, size_t count, const RmtTiming& t) {
+    std::string bits;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t s = symbols[i];
+        uint16_t high = s & 0x7FFF, low = (s >> 16) & 0x7FFF;
+        bool levels = (s >> 15 & 1) == 1 && (s >> 31 & 1) == 0;
+        if (levels && high == t.t1h && low == t.t1l) bits += '1';
+        else if (levels && high == t.t0h && low == t.t0l) bits += '0';
+        else bits += '?';
+    }
+    return bits;
+}
+
+// Encoding one bit at a time, as a plain loop would
+static void encodeBitwise(const RmtTiming& t, const uint8_t* src, size_t count, uint32_t* dst) {
+    uint32_t zero = rmtSymbol(t.t0h, t.t0l);
+    uint32_t one  = rmtSymbol(t.t1h, t.t1l);
+    for (size_t i = 0; i < count; i++) {
+        for (uint8_t mask = 0x80; mask; mask >>= 1) *dst++ = src[i] & mask ? one : zero;
+    }
+}
+
+static bool within(uint16_t ticks, int ns, int tolerance) {
+    int actual = ticks * RMT_TICK_NS;
+    return actual >= ns - tolerance && actual <= ns + tolerance;
+}
+
+int main() {
+    // Datasheet timing, +-150 ns, at 800 kHz; 400 kHz symbols add up to 2.5 us
+    CHECK(within(timing800KHz.t0h, 400, 150));
+    CHECK(within(timing800KHz.t0l, 850, 150));
+    CHECK(within(timing800KHz.t1h, 800, 150));
+    CHECK(within(timing800KHz.t1l, 450, 150));
+    CHECK_EQ((timing800KHz.t0h + timing800KHz.t0l) * RMT_TICK_NS, 1250);
+    CHECK_EQ((timing800KHz.t1h + timing800KHz.t1l) * RMT_TICK_NS, 1250);
+    CHECK_EQ((timing400KHz.t0h + timing400KHz.t0l) * RMT_TICK_NS, 2500);
+    CHECK_EQ((timing400KHz.t1h + timing400KHz.t1l) * RMT_TICK_NS, 2500);
+
+    // rmt_item32_t layout: duration0:15, level0:1, duration1:15, level1:1
+    CHECK_EQ(rmtSymbol(32, 18), 0x00128020);
+    CHECK_EQ(rmtSymbol(16, 34), 0x00228010);
+
+    RmtEncoder encoder;
+    uint32_t symbols[8];
+    uint8_t a5 = 0xA5;
+    encoder.encode(&a5, 1, symbols);
+    CHECK(decodeBits(symbols, 8, timing800KHz) == "10100101");
+
+    // Every byte value, then a random 300 pixel frame, in both timings
+    std::vector<uint8_t> bytes(256 + 900);
+    for (int i = 0; i < 256; i++) bytes[i] = i;
+    srand(1);
+    for (size_t i = 256; i < bytes.size(); i++) bytes[i] = rand();
+    std::vector<uint32_t> encoded(bytes.size() * 8), bitwise(bytes.size() * 8);
+    for (const RmtTiming* t : { &timing800KHz, &timing400KHz }) {
+        encoder.setTiming(*t);
+        encoder.encode(bytes.data(), bytes.size(), encoded.data());
+        CHECK(decodeBits(encoded.data(), encoded.size(), *t) == referenceBits(bytes.data(), bytes.size()));
+        encodeBitwise(*t, bytes.data(), bytes.size(), bitwise.data());
+        CHECK(encoded == bitwise);
+    }
+
+    // Encode cost of a 300 pixel frame, which takes 9 ms to clock out
+    encoder.setTiming(timing800KHz);
+    const uint8_t* frame = bytes.data() + 256;
+    double begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        encoder.encode(frame, 900, encoded.data());
+        benchSink += encoded[f % 900];
+    }
+    double tableUs = (hostMicros() - begin) / FRAMES;
+    begin = hostMicros();
+    for (int f = 0; f < FRAMES; f++) {
+        encodeBitwise(timing800KHz, frame, 900, bitwise.data());
+        benchSink += bitwise[f % 900];
+    }
+    double bitwiseUs = (hostMicros() - begin) / FRAMES;
+    printf("300 px frame: table %.2f us, bit at a time %.2f us, on the wire %.0f us\n",
+           tableUs, bitwiseUs, 900 * 8 * 1.25);
+
+    return testResult("rmt_encoder");
+}
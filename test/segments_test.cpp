@@ -0,0 +1,73 @@
+// Segments: parsing runs and lists, including single runs longer than the
+// index list, malformed definitions leaving the current segments in place,
+// lookup by name, and drawing through a SegmentCanvas.
+
+#include "host_test.h"
+#include "segments.h"
+#include "layers.h"
+#include <string.h>
+
+#define PIXELS  300
+
+static uint16_t pixelOf(SegmentMap& map, const char* name, uint16_t i) {
+    Segment* segment = map.find(name, strlen(name));
+    return segment ? map.pixel(*segment, i) : 0xFFFF;
+}
+
+int main() {
+    SegmentMap map;
+    CHECK(map.parse("marquee=0-19;panel=24-29;coin=20,22", PIXELS));
+    CHECK_EQ(map.count(), 3);
+    Segment* coin = map.find("coin", 4);
+    CHECK(coin != NULL);
+    CHECK(coin->listed);
+    CHECK_EQ(coin->count, 2);
+    CHECK_EQ(pixelOf(map, "coin", 1), 22);
+    CHECK_EQ(pixelOf(map, "panel", 0), 24);
+    CHECK(!map.find("pane", 4));
+    CHECK(!map[0].listed);
+
+    // A single run is a range whatever its length; lists share SEGMENT_INDICES
+    CHECK(map.parse("marquee=0-299", PIXELS));
+    CHECK_EQ(map.find("marquee", 7)->count, 300);
+    CHECK_EQ(pixelOf(map, "marquee", 299), 299);
+    CHECK(map.parse("a=0-299;b=0-199,200-255", PIXELS));
+    CHECK(!map.parse("a=0-199,200-256", PIXELS));           // 257 listed
+    CHECK(!map.parse("a=0-127,130;b=0-127,140", PIXELS));   // 258 listed over both
+
+    // Malformed: the segments before stay
+    CHECK(map.parse("left=0-9;right=10-19", PIXELS));
+    const char* bad[] = {
+        "a=1,", "a=,1", "a=1,,2", "a=", "=1", "a=1;a=2", "a=5-3", "a=300",
+        "a=1-", "a=x", "a b=1", "a=1;b=2;c=3;d=4;e=5;f=6;g=7;h=8;i=9",
+        "a_name_too_long_x=1",
+    };
+    for (const char* text : bad) {
+        if (map.parse(text, PIXELS)) printf("accepted: %s\n", text);
+        CHECK(map.find("right", 5) != NULL);
+    }
+    CHECK_EQ(map.count(), 2);
+
+    // Drawing through a segment dims and maps its pixels
+    CHECK(map.parse("marquee=10-12;coin=20,22,24", PIXELS));
+    LayerStack layers;
+    CHECK(layers.begin(30, 1));
+    Segment& marquee = *map.find("marquee", 7);
+    Segment& coins = *map.find("coin", 4);
+    coins.level = 128;
+    SegmentCanvas<Layer> marqueeView(layers[0], map, marquee);
+    SegmentCanvas<Layer> coinView(layers[0], map, coins);
+    CHECK_EQ(coinView.numPixels(), 3);
+    marqueeView.fill(0xFF0000);
+    coinView.fill(0xFFFFFF, 1);
+    coinView.setPixelColor(3, 0xFFFFFF);        // Past the segment, ignored
+    CHECK_EQ(layers[0].getPixelColor(9), 0);
+    CHECK_EQ(layers[0].getPixelColor(12), 0xFF0000);
+    CHECK_EQ(layers[0].getPixelColor(13), 0);
+    CHECK_EQ(layers[0].getPixelColor(20), 0);
+    CHECK_EQ(layers[0].getPixelColor(22), 0x7F7F7F);
+    CHECK_EQ(layers[0].getPixelColor(24), 0x7F7F7F);
+    CHECK_EQ(layers[0].getPixelColor(26), 0);
+
+    return testResult("segments");
+}
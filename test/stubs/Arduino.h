@@ -0,0 +1,77 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the lighting code on a PC. Time
+// is the host's, serial ports are file descriptors (e.g. a pty).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <FreeRTOS.h>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_byte(a)    (*(const uint8_t*)(a))
+#define pgm_read_word(a)    (*(const uint16_t*)(a))
+#define pgm_read_dword(a)   (*(const uint32_t*)(a))
+#define HIGH                1
+#define LOW                 0
+#define INPUT               0
+#define OUTPUT              1
+#define F_CPU               240000000L
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define _BV(b)              (1UL << (b))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void noInterrupts();
+void interrupts();
+
+class Stream {
+public:
+    Stream() : fd(-1), timeout(1000) {}
+    virtual ~Stream() {}
+
+    virtual int available();
+    virtual int read();
+    size_t readBytes(uint8_t* buffer, size_t length);
+    size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+    void setTimeout(unsigned long ms) { timeout = ms; }
+
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t println(const char* s = "") { return print(s) + print("\r\n"); }
+    size_t printf(const char* format, ...);
+
+protected:
+    int           fd;
+    unsigned long timeout;
+};
+
+// A serial port on an open file descriptor
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial(int fd = -1) { this->fd = fd; }
+    void begin(unsigned long baud) {}
+    size_t setRxBufferSize(size_t size) { return size; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
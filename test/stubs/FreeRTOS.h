@@ -0,0 +1,35 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// FreeRTOS mutexes and task notifications over host threads. Tasks are
+// plain handles here: notifying one counts, and ulTaskNotifyTake() on a
+// handle waits for the count.
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+struct HostTask;
+struct HostMutex;
+typedef HostTask*  TaskHandle_t;
+typedef HostMutex* SemaphoreHandle_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define portMAX_DELAY       0xFFFFFFFF
+#define portTICK_PERIOD_MS  1
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+// A task handle for the calling test thread
+TaskHandle_t hostTaskCreate();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// WiFiClient as a TCP socket, so network code can talk to scripted servers
+// on the host
+
+#include <Arduino.h>
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient() {}
+    WiFiClient(int socket) { fd = socket; }
+
+    int connect(const char* host, uint16_t port);
+    uint8_t connected();
+    operator bool() { return fd >= 0; }
+    int available();
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    size_t write(const uint8_t* buffer, size_t size);
+    using Stream::write;
+    int setNoDelay(bool noDelay);
+    void stop();
+};
+
+#endif
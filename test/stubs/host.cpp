@@ -0,0 +1,193 @@
+// Host implementations of the Arduino, FreeRTOS, WiFi and ESP-IDF pieces
+// declared in this directory
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Time ---------------------------------------------------------------------
+
+static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis() { return esp_timer_get_time() / 1000; }
+unsigned long micros() { return esp_timer_get_time(); }
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+void noInterrupts() {}
+void interrupts() {}
+
+// Adafruit_NeoPixel::show() on ESP32; nothing to clock out on a PC
+extern "C" void espShow(uint8_t pin, uint8_t* pixels, uint32_t numBytes, bool is800KHz) {}
+
+// Streams --------------------------------------------------------------------
+
+HardwareSerial Serial(STDOUT_FILENO);
+
+int Stream::available() {
+    int n = 0;
+    if (fd < 0 || ioctl(fd, FIONREAD, &n) < 0) return 0;
+    return n;
+}
+
+int Stream::read() {
+    uint8_t c;
+    if (available() <= 0 || ::read(fd, &c, 1) != 1) return -1;
+    return c;
+}
+
+// Like Arduino's: waits up to the timeout for the bytes to arrive
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t n = 0;
+    unsigned long begin = millis();
+    while (n < length && fd >= 0) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        int wait = timeout - (millis() - begin);
+        if (wait <= 0 || poll(&p, 1, wait) <= 0) break;
+        ssize_t got = ::read(fd, buffer + n, length - n);
+        if (got <= 0) break;
+        n += got;
+    }
+    return n;
+}
+
+size_t Stream::write(const uint8_t* buffer, size_t size) {
+    if (fd < 0) return 0;
+    ssize_t n = ::write(fd, buffer, size);
+    return n < 0 ? 0 : n;
+}
+
+size_t Stream::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return write((const uint8_t*)buffer, min(n, (int)sizeof(buffer) - 1));
+}
+
+// WiFiClient -----------------------------------------------------------------
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    stop();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &found) != 0) return 0;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && ::connect(fd, found->ai_addr, found->ai_addrlen) < 0) stop();
+    freeaddrinfo(found);
+    return fd >= 0;
+}
+
+uint8_t WiFiClient::connected() {
+    if (fd < 0) return 0;
+    if (Stream::available() > 0) return 1;
+    char c;
+    ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) return 0;
+    return 1;
+}
+
+int WiFiClient::available() { return Stream::available(); }
+int WiFiClient::read() { return Stream::read(); }
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (fd < 0) return -1;
+    ssize_t n = recv(fd, buffer, size, MSG_DONTWAIT);
+    return n < 0 ? -1 : n;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (fd < 0) return 0;
+    ssize_t n = send(fd, buffer, size, MSG_NOSIGNAL);
+    return n < 0 ? 0 : n;
+}
+
+int WiFiClient::setNoDelay(bool noDelay) {
+    int on = noDelay;
+    return fd >= 0 && setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) == 0;
+}
+
+void WiFiClient::stop() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+// FreeRTOS -------------------------------------------------------------------
+
+struct HostMutex {
+    std::timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostMutex; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
+
+struct HostTask {
+    std::mutex              mutex;
+    std::condition_variable wake;
+    uint32_t                count = 0;
+};
+
+static thread_local HostTask* currentTask = NULL;
+
+TaskHandle_t hostTaskCreate() {
+    currentTask = new HostTask;
+    return currentTask;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTask; }
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> hold(task->mutex);
+    task->count++;
+    task->wake.notify_all();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    HostTask* task = currentTask;
+    if (!task) return 0;
+    std::unique_lock<std::mutex> hold(task->mutex);
+    auto ready = [task] { return task->count > 0; };
+    if (ticks == portMAX_DELAY) task->wake.wait(hold, ready);
+    else task->wake.wait_for(hold, std::chrono::milliseconds(ticks), ready);
+    uint32_t count = task->count;
+    if (count) task->count = clear ? 0 : count - 1;
+    return count;
+}
@@ -0,0 +1,110 @@
+// Topology: parsing strip lists, laying strips out in the logical strip and
+// the arena, each strip showing its logical pixels in its own color order,
+// mirrored pixels counted once per strip for the power estimate, and render
+// and encode cost at 1k, 4k and 8k logical pixels.
+
+#include "host_test.h"
+#include "topology.h"
+#include "fast_strip.h"
+
+#define FRAMES      200
+#define NS_PER_BIT  1250
+#define RESET_US    300
+
+int main() {
+    StripConfig strips[TOPOLOGY_MAX_STRIPS];
+
+    CHECK_EQ(parseTopology("13:300:GRB,14:300:rgbw@10,2:5", strips, TOPOLOGY_MAX_STRIPS), 3);
+    CHECK_EQ(strips[0].pin, 13);
+    CHECK_EQ(strips[0].offset, 0);
+    CHECK_EQ(strips[1].type, NEO_RGBW);
+    CHECK_EQ(strips[1].offset, 10);
+    CHECK_EQ(strips[2].offset, 310);        // Continues after the previous strip
+    CHECK_EQ(strips[2].type, NEO_GRB);
+    CHECK_EQ(parseTopology("13:", strips, TOPOLOGY_MAX_STRIPS), 0);
+    CHECK_EQ(parseTopology("13:10:XYZ", strips, TOPOLOGY_MAX_STRIPS), 0);
+    CHECK_EQ(parseTopology("13:10@8190", strips, TOPOLOGY_MAX_STRIPS), 0);
+    CHECK_EQ(parseTopology("1:1,2:1,3:1", strips, 2), 0);
+
+    // A GRB strip, an RGB one mirroring its first pixels, and an RGBW one
+    uint8_t count = parseTopology("13:4:GRB,14:2:RGB@0,15:2:RGBW@4", strips, TOPOLOGY_MAX_STRIPS);
+    CHECK_EQ(count, 3);
+    Topology topology;
+    CHECK(topology.begin(strips, count, false, true));
+    CHECK_EQ(topology.numPixels(), 6);
+    CHECK_EQ(topology.physicalPixels(), 8);
+    CHECK_EQ(topology.frameBytes(0), 12);
+    CHECK_EQ(topology.frameBytes(1), 6);
+    CHECK_EQ(topology.frameBytes(2), 8);
+    CHECK_EQ(topology.arenaBytes(), 6 * 3 + 26 * 3);        // Logical, frames, two transmit frames
+    CHECK(topology.transmitBuffer(2) + 2 * 8 == topology.logical() + topology.arenaBytes());
+
+    FastStrip<NEO_GRB + NEO_KHZ800> strip(0, 0);
+    strip.adopt(topology.logical(), topology.numPixels());
+    for (uint16_t i = 0; i < strip.numPixels(); i++) strip.setPixelColor(i, 10 * i + 1, 10 * i + 2, 10 * i + 3);
+    for (uint8_t i = 0; i < count; i++) {
+        topology.lut(i).setGamma(1.0f);
+        CHECK(!topology.encode(i, 256));
+    }
+    const uint8_t grb[] = { 2, 1, 3, 12, 11, 13, 22, 21, 23, 32, 31, 33 };
+    const uint8_t rgb[] = { 1, 2, 3, 11, 12, 13 };
+    const uint8_t rgbw[] = { 41, 42, 43, 0, 51, 52, 53, 0 };
+    CHECK(memcmp(topology.frame(0), grb, sizeof(grb)) == 0);
+    CHECK(memcmp(topology.frame(1), rgb, sizeof(rgb)) == 0);
+    CHECK(memcmp(topology.frame(2), rgbw, sizeof(rgbw)) == 0);
+
+    // The power level counts the mirrored pixels 0 and 1 twice; without
+    // overlapping strips it is the logical strip's as it is
+    CHECK_EQ(strip.level(), 6 + 36 + 66 + 96 + 126 + 156);
+    CHECK_EQ(topology.level(strip.level()), strip.level() + 6 + 36);
+    IndexedFrame palette;
+    Topology indexed;
+    CHECK(indexed.begin(strips, count, false, false, &palette));
+    palette.fill(0x102030);
+    palette.fill(0xFF0000, 1, 1);
+    CHECK_EQ(indexed.level(palette.level()), 8 * 0x60 + 2 * (0xFF - 0x60));
+    StripConfig plain[2];
+    CHECK_EQ(parseTopology("13:4,14:2", plain, 2), 2);
+    Topology side;
+    CHECK(side.begin(plain, 2, false, false));
+    CHECK_EQ(side.level(1234), 1234);
+
+    // Render a rainbow into the logical strip, then encode every strip. The
+    // strips go out in parallel, so the wire time is the longest strip's.
+    const char* layouts[] = {
+        "13:1000",
+        "13:500,14:500,15:500,16:500,17:500,18:500,19:500,21:500",
+        "13:1024,14:1024,15:1024,16:1024,17:1024,18:1024,19:1024,21:1024",
+    };
+    printf("%6s %6s %6s %9s %10s %10s %9s\n", "pixels", "strips", "dither", "arena B", "render us", "encode us", "wire ms");
+    for (const char* layout : layouts) {
+        for (bool dither : { false, true }) {
+            count = parseTopology(layout, strips, TOPOLOGY_MAX_STRIPS);
+            Topology t;
+            CHECK(t.begin(strips, count, dither, true));
+            FastStrip<NEO_GRB + NEO_KHZ800> logical(0, 0);
+            logical.adopt(t.logical(), t.numPixels());
+
+            double begin = hostMicros();
+            for (int f = 0; f < FRAMES; f++) {
+                for (uint16_t i = 0; i < logical.numPixels(); i++) {
+                    logical.setPixelColor(i, Adafruit_NeoPixel::ColorHSV(i * 64 + f * 256));
+                }
+            }
+            double renderUs = (hostMicros() - begin) / FRAMES;
+            begin = hostMicros();
+            for (int f = 0; f < FRAMES; f++) {
+                for (uint8_t i = 0; i < t.count(); i++) t.encode(i, 200);
+            }
+            double encodeUs = (hostMicros() - begin) / FRAMES;
+            benchSink += t.frame(0)[0];
+
+            uint16_t longest = 0;
+            for (uint8_t i = 0; i < count; i++) longest = max(longest, strips[i].length);
+            printf("%6u %6u %6s %9zu %10.1f %10.1f %9.2f\n", t.numPixels(), count, dither ? "yes" : "no",
+                   t.arenaBytes(), renderUs, encodeUs, (longest * 24.0 * NS_PER_BIT / 1000 + RESET_US) / 1000);
+        }
+    }
+
+    return testResult("topology");
+}
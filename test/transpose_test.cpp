@@ -0,0 +1,123 @@
+// Bit-plane transpose against a bit at a time reference, with full, short
+// and missing lanes, and its cost against a byte at a time through
+// transpose8 and against the frame time it saves: lanes sent in parallel
+// take as long as the longest strip, not the sum.
+
+#include "host_test.h"
+#include "transpose.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FRAMES      1000
+#define NS_PER_BIT  1250
+
+// One bit at a time: bit k of slot b of byte i is lane k's bit 7 - b
+static void transposeBitwise(const uint8_t* const lanes[PARALLEL_LANES],
+                             const size_t lengths[PARALLEL_LANES], size_t count, uint8_t* out) {
+    memset(out, 0, count * 8);
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < PARALLEL_LANES; k++) {
+            if (!lanes[k] || i >= lengths[k]) continue;
+            for (int b = 0; b < 8; b++) out[i * 8 + b] |= ((lanes[k][i] >> (7 - b)) & 1) << k;
+        }
+    }
+}
+
+// A byte at a time through transpose8, zeros for lanes that have run out
+static void transposeBytewise(const uint8_t* const lanes[PARALLEL_LANES],
+                              const size_t lengths[PARALLEL_LANES], size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t in[8];
+        for (int k = 0; k < PARALLEL_LANES; k++) in[k] = (lanes[k] && i < lengths[k]) ? lanes[k][i] : 0;
+        transpose8(in, out + i * 8);
+    }
+}
+
+struct Lanes {
+    std::vector<uint8_t> bytes[PARALLEL_LANES];
+    const uint8_t* lanes[PARALLEL_LANES];
+    size_t lengths[PARALLEL_LANES];
+    size_t longest;
+
+    // Pixels per lane, 0 for none
+    Lanes(const int* pixels) : longest(0) {
+        for (int k = 0; k < PARALLEL_LANES; k++) {
+            bytes[k].resize(pixels[k] * 3);
+            for (auto& b : bytes[k]) b = rand();
+            lanes[k] = pixels[k] ? bytes[k].data() : NULL;
+            lengths[k] = bytes[k].size();
+            if (lengths[k] > longest) longest = lengths[k];
+        }
+    }
+};
+
+int main() {
+    srand(1);
+
+    // A single byte, by hand: lane k holding 1 << k puts lane k's bit in slot 7 - k
+    uint8_t in[8], out[8];
+    for (int k = 0; k < 8; k++) in[k] = 1 << k;
+    transpose8(in, out);
+    for (int b = 0; b < 8; b++) CHECK_EQ(out[b], 1 << (7 - b));
+
+    // Full lanes, uneven ones and missing ones all match the reference
+    const int shapes[][PARALLEL_LANES] = {
+        { 50, 50, 50, 50, 50, 50, 50, 50 },
+        { 50, 47, 44, 41, 38, 35, 32, 29 },
+        { 50, 0, 44, 0, 38, 0, 32, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 7 },
+        { 150, 60, 60, 30, 0, 0, 0, 0 },
+        { 300, 240, 180, 120, 0, 0, 0, 0 },
+    };
+    for (auto& shape : shapes) {
+        Lanes l(shape);
+        std::vector<uint8_t> fast(l.longest * 8), reference(l.longest * 8);
+        transposeLanes(l.lanes, l.lengths, l.longest, fast.data());
+        transposeBitwise(l.lanes, l.lengths, l.longest, reference.data());
+        CHECK(fast == reference);
+    }
+
+    // The cabinet: marquee, two sides and the control panel; four uneven
+    // strips; then 8 even ones
+    struct {
+        const char* name;
+        int pixels[PARALLEL_LANES];
+    } cabinets[] = {
+        { "cabinet",   { 150, 60, 60, 30, 0, 0, 0, 0 } },
+        { "4 uneven",  { 300, 240, 180, 120, 0, 0, 0, 0 } },
+        { "8 x 300",   { 300, 300, 300, 300, 300, 300, 300, 300 } },
+    };
+    printf("%-10s %12s %12s %12s %12s %12s\n", "lanes", "transpose us", "per-byte us", "bitwise us",
+           "serial ms", "parallel ms");
+    for (auto& cabinet : cabinets) {
+        Lanes l(cabinet.pixels);
+        std::vector<uint8_t> stream(l.longest * 8);
+        double begin = hostMicros();
+        for (int f = 0; f < FRAMES; f++) {
+            transposeLanes(l.lanes, l.lengths, l.longest, stream.data());
+            benchSink += stream[f % stream.size()];
+        }
+        double fastUs = (hostMicros() - begin) / FRAMES;
+        begin = hostMicros();
+        for (int f = 0; f < FRAMES; f++) {
+            transposeBytewise(l.lanes, l.lengths, l.longest, stream.data());
+            benchSink += stream[f % stream.size()];
+        }
+        double bytewiseUs = (hostMicros() - begin) / FRAMES;
+        begin = hostMicros();
+        for (int f = 0; f < FRAMES / 10; f++) {
+            transposeBitwise(l.lanes, l.lengths, l.longest, stream.data());
+            benchSink += stream[f % stream.size()];
+        }
+        double bitwiseUs = (hostMicros() - begin) / (FRAMES / 10);
+
+        size_t total = 0;
+        for (int k = 0; k < PARALLEL_LANES; k++) total += l.lengths[k];
+        printf("%-10s %12.2f %12.2f %12.2f %12.2f %12.2f\n", cabinet.name, fastUs, bytewiseUs, bitwiseUs,
+               total * 8.0 * NS_PER_BIT / 1e6, l.longest * 8.0 * NS_PER_BIT / 1e6);
+        CHECK(fastUs < bitwiseUs);
+    }
+
+    return testResult("transpose");
+}
@@ -0,0 +1,97 @@
+#include "ws2812_model.h"
+#include <string.h>
+
+Ws2812Decoder::Ws2812Decoder(uint8_t* out, size_t capacity, const Ws2812Spec& spec) :
+    out(out), capacity(capacity), spec(spec) {
+    reset();
+}
+
+void Ws2812Decoder::reset() {
+    memset(&result, 0, sizeof(result));
+    result.highMargin = INT32_MAX;
+    result.lowMargin = INT32_MAX;
+    current = 0;
+    bitCount = 0;
+}
+
+void Ws2812Decoder::bit(uint8_t value) {
+    current = (current << 1) | value;
+    result.bits++;
+    if (++bitCount == 8) {
+        if (result.bytes < capacity) out[result.bytes] = current;
+        result.bytes++;
+        current = 0;
+        bitCount = 0;
+    }
+}
+
+void Ws2812Decoder::pulse(uint32_t highNs, uint32_t lowNs) {
+    result.durationNs += (uint64_t)highNs + lowNs;
+
+    // Distance inside the window; negative outside it
+    int32_t margin0 = (int32_t)highNs - spec.t0hMin;
+    if ((int32_t)spec.t0hMax - (int32_t)highNs < margin0) margin0 = spec.t0hMax - (int32_t)highNs;
+    int32_t margin1 = (int32_t)highNs - spec.t1hMin;
+    if ((int32_t)spec.t1hMax - (int32_t)highNs < margin1) margin1 = spec.t1hMax - (int32_t)highNs;
+
+    uint8_t value = margin1 > margin0 ? 1 : 0;
+    int32_t margin = value ? margin1 : margin0;
+    if (margin < result.highMargin) result.highMargin = margin;
+    bool bad = margin < 0;
+
+    if (lowNs >= spec.resetNs) {
+        // The last bit's low time runs into the latch, nothing to check
+        bit(value);
+        result.latches++;
+        bitCount = 0;
+        current = 0;
+    }
+    else {
+        int32_t lowMargin = (int32_t)lowNs - spec.lowMin;
+        if (lowMargin < result.lowMargin) result.lowMargin = lowMargin;
+        bad = bad || lowMargin < 0;
+        bit(value);
+    }
+
+    if (bad) {
+        if (result.errors == 0) result.firstError = result.bits - 1;
+        result.errors++;
+    }
+}
+
+void Ws2812Decoder::rmtSymbols(const uint32_t* symbols, size_t count, uint32_t tickNs) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t high = symbols[i] & 0x7FFF;
+        uint32_t low = (symbols[i] >> 16) & 0x7FFF;
+        pulse(high * tickNs, low * tickNs);
+    }
+}
+
+void Ws2812Decoder::edges(const uint32_t* timesNs, size_t count) {
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        uint32_t high = timesNs[i + 1] - timesNs[i];
+        uint32_t low = i + 2 < count ? timesNs[i + 2] - timesNs[i + 1] : spec.resetNs;
+        pulse(high, low);
+    }
+}
+
+size_t bitBangEdges(const uint8_t* bytes, size_t count, uint32_t cpuHz,
+                    uint32_t t0hCycles, uint32_t t1hCycles, uint32_t periodCycles,
+                    uint32_t latencyCycles, uint32_t* edgesNs) {
+    size_t n = 0;
+    uint64_t cycle = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (uint8_t mask = 0x80; mask; mask >>= 1) {
+            uint32_t high = (bytes[i] & mask) ? t1hCycles : t0hCycles;
+            edgesNs[n++] = (uint32_t)((cycle + latencyCycles) * 1000000000ULL / cpuHz);
+            edgesNs[n++] = (uint32_t)((cycle + high + latencyCycles) * 1000000000ULL / cpuHz);
+            cycle += periodCycles;
+        }
+    }
+    return n;
+}
+
+uint32_t ws2812FrameRate(uint32_t numPixels, uint32_t bitNs, uint32_t latchUs) {
+    uint64_t frameNs = (uint64_t)numPixels * 24 * bitNs + (uint64_t)latchUs * 1000;
+    return frameNs ? (uint32_t)(1000000000ULL / frameNs) : 0;
+}
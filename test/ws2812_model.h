@@ -0,0 +1,79 @@
+#ifndef WS2812_MODEL_H
+#define WS2812_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Receiving end of a WS2812 data line, for checking output code without a
+// scope. Pulses (a high time followed by a low time) are classified against
+// datasheet windows: a high time inside the T0H window is a 0, inside T1H a
+// 1, anything else is an error the real chip might read either way. A low
+// time of resetNs or more latches the frame. Host tests only, see
+// ws2812_model_test.cpp.
+
+// Timing windows, in ns
+typedef struct Ws2812Spec {
+    uint16_t t0hMin, t0hMax;    // High time of a 0
+    uint16_t t1hMin, t1hMax;    // High time of a 1
+    uint16_t lowMin;            // Shortest low time between bits
+    uint32_t resetNs;           // Low time that latches
+} Ws2812Spec;
+
+// WS2812B datasheet: T0H 400, T1H 800, +-150 ns; reset 50 us (280 us on V5)
+static const Ws2812Spec ws2812b = { 250, 550, 650, 950, 300, 50000 };
+
+typedef struct Ws2812Report {
+    uint32_t bytes;             // Whole bytes decoded
+    uint32_t bits;              // Bits decoded, including a partial byte
+    uint32_t errors;            // Pulses outside both high windows or too short low
+    uint32_t firstError;        // Bit index of the first error
+    int32_t  highMargin;        // Smallest distance of a high time to its window edge, ns
+    int32_t  lowMargin;         // Smallest low time over lowMin, ns
+    uint32_t latches;           // Resets seen
+    uint64_t durationNs;        // Time from first rising edge to the end of the last pulse
+} Ws2812Report;
+
+class Ws2812Decoder {
+public:
+    // Decoded bytes go to out (up to capacity; the rest are only counted)
+    Ws2812Decoder(uint8_t* out, size_t capacity, const Ws2812Spec& spec = ws2812b);
+
+    void reset();
+
+    // One pulse: high for highNs, then low for lowNs
+    void pulse(uint32_t highNs, uint32_t lowNs);
+
+    // RMT items as packed by rmtSymbol() (high first), tickNs per tick
+    void rmtSymbols(const uint32_t* symbols, size_t count, uint32_t tickNs);
+
+    // Edge times in ns, alternating rising and falling, starting with a
+    // rising edge; the line is taken as low after the last one
+    void edges(const uint32_t* timesNs, size_t count);
+
+    const Ws2812Report& report() const { return result; }
+
+private:
+    void bit(uint8_t value);
+
+    uint8_t*     out;
+    size_t       capacity;
+    Ws2812Spec   spec;
+    Ws2812Report result;
+    uint8_t      current;
+    uint8_t      bitCount;
+};
+
+// Edges of a cycle-counted bit-bang loop, as in ChunkedOutput::sendChunk():
+// every bit starts periodCycles after the last one and stays high for t0h or
+// t1h cycles, plus latencyCycles for the GPIO write. Cycles are converted at
+// the actual cpuHz, so constants computed for another F_CPU show up as
+// timing errors. Writes 2 edges per bit to edgesNs; returns the count.
+size_t bitBangEdges(const uint8_t* bytes, size_t count, uint32_t cpuHz,
+                    uint32_t t0hCycles, uint32_t t1hCycles, uint32_t periodCycles,
+                    uint32_t latencyCycles, uint32_t* edgesNs);
+
+// Frames per second a strip of numPixels can reach: bitNs per bit, 24 bits
+// per pixel, plus the latch
+uint32_t ws2812FrameRate(uint32_t numPixels, uint32_t bitNs, uint32_t latchUs);
+
+#endif
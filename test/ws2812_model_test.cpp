@@ -0,0 +1,151 @@
+// The output paths against a model of the WS2812B receiving them: RMT
+// symbols from the encoder, the cycle-counted bit-bang loops of the chunked
+// and parallel outputs at the clock they were compiled for and at others,
+// and interrupt windows between chunks. Bytes decoded must be the bytes
+// sent, and the timing margins must match the golden values below.
+
+#include "host_test.h"
+#include "ws2812_model.h"
+#include "rmt_encoder.h"
+#include "chunk_timing.h"
+#include "transpose.h"
+#include <string.h>
+#include <vector>
+
+#define PIXELS  30
+#define BYTES   (PIXELS * 3)
+#define F_BUILD 240000000u      // F_CPU the bit-bang constants are computed for
+
+// Cycle counts as in chunked_output.cpp and parallel_output.cpp
+#define CYCLES_800_T0H  (F_BUILD / 2500000)
+#define CYCLES_800_T1H  (F_BUILD / 1250000)
+#define CYCLES_800      (F_BUILD /  800000)
+#define GPIO_LATENCY    10      // Cycles from the cycle count to the pin changing
+
+struct Expected {
+    uint32_t cpuHz;
+    uint32_t errors;
+    uint32_t firstError;
+    int32_t  highMargin;
+    int32_t  lowMargin;
+};
+
+// Bit-bang timing at the real clock against constants built for 240 MHz:
+// only 240 MHz is in spec. At 160 MHz a 0 is high for 600 ns and a 1 for
+// 1200 ns, so every bit is out of its window.
+static const Expected bitBang[] = {
+    { 240000000u,   0, 0,   150,  150 },
+    { 160000000u, 720, 0,  -250,  375 },
+    {  80000000u, 720, 0, -1450, 1050 },
+};
+
+static void fill(uint8_t* bytes) {
+    for (int i = 0; i < BYTES; i++) bytes[i] = i * 37 + 5;
+}
+
+int main() {
+    uint8_t sent[BYTES], received[BYTES];
+    fill(sent);
+
+    // RMT: every pulse 150 ns inside the datasheet windows, the frame takes
+    // exactly 24 bits of 1.25 us a pixel, and the stretched last low latches
+    std::vector<uint32_t> symbols(BYTES * 8);
+    RmtEncoder encoder;
+    encoder.encode(sent, BYTES, symbols.data());
+    symbols.back() = (symbols.back() & 0xFFFF) | ((uint32_t)RMT_NS(50000UL) << 16);
+    Ws2812Decoder rmt(received, sizeof(received));
+    rmt.rmtSymbols(symbols.data(), symbols.size(), RMT_TICK_NS);
+    const Ws2812Report& r = rmt.report();
+    CHECK_EQ(r.bytes, BYTES);
+    CHECK(memcmp(received, sent, BYTES) == 0);
+    CHECK_EQ(r.errors, 0);
+    CHECK_EQ(r.highMargin, 150);
+    CHECK_EQ(r.lowMargin, 150);
+    CHECK_EQ(r.latches, 1);
+    CHECK_EQ(r.durationNs, (BYTES * 8 - 1) * 1250ULL + 400 + 50000);
+    printf("rmt: %u bytes, %u errors, margins %d/%d ns\n", r.bytes, r.errors, r.highMargin, r.lowMargin);
+
+    // Bit-banged, as ChunkedOutput sends one strip
+    std::vector<uint32_t> edges(BYTES * 16);
+    for (const Expected& e : bitBang) {
+        size_t n = bitBangEdges(sent, BYTES, e.cpuHz, CYCLES_800_T0H, CYCLES_800_T1H, CYCLES_800,
+                                GPIO_LATENCY, edges.data());
+        Ws2812Decoder decoder(received, sizeof(received));
+        decoder.edges(edges.data(), n);
+        const Ws2812Report& q = decoder.report();
+        CHECK_EQ(q.bits, BYTES * 8);
+        CHECK_EQ(q.errors, e.errors);
+        CHECK_EQ(q.firstError, e.firstError);
+        CHECK_EQ(q.highMargin, e.highMargin);
+        CHECK_EQ(q.lowMargin, e.lowMargin);
+        if (e.errors == 0) CHECK(memcmp(received, sent, BYTES) == 0);
+        printf("bit-bang at %3u MHz: %3u errors, margins %d/%d ns\n",
+               e.cpuHz / 1000000, q.errors, q.highMargin, q.lowMargin);
+    }
+
+    // Parallel: each lane of the transposed stream is one strip's bytes,
+    // clocked out by the same loop
+    uint8_t lanesBytes[PARALLEL_LANES][BYTES];
+    const uint8_t* lanes[PARALLEL_LANES];
+    size_t lengths[PARALLEL_LANES];
+    for (int k = 0; k < PARALLEL_LANES; k++) {
+        for (int i = 0; i < BYTES; i++) lanesBytes[k][i] = sent[i] ^ (k * 0x35);
+        lanes[k] = lanesBytes[k];
+        lengths[k] = BYTES - k * 6;
+    }
+    std::vector<uint8_t> stream(BYTES * 8);
+    transposeLanes(lanes, lengths, BYTES, stream.data());
+    for (int k = 0; k < PARALLEL_LANES; k++) {
+        uint8_t lane[BYTES];
+        for (int i = 0; i < BYTES; i++) {
+            lane[i] = 0;
+            for (int b = 0; b < 8; b++) lane[i] = (lane[i] << 1) | ((stream[i * 8 + b] >> k) & 1);
+        }
+        size_t n = bitBangEdges(lane, lengths[k], F_BUILD, CYCLES_800_T0H, CYCLES_800_T1H, CYCLES_800,
+                                GPIO_LATENCY, edges.data());
+        Ws2812Decoder decoder(received, sizeof(received));
+        decoder.edges(edges.data(), n);
+        CHECK_EQ(decoder.report().bytes, lengths[k]);
+        CHECK_EQ(decoder.report().errors, 0);
+        CHECK(memcmp(received, lanesBytes[k], lengths[k]) == 0);
+    }
+
+    // Chunked: an interrupt window up to maxGapUs between chunks holds the
+    // line low without latching; one long enough to latch splits the frame
+    ChunkPlan plan = chunkPlan(BYTES, defaultChunks);
+    CHECK(plan.safe);
+    CHECK_EQ(plan.chunkBytes, 4);
+    CHECK_EQ(plan.chunks, 23);
+    for (uint32_t gapUs : { (uint32_t)defaultChunks.maxGapUs, 60u }) {
+        Ws2812Decoder decoder(received, sizeof(received));
+        for (int i = 0; i < BYTES * 8; i++) {
+            uint16_t high = (sent[i / 8] << (i % 8)) & 0x80 ? 800 : 400;
+            uint32_t low = 1250 - high;
+            if ((i + 1) % (plan.chunkBytes * 8) == 0) low += gapUs * 1000;
+            if (i == BYTES * 8 - 1) low = 300000;
+            decoder.pulse(high, low);
+        }
+        bool latched;
+        uint32_t gaps[1] = { gapUs * 1000 };
+        int resend = chunkReplay(defaultChunks, gaps, 1, &latched);
+        if (gapUs <= defaultChunks.maxGapUs) {
+            CHECK_EQ(decoder.report().latches, 1);
+            CHECK_EQ(resend, -1);
+            CHECK(memcmp(received, sent, BYTES) == 0);
+        }
+        else {
+            // Latched after every chunk, and the replay resends the frame
+            CHECK_EQ(decoder.report().latches, plan.chunks);
+            CHECK_EQ(resend, 0);
+            CHECK(latched);
+        }
+        printf("chunk gaps of %2u us: %u latches\n", gapUs, decoder.report().latches);
+    }
+
+    // Frame rate at 800 kHz with the 50 us latch
+    CHECK_EQ(ws2812FrameRate(30, 1250, 50), 1052);
+    CHECK_EQ(ws2812FrameRate(300, 1250, 50), 110);
+    CHECK_EQ(ws2812FrameRate(1000, 1250, 50), 33);
+
+    return testResult("ws2812_model");
+}